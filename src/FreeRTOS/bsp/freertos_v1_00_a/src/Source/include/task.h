@@ -117,6 +117,20 @@ typedef struct xTASK_PARAMTERS
 	xMemoryRegion xRegions[ portNUM_CONFIGURABLE_REGIONS ];
 } xTaskParameters;
 
+/*
+ * The state of one task, as filled in by uxTaskGetSnapshot().
+ */
+typedef struct xTASK_SNAPSHOT
+{
+	xTaskHandle xHandle;
+	signed char pcTaskName[ configMAX_TASK_NAME_LEN ];
+	unsigned portBASE_TYPE uxTaskNumber;
+	signed char cStatus;					/*< 'R', 'B', 'D' or 'S', as reported by vTaskList(). */
+	unsigned portBASE_TYPE uxPriority;
+	unsigned long ulRunTimeCounter;			/*< 0 unless configGENERATE_RUN_TIME_STATS is 1. */
+	unsigned short usStackHighWaterMark;	/*< In words, as uxTaskGetStackHighWaterMark(). */
+} xTaskSnapshot;
+
 /*
  * Defines the priority used by the idle task.  This must not be modified.
  *
@@ -1071,6 +1085,35 @@ void vTaskList( signed char *pcWriteBuffer ) PRIVILEGED_FUNCTION;
  */
 void vTaskGetRunTimeStats( signed char *pcWriteBuffer ) PRIVILEGED_FUNCTION;
 
+/**
+ * task. h
+ * <PRE>unsigned portBASE_TYPE uxTaskGetSnapshot( xTaskSnapshot *pxTaskArray, unsigned portBASE_TYPE uxArraySize, unsigned long *pulTotalRunTime );</PRE>
+ *
+ * configUSE_TRACE_FACILITY must be defined as 1 for this function to be
+ * available.
+ *
+ * The binary counterpart of vTaskList() and vTaskGetRunTimeStats().  Fills
+ * in the state, priority, stack high water mark and accumulated run time of
+ * each task, so the caller can format them or pass them on as it likes.
+ * The scheduler is suspended while the task lists are walked, interrupts
+ * stay enabled.
+ *
+ * @param pxTaskArray Array the tasks are written into.
+ *
+ * @param uxArraySize Number of entries in pxTaskArray.  Tasks beyond it are
+ * counted but not written.
+ *
+ * @param pulTotalRunTime Set to the current value of the run time counter,
+ * the time base of the ulRunTimeCounter members, or 0 if
+ * configGENERATE_RUN_TIME_STATS is not 1.  May be NULL.
+ *
+ * @return The number of tasks, which may be larger than uxArraySize.
+ *
+ * \page uxTaskGetSnapshot uxTaskGetSnapshot
+ * \ingroup TaskUtils
+ */
+unsigned portBASE_TYPE uxTaskGetSnapshot( xTaskSnapshot *pxTaskArray, unsigned portBASE_TYPE uxArraySize, unsigned long *pulTotalRunTime ) PRIVILEGED_FUNCTION;
+
 /**
  * task. h
  * <PRE>void vTaskStartTrace( char * pcBuffer, unsigned portBASE_TYPE uxBufferSize );</PRE>
@@ -65,6 +65,7 @@
 /* Standard includes. */
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 /* Scheduler includes. */
 #include "FreeRTOS.h"
@@ -78,6 +79,7 @@
 #include "xil_exception.h"
 
 #include "xil_printf.h"
+#include "trace_ring.h"
 
 /* Constants required to setup the task context. */
 #define portINITIAL_SPSR				( ( portSTACK_TYPE ) 0x1f ) /* System mode, ARM mode, interrupts enabled. */
@@ -238,10 +240,6 @@ static int ptr_valid(unsigned *fp)
 
 /* MS: Trace buffer setting */
 xSemaphoreHandle xStdioSemaphore;
-char *log_buf_base;
-unsigned int log_buf_len;
-char *current;
-
 
 static void stdio_lock_mutex()
 {
@@ -257,25 +255,279 @@ static void stdio_unlock_mutex()
     xSemaphoreGive(xStdioSemaphore);
 }
 
-void xputs(char *str)
+/* Cortex-A9 global timer, shared by both cores. It clocks the kernel events
+ * and the run time stats. */
+#define PORT_GLOBAL_TIMER_LOW		(XPS_GLOBAL_TMR_BASEADDR + 0x0)
+#define PORT_GLOBAL_TIMER_HIGH		(XPS_GLOBAL_TMR_BASEADDR + 0x4)
+#define PORT_GLOBAL_TIMER_CONTROL	(XPS_GLOBAL_TMR_BASEADDR + 0x8)
+#define PORT_GLOBAL_TIMER_FREQ		(XPAR_CPU_CORTEXA9_0_CPU_CLK_FREQ_HZ / 2)
+
+#if portTRACE_EVENTS || ( configGENERATE_RUN_TIME_STATS == 1 )
+
+/* Start the global timer, Linux may have done so already */
+static void port_global_timer_enable(void)
+{
+	volatile unsigned int *control = (void *)PORT_GLOBAL_TIMER_CONTROL;
+
+	*control |= 0x1;
+}
+
+static unsigned long long port_global_time(void)
+{
+	volatile unsigned int *low = (void *)PORT_GLOBAL_TIMER_LOW;
+	volatile unsigned int *high = (void *)PORT_GLOBAL_TIMER_HIGH;
+	unsigned int hi;
+	unsigned int lo;
+
+	do {
+		hi = *high;
+		lo = *low;
+	} while (hi != *high);
+
+	return ((unsigned long long)hi << 32) | lo;
+}
+
+#endif
+
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+
+void vPortConfigureRunTimeCounter( void )
+{
+	port_global_timer_enable();
+}
+
+unsigned long ulPortGetRunTimeCounter( void )
+{
+	return (unsigned long)(port_global_time() >> portRUN_TIME_SHIFT);
+}
+
+#endif /* configGENERATE_RUN_TIME_STATS */
+
+#if portTRACE_EVENTS
+
+/* Kernel event trace, see trace_event.h */
+/* Highest priority pending interrupt of the GIC CPU interface, the IRQ
+ * about to be acknowledged by IRQInterrupt */
+#define EVENT_GIC_HPPIR				(XPS_SCU_PERIPH_BASE + 0x100 + 0x18)
+#define EVENT_GIC_ID_MASK			0x3ff
+
+/* Events are written back to memory and published in segments of this
+ * many bytes (a power of two, at most the buffer size), the rest by
+ * event_trace_drain() */
+#define EVENT_FLUSH_SIZE			512
+
+/* Tasks whose names are written again at the start of each half of the
+ * buffer, so that Linux finds the name of every task alive in whatever it
+ * reads of the buffer. Tasks beyond these are only named when created. */
+#define EVENT_TASKS_MAX				32
+
+/* NULL until event_trace_init() is called. 'overruns' of the header is not
+ * kept: it would take reading the tail back from memory for every event,
+ * the reader counts what it has lost itself, like for the binary log. */
+static struct trace_ring *event_ring = NULL;
+static unsigned char *event_buffer;
+static unsigned int event_size;
+/* Bytes written */
+static unsigned int event_head;
+/* Bytes written back and published in event_ring->head */
+static unsigned int event_published;
+/* IRQ being handled, IRQs do not nest in this port */
+static unsigned int event_irq;
+
+struct event_task {
+	void *task;
+	const signed char *name;
+};
+
+/* Tasks alive, kept by event_trace_task() and event_trace_task_delete() */
+static struct event_task event_tasks[EVENT_TASKS_MAX];
+
+static void event_write_names(void);
+
+/* Write back the events since the last publish and move the head past
+ * them. They never cross the end of the buffer, a segment boundary comes
+ * first. Called with interrupts disabled. */
+static void event_publish(void)
+{
+	unsigned int len = event_head - event_published;
+
+	if (len == 0) {
+		return;
+	}
+	trace_flush_range(event_buffer + (event_published & (event_size - 1)),
+			len);
+	event_published = event_head;
+	event_ring->head = event_head;
+	trace_flush_range(&event_ring->head, TRACE_RING_CACHE_LINE);
+}
+
+/* Write one event, and publish the segment once it is full. The kernel
+ * calls the trace macros with interrupts disabled or from an ISR, but the
+ * IRQ state is saved and restored anyway so the events can also be written
+ * from elsewhere. */
+static void event_write(unsigned long long time, unsigned int type,
+		unsigned int info, unsigned int arg)
+{
+	struct trace_event *ev;
+	unsigned int cpsr;
+
+	__asm volatile ( "MRS %0, CPSR\n\t"
+			"CPSID if" : "=r" (cpsr) : : "memory" );
+
+	ev = (struct trace_event *)(event_buffer + (event_head & (event_size - 1)));
+	ev->time = time;
+	ev->type = type;
+	ev->info = info;
+	ev->arg = arg;
+
+	event_head += sizeof(*ev);
+	if ((event_head & (event_size - 1)) == 0) {
+		event_ring->wraps++;
+	}
+	if ((event_head & (EVENT_FLUSH_SIZE - 1)) == 0) {
+		event_publish();
+	}
+	if ((event_head & (event_size / 2 - 1)) == 0) {
+		event_write_names();
+	}
+
+	__asm volatile ( "MSR CPSR_c, %0" : : "r" (cpsr) : "memory" );
+}
+
+/* Write the name of 'task', eight characters per event, at least one event */
+static void event_write_name(void *task, const signed char *name)
+{
+	union {
+		unsigned long long time;
+		char name[8];
+	} part;
+	unsigned int offset = 0;
+	unsigned int len = 0;
+	unsigned int n;
+
+	while (len < configMAX_TASK_NAME_LEN && name[len] != '\0') {
+		len++;
+	}
+	do {
+		n = len - offset < sizeof(part.name) ? len - offset : sizeof(part.name);
+		memset(part.name, 0, sizeof(part.name));
+		memcpy(part.name, name + offset, n);
+		event_write(part.time, TRACE_EVENT_TASK_NAME,
+				offset / sizeof(part.name), (unsigned int)task);
+		offset += sizeof(part.name);
+	} while (offset < len);
+}
+
+/* Name all tasks again at the start of a half of the buffer. The names take
+ * far less than half the buffer, so this does not recurse. */
+static void event_write_names(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < EVENT_TASKS_MAX; i++) {
+		if (event_tasks[i].task != NULL) {
+			event_write_name(event_tasks[i].task, event_tasks[i].name);
+		}
+	}
+}
+
+void event_trace_init(unsigned int ring, unsigned int buffer,
+		unsigned int size)
+{
+	/* The global timer may not run yet */
+	port_global_timer_enable();
+
+	event_buffer = (unsigned char *) buffer;
+	event_size = size;
+	event_head = 0;
+	event_published = 0;
+
+	event_ring = (struct trace_ring *) ring;
+	event_ring->magic = 0;
+	event_ring->buffer = buffer;
+	event_ring->size = size;
+	event_ring->timestamp_freq = PORT_GLOBAL_TIMER_FREQ;
+	event_ring->head = 0;
+	event_ring->wraps = 0;
+	event_ring->overruns = 0;
+	event_ring->tail = 0;
+	trace_flush_range(event_ring, sizeof(*event_ring));
+
+	event_ring->magic = TRACE_RING_MAGIC;
+	trace_flush_range(&event_ring->magic, sizeof(event_ring->magic));
+}
+
+void event_trace(unsigned int type, unsigned int info, unsigned int arg)
+{
+	if (event_ring != NULL) {
+		event_write(port_global_time(), type, info, arg);
+	}
+}
+
+void event_trace_drain(void)
+{
+	unsigned int cpsr;
+
+	if (event_ring != NULL) {
+		__asm volatile ( "MRS %0, CPSR\n\t"
+				"CPSID if" : "=r" (cpsr) : : "memory" );
+		event_publish();
+		__asm volatile ( "MSR CPSR_c, %0" : : "r" (cpsr) : "memory" );
+	}
+}
+
+void event_trace_task(void *task, const signed char *name)
+{
+	unsigned int i;
+
+	/* Tasks created before event_trace_init() are named at the next half */
+	for (i = 0; i < EVENT_TASKS_MAX; i++) {
+		if (event_tasks[i].task == NULL) {
+			event_tasks[i].task = task;
+			event_tasks[i].name = name;
+			break;
+		}
+	}
+	if (event_ring != NULL) {
+		event_write_name(task, name);
+	}
+}
+
+void event_trace_task_delete(void *task)
+{
+	unsigned int i;
+
+	for (i = 0; i < EVENT_TASKS_MAX; i++) {
+		if (event_tasks[i].task == task) {
+			event_tasks[i].task = NULL;
+			break;
+		}
+	}
+	if (event_ring != NULL) {
+		event_write(port_global_time(), TRACE_EVENT_TASK_DELETE, 0,
+				(unsigned int)task);
+	}
+}
+
+void event_trace_irq_enter(void)
 {
-//	vPortEnterCritical();
-	int len = (int)strlen(str);
-
-	if ((current + len) >= (log_buf_base + log_buf_len)) {
-		int offset = log_buf_base + log_buf_len - current;
-		strncpy(current, str, offset);
-		current = log_buf_base;
-		strncpy(current, str + offset, len - offset);
-	} else {
-		strncpy(current, str, len);
-		current += len;
+	volatile unsigned int *hppir = (void *)EVENT_GIC_HPPIR;
+
+	if (event_ring != NULL) {
+		event_irq = *hppir & EVENT_GIC_ID_MASK;
+		event_write(port_global_time(), TRACE_EVENT_IRQ_ENTER, 0, event_irq);
 	}
+}
 
-	Xil_L1DCacheFlush();
-//	vPortExitCritical();
+void event_trace_irq_exit(void)
+{
+	if (event_ring != NULL) {
+		event_write(port_global_time(), TRACE_EVENT_IRQ_EXIT, 0, event_irq);
+	}
 }
 
+#endif /* portTRACE_EVENTS */
+
 void FreeRTOS_ExHandler(void *data);
 
 static void freertos_exception_init(void)
@@ -303,9 +555,7 @@ void stdio_lock_init(unsigned int base, unsigned int len)
 {
     freertos_exception_init();
     xStdioSemaphore = xSemaphoreCreateMutex();
-    log_buf_base = (char *) base;
-    log_buf_len = len;
-    current = (char *) base;
+    port_trace_init(base, len);
 }
 
 /*
@@ -173,6 +173,9 @@ void vTickISR( XScuTimer *Timer )
 	#endif
 
 	XScuTimer_ClearInterruptStatus(Timer);
+
+	/* Hand the kernel events of the last tick to Linux */
+	event_trace_drain();
 }
 
 /*
@@ -188,9 +191,17 @@ void vFreeRTOS_IRQInterrupt ( void )
 
 	__asm volatile( "clrex" );
 
+	#if portTRACE_EVENTS
+		__asm volatile( "bl event_trace_irq_enter" );
+	#endif
+
 	/* Call the handler provided with the standalone BSP */
 	__asm volatile( "bl IRQInterrupt" );
 
+	#if portTRACE_EVENTS
+		__asm volatile( "bl event_trace_irq_exit" );
+	#endif
+
 	ulCriticalNesting--;
 
 	/* Restore the context of the new task. */
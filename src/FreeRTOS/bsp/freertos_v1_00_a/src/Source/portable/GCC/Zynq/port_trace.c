@@ -0,0 +1,163 @@
+/*
+ * Trace buffer of the Zynq port: xputs() and the header Linux follows the
+ * buffer with (trace_ring.h).
+ *
+ * This file only depends on the cache maintenance of the standalone BSP, so
+ * the host simulation in src/remoteproc_sim builds it as it is.
+ */
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "xil_cache_l.h"
+#include "trace_ring.h"
+
+static char *log_buf_base;
+static unsigned int log_buf_len;
+/* Header Linux follows the trace buffer with, see trace_ring.h. NULL until
+ * stdio_ring_init() is called. */
+static struct trace_ring *log_ring = NULL;
+
+/*
+ * Writers of the trace buffer take their space with one atomic update of
+ * log_reserve: the low LOG_POS_BITS hold the write position, the bits above
+ * the number of writers still copying their text. The writer which brings
+ * that number back to zero knows all text up to the position is complete and
+ * publishes it as the new head. Writers never wait for each other and never
+ * disable interrupts, so tasks and interrupt handlers may write at any time;
+ * the text of an interrupted writer shows up once it is done. This limits
+ * the trace buffer to 2^(LOG_POS_BITS - 1) bytes and 255 nested writers.
+ *
+ * GCC implements the __sync builtins with LDREX/STREX and DMB on the A9.
+ */
+#define LOG_POS_BITS		24
+#define LOG_POS_MASK		((1U << LOG_POS_BITS) - 1)
+#define LOG_WRITER			(1U << LOG_POS_BITS)
+
+static volatile unsigned int log_reserve;
+/* Bytes published, free running. Points to log_ring->head once the header
+ * is set up. */
+static volatile unsigned int log_head_init;
+static volatile unsigned int *log_head = &log_head_init;
+
+/* Linux reads the trace buffer uncached, write the new text back to memory
+ * (L1 and L2, only the lines written to) */
+void trace_flush_range(volatile void *start, int len)
+{
+	Xil_L1DCacheFlushRange((unsigned long)start, len);
+	Xil_L2CacheFlushRange((unsigned long)start, len);
+}
+
+/* Free running byte count of a position of log_reserve, which is at most
+ * 2^(LOG_POS_BITS - 1) bytes ahead of 'head' */
+static unsigned int trace_pos_extend(unsigned int head, unsigned int pos)
+{
+	return head + ((pos - head) & LOG_POS_MASK);
+}
+
+/* Move the head forward to 'pos' once the text is in memory. Another writer
+ * may have published a later position meanwhile, the head never goes back. */
+static void trace_ring_publish(unsigned int pos)
+{
+	unsigned int head;
+	unsigned int end;
+
+	do {
+		head = *log_head;
+		if (((pos - head) & LOG_POS_MASK) >= (LOG_WRITER >> 1)) {
+			return;
+		}
+		end = trace_pos_extend(head, pos);
+	} while (__sync_val_compare_and_swap(log_head, head, end) != head);
+
+	if (log_ring != NULL) {
+		/* Times the head passed the end of the buffer */
+		__sync_fetch_and_add(&log_ring->wraps,
+				(end - (head & ~(log_buf_len - 1))) / log_buf_len);
+		trace_flush_range(&log_ring->head, TRACE_RING_CACHE_LINE);
+	}
+}
+
+void xputs(char *str)
+{
+	unsigned int len = strlen(str);
+	unsigned int skip = 0;
+	unsigned int state;
+	unsigned int next;
+	unsigned int start;
+	unsigned int offset;
+	unsigned int first;
+
+	/* Longer than the buffer, only the end fits */
+	if (len > log_buf_len) {
+		skip = len - log_buf_len;
+	}
+
+	/* Take the space and count this writer in */
+	do {
+		state = log_reserve;
+		next = ((state & ~LOG_POS_MASK) + LOG_WRITER) |
+				((state + len) & LOG_POS_MASK);
+	} while (__sync_val_compare_and_swap(&log_reserve, state, next) != state);
+	start = trace_pos_extend(*log_head, state) + skip;
+	str += skip;
+	len -= skip;
+
+	offset = start % log_buf_len;
+	first = log_buf_len - offset;
+	if (first > len) {
+		first = len;
+	}
+	memcpy(log_buf_base + offset, str, first);
+	trace_flush_range(log_buf_base + offset, first);
+	if (len > first) {
+		memcpy(log_buf_base, str + first, len - first);
+		trace_flush_range(log_buf_base, len - first);
+	}
+
+	/* Count the write as an overrun if it reached unread text */
+	if (log_ring != NULL) {
+		trace_flush_range(&log_ring->tail, sizeof(log_ring->tail));
+		if (start + len - log_ring->tail > log_buf_len) {
+			__sync_fetch_and_add(&log_ring->overruns, 1);
+		}
+	}
+
+	/* Count this writer out, the last one publishes */
+	do {
+		state = log_reserve;
+		next = state - LOG_WRITER;
+	} while (__sync_val_compare_and_swap(&log_reserve, state, next) != state);
+	if ((next & ~LOG_POS_MASK) == 0) {
+		trace_ring_publish(next);
+	}
+}
+
+void port_trace_init(unsigned int base, unsigned int len)
+{
+    log_buf_base = (char *)(unsigned long) base;
+    log_buf_len = len;
+    log_reserve = 0;
+    *log_head = 0;
+}
+
+void stdio_ring_init(unsigned int ring)
+{
+    log_ring = (struct trace_ring *)(unsigned long) ring;
+    log_ring->magic = 0;
+    log_ring->buffer = (unsigned long) log_buf_base;
+    log_ring->size = log_buf_len;
+    log_ring->timestamp_freq = 0;
+    log_ring->head = *log_head;
+    log_ring->wraps = *log_head / log_buf_len;
+    log_ring->overruns = 0;
+    log_ring->tail = 0;
+    trace_flush_range(log_ring, sizeof(*log_ring));
+
+    /* Writers publish into the header from now on */
+    log_head = &log_ring->head;
+
+    /* Linux may only follow the buffer once the rest is visible */
+    log_ring->magic = TRACE_RING_MAGIC;
+    trace_flush_range(&log_ring->magic, sizeof(log_ring->magic));
+}
@@ -225,13 +225,91 @@ extern void vPortExitCritical( void );
 
 /* New added functions for AMP */
 extern void stdio_lock_init(unsigned int base, unsigned int len);
+/* Set up the header Linux follows the trace buffer with (trace_ring.h),
+ * after stdio_lock_init() */
+extern void stdio_ring_init(unsigned int ring);
 void xputs(char *str);
+/* Trace buffer of 'len' bytes at 'base' (port_trace.c), called by
+ * stdio_lock_init() */
+extern void port_trace_init(unsigned int base, unsigned int len);
+/* Write back a range Linux reads uncached, L1 and L2 */
+extern void trace_flush_range(volatile void *start, int len);
 void safe_printf(const char *format, ...);
 extern void setupIRQhandler(int int_no, void *fce, void *param);
 extern void register_handler(void *handler_priv);
 extern void swirq_to_linux(int irq, int cpu);
 extern void clearIRQhandler(int int_no);
 
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+
+/* The run time counter is the global timer (half the CPU clock) divided by
+ * 2^portRUN_TIME_SHIFT, so the 32-bit task counters wrap after some 13
+ * minutes rather than 13 seconds. Readers take differences. */
+#define portRUN_TIME_SHIFT			6
+
+extern void vPortConfigureRunTimeCounter( void );
+extern unsigned long ulPortGetRunTimeCounter( void );
+
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()	vPortConfigureRunTimeCounter()
+#define portGET_RUN_TIME_COUNTER_VALUE()			ulPortGetRunTimeCounter()
+
+#endif /* configGENERATE_RUN_TIME_STATS */
+
+/* Kernel event trace into shared memory (trace_event.h), set to 0 to leave
+ * the trace hooks out */
+#define portTRACE_EVENTS			1
+
+#if portTRACE_EVENTS
+
+#include "trace_event.h"
+
+/* Set up the event buffer of 'size' bytes (a power of two) and its header
+ * (trace_ring.h), events before are dropped */
+extern void event_trace_init(unsigned int ring, unsigned int buffer,
+		unsigned int size);
+extern void event_trace(unsigned int type, unsigned int info, unsigned int arg);
+/* Publish the events written since the last full segment, called by the
+ * tick interrupt so Linux sees them at most a tick late */
+extern void event_trace_drain(void);
+/* Called by the kernel in a critical section when a task is created or
+ * deleted. The names of the tasks alive are written again at every half of
+ * the buffer. */
+extern void event_trace_task(void *task, const signed char *name);
+extern void event_trace_task_delete(void *task);
+/* Called around IRQInterrupt by vFreeRTOS_IRQInterrupt */
+extern void event_trace_irq_enter(void);
+extern void event_trace_irq_exit(void);
+
+#define traceTASK_SWITCHED_IN() \
+	event_trace(TRACE_EVENT_SWITCH_IN, 0, (unsigned int)pxCurrentTCB)
+#define traceTASK_CREATE(pxNewTCB) \
+	event_trace_task(pxNewTCB, pxNewTCB->pcTaskName)
+#define traceTASK_DELETE(pxTaskToDelete) \
+	event_trace_task_delete(pxTaskToDelete)
+#define traceTASK_DELAY() \
+	event_trace(TRACE_EVENT_TASK_DELAY, 0, (unsigned int)pxCurrentTCB)
+#define traceTASK_DELAY_UNTIL() \
+	event_trace(TRACE_EVENT_TASK_DELAY, 0, (unsigned int)pxCurrentTCB)
+#define traceQUEUE_SEND(pxQueue) \
+	event_trace(TRACE_EVENT_QUEUE_SEND, 0, (unsigned int)pxQueue)
+#define traceQUEUE_SEND_FROM_ISR(pxQueue) \
+	event_trace(TRACE_EVENT_QUEUE_SEND, 1, (unsigned int)pxQueue)
+#define traceQUEUE_RECEIVE(pxQueue) \
+	event_trace(TRACE_EVENT_QUEUE_RECEIVE, 0, (unsigned int)pxQueue)
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue) \
+	event_trace(TRACE_EVENT_QUEUE_RECEIVE, 1, (unsigned int)pxQueue)
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue) \
+	event_trace(TRACE_EVENT_BLOCK_SEND, 0, (unsigned int)pxQueue)
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue) \
+	event_trace(TRACE_EVENT_BLOCK_RECEIVE, 0, (unsigned int)pxQueue)
+
+#else /* !portTRACE_EVENTS */
+
+#define event_trace_init(ring, buffer, size)
+#define event_trace_drain()
+
+#endif /* portTRACE_EVENTS */
+
 #ifdef __cplusplus
 }
 #endif
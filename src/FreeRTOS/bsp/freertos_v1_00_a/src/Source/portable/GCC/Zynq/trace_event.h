@@ -0,0 +1,59 @@
+/*
+ * Kernel events in memory shared between FreeRTOS and Linux.
+ * This header is common for the FreeRTOS port and the latencystat
+ * application, keep both copies the same.
+ *
+ * With portTRACE_EVENTS the trace macros of the kernel (context switches,
+ * queue and semaphore operations, blocking) and the IRQ entry of the port
+ * write one event each into the event buffer in the carveout. The buffer
+ * has a struct trace_ring header (see trace_ring.h) whose 'timestamp_freq'
+ * is the frequency of the global timer. 'latencystat -e' converts the
+ * events to a Chrome/Perfetto JSON trace.
+ *
+ * Tasks and queues are identified by the address of their TCB and queue
+ * structure. The name of a task is written when it is created and again at
+ * the start of each half of the buffer, as TRACE_EVENT_TASK_NAME events
+ * which carry the name instead of a time.
+ */
+
+#ifndef TRACE_EVENT_H
+#define TRACE_EVENT_H
+
+typedef enum {
+	/* 'arg' is the task now running */
+	TRACE_EVENT_SWITCH_IN = 1,
+	/* 'arg' is the task, 'name' holds characters 8 * 'info' to
+	 * 8 * 'info' + 7 of its name, NUL padded */
+	TRACE_EVENT_TASK_NAME,
+	TRACE_EVENT_TASK_DELETE,
+	/* The running task delays itself, 'arg' is the task */
+	TRACE_EVENT_TASK_DELAY,
+	/* 'arg' is the queue (or semaphore), 'info' is 1 from an ISR */
+	TRACE_EVENT_QUEUE_SEND,
+	TRACE_EVENT_QUEUE_RECEIVE,
+	/* The running task blocks on a full or empty queue, 'arg' is the
+	 * queue */
+	TRACE_EVENT_BLOCK_SEND,
+	TRACE_EVENT_BLOCK_RECEIVE,
+	/* 'arg' is the interrupt ID */
+	TRACE_EVENT_IRQ_ENTER,
+	TRACE_EVENT_IRQ_EXIT,
+} trace_event_type;
+
+struct trace_event
+{
+	union {
+		/* Global timer ticks */
+		unsigned long long time;
+		/* TRACE_EVENT_TASK_NAME only */
+		char name[8];
+	};
+	/* trace_event_type */
+	unsigned short type;
+	/* Depends on the type, 0 if unused */
+	unsigned short info;
+	/* Task (TCB address), queue address or interrupt ID */
+	unsigned int arg;
+};
+
+#endif /* TRACE_EVENT_H */
@@ -0,0 +1,58 @@
+/*
+ * Header of the trace buffer in memory shared between FreeRTOS and Linux.
+ * This header is common for the FreeRTOS port and the latencystat
+ * application, keep both copies the same.
+ *
+ * xputs() writes the text into the trace buffer, wrapping around at its
+ * end, and publishes in 'head' how many bytes it has written so far. A
+ * reader on Linux keeps the number of bytes it has read in 'tail' and reads
+ * what lies in between, so it can follow the trace like 'tail -f' instead of
+ * reading the whole buffer again. The writer never waits for the reader:
+ * when 'head - tail' exceeds the size, the oldest unread text has been
+ * overwritten.
+ *
+ * The header is placed next to the trace buffer, not in it, so the trace
+ * resource seen by the remoteproc driver (debugfs trace0) stays plain text.
+ * The producer and the consumer fields are each alone in a cache line so
+ * the two sides never write to the same line.
+ */
+
+#ifndef TRACE_RING_H
+#define TRACE_RING_H
+
+/* "TRNG", written last when the header is set up */
+#define TRACE_RING_MAGIC		0x474e5254
+
+/* Cache line size of the Cortex-A9 L1 and of the PL310 */
+#define TRACE_RING_CACHE_LINE	32
+
+struct trace_ring
+{
+	/* Set up once by FreeRTOS */
+	unsigned int magic;
+	/* Physical address and size of the trace buffer, the size is a power
+	 * of two */
+	unsigned int buffer;
+	unsigned int size;
+	/* Ticks per second of the timestamps in the records of a binary log
+	 * (see binlog_record.h), 0 for a text buffer */
+	unsigned int timestamp_freq;
+	unsigned int reserved[TRACE_RING_CACHE_LINE / 4 - 4];
+
+	/* Written by FreeRTOS only */
+	/* Bytes written since FreeRTOS started, free running */
+	volatile unsigned int head;
+	/* Times the write position went back to the start of the buffer */
+	volatile unsigned int wraps;
+	/* Writes which overwrote text not yet read (every write after the
+	 * first wrap while nobody reads). Only kept by the trace buffer, the
+	 * binary log and the kernel event ring leave it 0. */
+	volatile unsigned int overruns;
+	unsigned int head_pad[TRACE_RING_CACHE_LINE / 4 - 3];
+
+	/* Written by the reader only: bytes read, free running */
+	volatile unsigned int tail;
+	unsigned int tail_pad[TRACE_RING_CACHE_LINE / 4 - 1];
+};
+
+#endif /* TRACE_RING_H */
@@ -410,6 +410,17 @@ static tskTCB *prvAllocateTCBAndStack( unsigned short usStackDepth, portSTACK_TY
 
 #endif
 
+/*
+ * Called from uxTaskGetSnapshot.  Fills in the entries of pxTaskArray from
+ * uxIndex on with the tasks in pxList, and returns the index following the
+ * last task.
+ */
+#if ( configUSE_TRACE_FACILITY == 1 )
+
+	static unsigned portBASE_TYPE prvSnapshotTasksWithinSingleList( xTaskSnapshot *pxTaskArray, unsigned portBASE_TYPE uxArraySize, unsigned portBASE_TYPE uxIndex, xList *pxList, signed char cStatus, unsigned long ulTotalRunTime ) PRIVILEGED_FUNCTION;
+
+#endif
+
 /*
  * When a task is created, the stack of the task is filled with a known value.
  * This function determines the 'high water mark' of the task stack by
@@ -1445,6 +1456,82 @@ unsigned portBASE_TYPE uxTaskGetNumberOfTasks( void )
 #endif
 /*----------------------------------------------------------*/
 
+#if ( configUSE_TRACE_FACILITY == 1 )
+
+	unsigned portBASE_TYPE uxTaskGetSnapshot( xTaskSnapshot *pxTaskArray, unsigned portBASE_TYPE uxArraySize, unsigned long *pulTotalRunTime )
+	{
+	unsigned portBASE_TYPE uxQueue;
+	unsigned portBASE_TYPE uxIndex = ( unsigned portBASE_TYPE ) 0U;
+	unsigned long ulTotalRunTime = 0UL;
+
+		configASSERT( pxTaskArray );
+
+		vTaskSuspendAll();
+		{
+			#if ( configGENERATE_RUN_TIME_STATS == 1 )
+			{
+				#ifdef portALT_GET_RUN_TIME_COUNTER_VALUE
+					portALT_GET_RUN_TIME_COUNTER_VALUE( ulTotalRunTime );
+				#else
+					ulTotalRunTime = portGET_RUN_TIME_COUNTER_VALUE();
+				#endif
+			}
+			#endif
+
+			/* The same lists in the same order as vTaskList(). */
+			uxQueue = uxTopUsedPriority + ( unsigned portBASE_TYPE ) 1U;
+
+			do
+			{
+				uxQueue--;
+
+				if( listLIST_IS_EMPTY( &( pxReadyTasksLists[ uxQueue ] ) ) == pdFALSE )
+				{
+					uxIndex = prvSnapshotTasksWithinSingleList( pxTaskArray, uxArraySize, uxIndex, ( xList * ) &( pxReadyTasksLists[ uxQueue ] ), tskREADY_CHAR, ulTotalRunTime );
+				}
+			}while( uxQueue > ( unsigned short ) tskIDLE_PRIORITY );
+
+			if( listLIST_IS_EMPTY( pxDelayedTaskList ) == pdFALSE )
+			{
+				uxIndex = prvSnapshotTasksWithinSingleList( pxTaskArray, uxArraySize, uxIndex, ( xList * ) pxDelayedTaskList, tskBLOCKED_CHAR, ulTotalRunTime );
+			}
+
+			if( listLIST_IS_EMPTY( pxOverflowDelayedTaskList ) == pdFALSE )
+			{
+				uxIndex = prvSnapshotTasksWithinSingleList( pxTaskArray, uxArraySize, uxIndex, ( xList * ) pxOverflowDelayedTaskList, tskBLOCKED_CHAR, ulTotalRunTime );
+			}
+
+			#if( INCLUDE_vTaskDelete == 1 )
+			{
+				if( listLIST_IS_EMPTY( &xTasksWaitingTermination ) == pdFALSE )
+				{
+					uxIndex = prvSnapshotTasksWithinSingleList( pxTaskArray, uxArraySize, uxIndex, &xTasksWaitingTermination, tskDELETED_CHAR, ulTotalRunTime );
+				}
+			}
+			#endif
+
+			#if ( INCLUDE_vTaskSuspend == 1 )
+			{
+				if( listLIST_IS_EMPTY( &xSuspendedTaskList ) == pdFALSE )
+				{
+					uxIndex = prvSnapshotTasksWithinSingleList( pxTaskArray, uxArraySize, uxIndex, &xSuspendedTaskList, tskSUSPENDED_CHAR, ulTotalRunTime );
+				}
+			}
+			#endif
+		}
+		xTaskResumeAll();
+
+		if( pulTotalRunTime != NULL )
+		{
+			*pulTotalRunTime = ulTotalRunTime;
+		}
+
+		return uxIndex;
+	}
+
+#endif
+/*----------------------------------------------------------*/
+
 #if ( configUSE_TRACE_FACILITY == 1 )
 
 	void vTaskStartTrace( signed char * pcBuffer, unsigned long ulBufferSize )
@@ -2224,6 +2311,67 @@ tskTCB *pxNewTCB;
 #endif
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_TRACE_FACILITY == 1 )
+
+	static unsigned portBASE_TYPE prvSnapshotTasksWithinSingleList( xTaskSnapshot *pxTaskArray, unsigned portBASE_TYPE uxArraySize, unsigned portBASE_TYPE uxIndex, xList *pxList, signed char cStatus, unsigned long ulTotalRunTime )
+	{
+	volatile tskTCB *pxNextTCB, *pxFirstTCB;
+	xTaskSnapshot *pxSnapshot;
+
+		( void ) ulTotalRunTime;
+
+		listGET_OWNER_OF_NEXT_ENTRY( pxFirstTCB, pxList );
+		do
+		{
+			listGET_OWNER_OF_NEXT_ENTRY( pxNextTCB, pxList );
+
+			/* Tasks beyond uxArraySize are counted but not written. */
+			if( uxIndex < uxArraySize )
+			{
+				pxSnapshot = &( pxTaskArray[ uxIndex ] );
+				pxSnapshot->xHandle = ( xTaskHandle ) pxNextTCB;
+				strncpy( ( char * ) pxSnapshot->pcTaskName, ( const char * ) pxNextTCB->pcTaskName, ( unsigned short ) configMAX_TASK_NAME_LEN );
+				pxSnapshot->uxTaskNumber = pxNextTCB->uxTCBNumber;
+				pxSnapshot->cStatus = cStatus;
+				pxSnapshot->uxPriority = pxNextTCB->uxPriority;
+
+				#if ( portSTACK_GROWTH > 0 )
+				{
+					pxSnapshot->usStackHighWaterMark = usTaskCheckFreeStackSpace( ( unsigned char * ) pxNextTCB->pxEndOfStack );
+				}
+				#else
+				{
+					pxSnapshot->usStackHighWaterMark = usTaskCheckFreeStackSpace( ( unsigned char * ) pxNextTCB->pxStack );
+				}
+				#endif
+
+				#if ( configGENERATE_RUN_TIME_STATS == 1 )
+				{
+					pxSnapshot->ulRunTimeCounter = pxNextTCB->ulRunTimeCounter;
+
+					/* The calling task has been running since it was last
+					switched in, which is not accounted for yet. */
+					if( pxNextTCB == pxCurrentTCB )
+					{
+						pxSnapshot->ulRunTimeCounter += ( ulTotalRunTime - ulTaskSwitchedInTime );
+					}
+				}
+				#else
+				{
+					pxSnapshot->ulRunTimeCounter = 0UL;
+				}
+				#endif
+			}
+			uxIndex++;
+
+		} while( pxNextTCB != pxFirstTCB );
+
+		return uxIndex;
+	}
+
+#endif
+/*-----------------------------------------------------------*/
+
 #if ( configGENERATE_RUN_TIME_STATS == 1 )
 
 	static void prvGenerateRunTimeStatsForTasksInList( const signed char *pcWriteBuffer, xList *pxList, unsigned long ulTotalRunTime )
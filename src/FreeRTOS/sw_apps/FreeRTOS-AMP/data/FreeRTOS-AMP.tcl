@@ -25,6 +25,28 @@ proc swapp_is_supported_sw {} {
 # depending on the type of os (standalone|xilkernel), choose
 # the correct source files
 proc swapp_generate {} {
+    if { [file exists [file join src remoteproc_config.h]] } {
+        remoteproc_generate_ldconfig src
+    }
+}
+
+# Generate the linker script fragment 'remoteproc_config.ld' from the
+# '#define NAME value' lines of 'remoteproc_config.h', so the C code and the
+# linker script share one definition of the shared memory layout.
+proc remoteproc_generate_ldconfig { srcdir } {
+    set in [open [file join $srcdir remoteproc_config.h] r]
+    set out [open [file join $srcdir remoteproc_config.ld] w]
+
+    puts $out "/* Generated from remoteproc_config.h by FreeRTOS-AMP.tcl, do not edit. */"
+    puts $out ""
+    while { [gets $in line] >= 0 } {
+        if { [regexp {^#define\s+([A-Z0-9_]+)\s+((0x)?[0-9A-Fa-f]+)\s*$} $line -> name value] } {
+            puts $out "$name = $value;"
+        }
+    }
+
+    close $in
+    close $out
 }
 
 proc swapp_get_linker_constraints {} {
@@ -32,3 +54,8 @@ proc swapp_get_linker_constraints {} {
     return "lscript no";
 }
 
+# Allow running the generator outside of the SDK:
+#   tclsh FreeRTOS-AMP.tcl <app src directory>
+if { [info exists argv0] && [file tail $argv0] == [file tail [info script]] } {
+    remoteproc_generate_ldconfig [lindex $argv 0]
+}
@@ -0,0 +1,121 @@
+/*
+ * Lock-free primitives built on the Cortex-A9 exclusive monitor
+ * (LDREX/STREX) and the DMB barrier.
+ *
+ * They can be used from tasks and from interrupt handlers alike. The port
+ * clears the exclusive monitor on every context switch and interrupt entry
+ * ('clrex' in portISR.c), so an interrupted LDREX/STREX sequence retries.
+ *
+ * When not compiling for ARM the GCC atomic builtins are used instead, which
+ * allows building the transport on a host.
+ */
+
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+#ifdef __arm__
+
+/* Full memory barrier, orders all memory accesses (also towards Linux) */
+static inline void smp_mb(void)
+{
+	__asm__ __volatile__("dmb" : : : "memory");
+}
+
+/*
+ * Atomically replace *ptr with 'new' if it equals 'old'.
+ * @return:
+ *  the previous value of *ptr, the exchange happened if it equals 'old'
+ */
+static inline unsigned int atomic_cmpxchg(volatile unsigned int *ptr,
+		unsigned int old, unsigned int new)
+{
+	unsigned int prev;
+	unsigned int fail;
+
+	smp_mb();
+	do {
+		__asm__ __volatile__(
+			"ldrex		%0, [%2]\n"
+			"mov		%1, #0\n"
+			"teq		%0, %3\n"
+			"strexeq	%1, %4, [%2]\n"
+			: "=&r" (prev), "=&r" (fail)
+			: "r" (ptr), "r" (old), "r" (new)
+			: "memory", "cc");
+	} while (fail);
+	smp_mb();
+
+	return prev;
+}
+
+/* Atomically add 'val' to *ptr and return the new value */
+static inline unsigned int atomic_add_return(volatile unsigned int *ptr,
+		unsigned int val)
+{
+	unsigned int result;
+	unsigned int fail;
+
+	smp_mb();
+	do {
+		__asm__ __volatile__(
+			"ldrex		%0, [%2]\n"
+			"add		%0, %0, %3\n"
+			"strex		%1, %0, [%2]\n"
+			: "=&r" (result), "=&r" (fail)
+			: "r" (ptr), "r" (val)
+			: "memory", "cc");
+	} while (fail);
+	smp_mb();
+
+	return result;
+}
+
+/* Atomically add 'val' to the 64-bit *ptr, which must be 8 byte aligned */
+static inline void atomic64_add(volatile unsigned long long *ptr,
+		unsigned long long val)
+{
+	unsigned long long result;
+	unsigned int fail;
+
+	smp_mb();
+	do {
+		__asm__ __volatile__(
+			"ldrexd		%0, %H0, [%2]\n"
+			"adds		%Q0, %Q0, %Q3\n"
+			"adc		%R0, %R0, %R3\n"
+			"strexd		%1, %0, %H0, [%2]\n"
+			: "=&r" (result), "=&r" (fail)
+			: "r" (ptr), "r" (val)
+			: "memory", "cc");
+	} while (fail);
+	smp_mb();
+}
+
+#else /* !__arm__ */
+
+static inline void smp_mb(void)
+{
+	__sync_synchronize();
+}
+
+static inline unsigned int atomic_cmpxchg(volatile unsigned int *ptr,
+		unsigned int old, unsigned int new)
+{
+	return __sync_val_compare_and_swap(ptr, old, new);
+}
+
+static inline unsigned int atomic_add_return(volatile unsigned int *ptr,
+		unsigned int val)
+{
+	return __sync_add_and_fetch(ptr, val);
+}
+
+static inline void atomic64_add(volatile unsigned long long *ptr,
+		unsigned long long val)
+{
+	__sync_add_and_fetch(ptr, val);
+}
+
+#endif /* __arm__ */
+
+#endif /* ATOMIC_H */
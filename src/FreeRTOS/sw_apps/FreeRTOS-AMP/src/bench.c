@@ -0,0 +1,246 @@
+/*
+ * Transport benchmark service.
+ *
+ * The service answers the commands of 'latencystat --bench' (see
+ * latencydemo.h) to measure the rpmsg transport itself:
+ *
+ * - BENCH_ECHO returns the message and fills in when it passed each stage
+ *   on the way through FreeRTOS, so the round trip can be broken down.
+ * - BENCH_SINK and BENCH_SOURCE measure one direction at a time.
+ * - BENCH_BULK streams data through the bulk channel (spsc.h) instead.
+ * - BENCH_POLL sets the poll budget of the RX vring.
+ * - BENCH_STATS returns the counters of the service and the transport.
+ *
+ * The handler runs in the RX vring task and never waits there. An echo or
+ * stats response which finds the TX ring full is dropped, the echoes lost
+ * this way are counted in struct bench_stats. BENCH_SOURCE
+ * and BENCH_BULK take as long as Linux takes to read the data, they are
+ * passed to the BENCH task at a low priority. One of them runs at a time,
+ * another one which arrives meanwhile is dropped.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "xil_printf.h"
+
+#include "remoteproc_kernel.h"
+#include "remoteproc.h"
+#include "timestamp.h"
+#include "spsc.h"
+#include "latencydemo.h"
+#include "bench.h"
+#include "logging.h"
+
+static unsigned int bench_rx_messages = 0;
+static unsigned long long bench_rx_bytes = 0;
+static unsigned int bench_echo_dropped = 0;
+
+/* Largest write to the bulk channel, the pattern holds two of them so a
+ * write can start at any offset */
+#define BENCH_BULK_CHUNK	256
+static unsigned char bench_pattern[2 * BENCH_BULK_CHUNK];
+
+/* A BENCH_SOURCE or BENCH_BULK for the BENCH task, with the addresses to
+ * answer to */
+struct bench_job {
+	unsigned int src;
+	unsigned int dst;
+	struct bench_msg msg;
+};
+
+static xQueueHandle bench_queue;
+
+/* The messages are written straight into the TX buffers */
+static void bench_source(struct bench_job* job, unsigned int count,
+		unsigned int len)
+{
+	struct remoteproc_tx_buffer buf;
+	struct bench_msg* msg;
+	unsigned int i;
+
+	if (len < sizeof(struct bench_msg)) {
+		len = sizeof(struct bench_msg);
+	}
+
+	for (i = 0; i < count; i++) {
+		remoteproc_reserve(&buf, portMAX_DELAY);
+		if (len > buf.size) {
+			len = buf.size;
+		}
+		msg = (struct bench_msg*)buf.data;
+		memset(msg, 0, len);
+		msg->cmd = BENCH_SOURCE;
+		msg->seq = i;
+		msg->count = count;
+		msg->len = len;
+		msg->t_send = timestamp_read();
+		remoteproc_commit(&buf, job->src, job->dst, len);
+	}
+}
+
+static void bench_bulk(unsigned int count)
+{
+	unsigned long long progress = timestamp_read();
+	unsigned int sent = 0;
+	unsigned int len;
+
+	while (sent < count) {
+		len = count - sent;
+		if (len > BENCH_BULK_CHUNK) {
+			len = BENCH_BULK_CHUNK;
+		}
+		len = spsc_write(BULK_CHANNEL, &bench_pattern[sent & 0xff], len);
+		if (len != 0) {
+			progress = timestamp_read();
+		} else if (timestamp_read() - progress > TIMESTAMP_FREQ) {
+			/* Nobody reads the channel any more */
+			log_warning(LOG_CAT_BENCH, "bench: Bulk channel stalled\r\n");
+			break;
+		} else {
+			/* Full, Linux polls the channel */
+			taskYIELD();
+		}
+		sent += len;
+	}
+}
+
+static void bench_task(void* param)
+{
+	struct bench_job job;
+
+	for (;;) {
+		if (xQueueReceive(bench_queue, &job, portMAX_DELAY) != pdTRUE) {
+			continue;
+		}
+		if (job.msg.cmd == BENCH_SOURCE) {
+			bench_source(&job, job.msg.count, job.msg.len);
+		} else {
+			bench_bulk(job.msg.count);
+		}
+	}
+}
+
+/* Pass a long running command to the BENCH task */
+static void bench_queue_job(struct remoteproc_request* req,
+		struct bench_msg* msg)
+{
+	struct bench_job job;
+
+	job.src = req->__hdr->dst;
+	job.dst = req->__hdr->src;
+	job.msg = *msg;
+	if (xQueueSend(bench_queue, &job, 0) != pdTRUE) {
+		log_warning(LOG_CAT_BENCH, "bench: Busy, request dropped\r\n");
+	}
+}
+
+static void bench_handler(struct remoteproc_request* req, unsigned char* data,
+		unsigned int len)
+{
+	unsigned long long t_handler = timestamp_read();
+	struct remoteproc_stats transport;
+	struct remoteproc_tx_buffer buf;
+	struct bench_stats* stats;
+	struct bench_msg msg;
+
+	if (len < sizeof(unsigned int)) {
+		return;
+	}
+	bench_rx_messages++;
+	bench_rx_bytes += len;
+
+	switch (req->state)
+	{
+		case BENCH_ECHO:
+			if (len < sizeof(msg)) {
+				break;
+			}
+			/* The data may be unaligned when it came in a descriptor chain */
+			memcpy(&msg, data, sizeof(msg));
+			msg.t_kick = req->kick_time;
+			msg.t_task = req->task_time;
+			msg.t_handler = t_handler;
+			/* Like BENCH_STATS, the echo is lost if the TX ring is full */
+			if (remoteproc_try_reserve(&buf) < 0) {
+				bench_echo_dropped++;
+				break;
+			}
+			if (len > buf.size) {
+				len = buf.size;
+			}
+			msg.t_send = timestamp_read();
+			memcpy(buf.data, &msg, sizeof(msg));
+			memcpy(buf.data + sizeof(msg), data + sizeof(msg),
+					len - sizeof(msg));
+			remoteproc_commit(&buf, req->__hdr->dst, req->__hdr->src, len);
+			break;
+		case BENCH_SINK:
+			break;
+		case BENCH_SOURCE:
+			if (len < sizeof(msg)) {
+				break;
+			}
+			memcpy(&msg, data, sizeof(msg));
+			bench_queue_job(req, &msg);
+			break;
+		case BENCH_STATS:
+			remoteproc_get_stats(&transport);
+			/* Filled in in the TX buffer. Linux gets no answer if the TX
+			 * ring is full, waiting for it would hold up the RX task. */
+			if (remoteproc_try_reserve(&buf) < 0) {
+				log_warning(LOG_CAT_BENCH, "bench: TX ring full\r\n");
+				break;
+			}
+			stats = (struct bench_stats*)buf.data;
+			memset(stats, 0, sizeof(*stats));
+			stats->rx_messages = bench_rx_messages;
+			stats->rx_bytes = bench_rx_bytes;
+			stats->tx_messages = transport.tx_messages;
+			stats->tx_full = transport.tx_full;
+			stats->tx_time = transport.tx_time;
+			stats->rx_polled = transport.rx_polled;
+			stats->rx_woken = transport.rx_woken;
+			stats->timestamp_freq = TIMESTAMP_FREQ;
+			stats->echo_dropped = bench_echo_dropped;
+			remoteproc_commit(&buf, req->__hdr->dst, req->__hdr->src,
+					sizeof(*stats));
+			break;
+		case BENCH_BULK:
+			if (len < sizeof(msg)) {
+				break;
+			}
+			memcpy(&msg, data, sizeof(msg));
+			bench_queue_job(req, &msg);
+			break;
+		case BENCH_POLL:
+			if (len < sizeof(msg)) {
+				break;
+			}
+			memcpy(&msg, data, sizeof(msg));
+			remoteproc_set_poll_budget(msg.count);
+			break;
+		default:
+			log_warning(LOG_CAT_BENCH, "bench: Unimplemented request\r\n");
+	}
+}
+
+void bench_init(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(bench_pattern); i++) {
+		bench_pattern[i] = (unsigned char)i;
+	}
+	bench_queue = xQueueCreate(1, sizeof(struct bench_job));
+	if (bench_queue == NULL) {
+		xil_printf("ERROR: Failed to create the benchmark queue!\r\n");
+		return;
+	}
+	xTaskCreate(bench_task, (signed char*)"BENCH", configMINIMAL_STACK_SIZE,
+			NULL, tskIDLE_PRIORITY + 1, NULL);
+	remoteproc_register_endpoint(BENCH_APP_SERVICE_NAME, BENCH_APP_ADDR,
+			&bench_handler);
+}
@@ -0,0 +1,14 @@
+/* Transport benchmark service, see bench.c */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+/* Address of the benchmark service. It uses the service name of the demo so
+ * the same Linux driver binds to it and creates a second device for it. */
+#define BENCH_APP_ADDR 0x51
+#define BENCH_APP_SERVICE_NAME "rpmsg-timer-statistic"
+
+/* Register the benchmark service, call after remoteproc_init() */
+void bench_init(void);
+
+#endif /* BENCH_H */
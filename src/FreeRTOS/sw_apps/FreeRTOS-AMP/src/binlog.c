@@ -0,0 +1,171 @@
+/*
+ * Binary log, see binlog.h.
+ *
+ * Each record fills one cache line of the buffer and is written in place.
+ * Like the kernel events of the port, records are written back to memory and
+ * published in segments of BINLOG_FLUSH_SIZE bytes, the rest by binlog_drain()
+ * from the tick, so a record costs no cache maintenance of its own and Linux
+ * never sees half a record. Interrupts are masked while a record is written,
+ * which makes binlog() safe from tasks and from interrupt handlers alike.
+ *
+ * Like xputs(), the writer never waits for Linux and overwrites the oldest
+ * records when nobody reads them. 'overruns' of the header is not kept: it
+ * would take dropping the tail from the cache for every record, the reader
+ * counts what it has lost itself.
+ */
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include "FreeRTOS.h"
+
+#include "atomic.h"
+#include "cache.h"
+#include "timestamp.h"
+#include "binlog.h"
+
+#if BINLOG_ENABLE
+
+/* Records are written back to memory and published in segments of this
+ * many bytes (a power of two, at most the buffer size) */
+#define BINLOG_FLUSH_SIZE		512
+
+/* NULL until binlog_init() */
+static struct trace_ring* binlog_ring = NULL;
+static unsigned char* binlog_buffer;
+/* Bytes written */
+static unsigned int binlog_head = 0;
+/* Bytes written back and published in binlog_ring->head */
+static unsigned int binlog_published = 0;
+
+#ifdef __arm__
+
+/* Mask IRQ and FIQ and return the previous CPSR. Unlike
+ * portENTER_CRITICAL() it nests and may be used in interrupt handlers. */
+static inline unsigned int binlog_lock(void)
+{
+	unsigned int cpsr;
+
+	__asm__ __volatile__(
+		"mrs	%0, cpsr\n"
+		"cpsid	if\n"
+		: "=r" (cpsr) : : "memory");
+	return cpsr;
+}
+
+static inline void binlog_unlock(unsigned int cpsr)
+{
+	__asm__ __volatile__("msr	cpsr_c, %0" : : "r" (cpsr) : "memory");
+}
+
+#else /* !__arm__ */
+
+static inline unsigned int binlog_lock(void)
+{
+	portENTER_CRITICAL();
+	return 0;
+}
+
+static inline void binlog_unlock(unsigned int cpsr)
+{
+	portEXIT_CRITICAL();
+}
+
+#endif /* __arm__ */
+
+/* Write back the records since the last publish and move the head past
+ * them. They never cross the end of the buffer, a segment boundary comes
+ * first. Called with interrupts masked. */
+static void binlog_publish(struct trace_ring* ring)
+{
+	unsigned int len = binlog_head - binlog_published;
+
+	if (len == 0) {
+		return;
+	}
+	cache_sync_to_linux(binlog_buffer +
+			(binlog_published & (BINLOG_BUFFER_SIZE - 1)), len);
+	binlog_published = binlog_head;
+
+	/* Publish the records once they are in memory */
+	smp_mb();
+	ring->head = binlog_head;
+	cache_sync_to_linux(&ring->head, TRACE_RING_CACHE_LINE);
+}
+
+void binlog_init(void)
+{
+	struct trace_ring* ring = BINLOG_RING;
+
+	timestamp_init();
+	binlog_buffer = (unsigned char*)BINLOG_BUFFER_START;
+
+	ring->magic = 0;
+	ring->buffer = BINLOG_BUFFER_START;
+	ring->size = BINLOG_BUFFER_SIZE;
+	ring->timestamp_freq = TIMESTAMP_FREQ;
+	ring->head = 0;
+	ring->wraps = 0;
+	ring->overruns = 0;
+	ring->tail = 0;
+	cache_sync_to_linux(ring, sizeof(*ring));
+
+	/* Linux may only read the log once the rest is visible */
+	smp_mb();
+	ring->magic = TRACE_RING_MAGIC;
+	cache_sync_to_linux(&ring->magic, sizeof(ring->magic));
+	binlog_ring = ring;
+}
+
+void binlog_write(const char* format, unsigned int nargs, ...)
+{
+	struct trace_ring* ring = binlog_ring;
+	struct binlog_record* rec;
+	unsigned int cpsr;
+	unsigned int head;
+	unsigned int i;
+	va_list ap;
+
+	if (ring == NULL) {
+		return;
+	}
+	if (nargs > BINLOG_ARGS_MAX) {
+		nargs = BINLOG_ARGS_MAX;
+	}
+
+	cpsr = binlog_lock();
+	head = binlog_head;
+	rec = (void*)(binlog_buffer + (head & (BINLOG_BUFFER_SIZE - 1)));
+	rec->format = (unsigned long)format;
+	rec->nargs = nargs;
+	rec->time = timestamp_read();
+	va_start(ap, nargs);
+	for (i = 0; i < nargs; i++) {
+		rec->args[i] = va_arg(ap, unsigned int);
+	}
+	va_end(ap);
+
+	head += sizeof(*rec);
+	binlog_head = head;
+	if ((head & (BINLOG_BUFFER_SIZE - 1)) == 0) {
+		ring->wraps++;
+	}
+	if ((head & (BINLOG_FLUSH_SIZE - 1)) == 0) {
+		binlog_publish(ring);
+	}
+	binlog_unlock(cpsr);
+}
+
+void binlog_drain(void)
+{
+	struct trace_ring* ring = binlog_ring;
+	unsigned int cpsr;
+
+	if (ring == NULL) {
+		return;
+	}
+	cpsr = binlog_lock();
+	binlog_publish(ring);
+	binlog_unlock(cpsr);
+}
+
+#endif /* BINLOG_ENABLE */
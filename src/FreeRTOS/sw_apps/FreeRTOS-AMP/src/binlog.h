@@ -0,0 +1,73 @@
+/*
+ * Binary log, a cheap replacement of safe_printf() for hot paths.
+ *
+ *   binlog("rpc: opcode %u took %u ticks\r\n", opcode, ticks);
+ *
+ * stores a timestamp, the address of the format string and the arguments as
+ * one record in the binary log in the carveout (see binlog_record.h). There
+ * is no formatting, no string copy and no stdio lock on FreeRTOS, the text
+ * is put together on Linux by 'latencystat -l' with the format strings from
+ * the firmware image.
+ *
+ * The format has to be a string literal and may take up to BINLOG_ARGS_MAX
+ * arguments of at most 32 bits: integers (%d, %u, %x, %c, ...) or strings
+ * which are constant in the firmware image (%s), a call with more arguments
+ * does not build. binlog() may be called from tasks and from interrupt
+ * handlers once binlog_init() has run. Records reach Linux in batches, at
+ * the latest with the next binlog_drain() from the tick hook.
+ */
+
+#ifndef BINLOG_H
+#define BINLOG_H
+
+#include "trace_ring.h"
+#include "binlog_record.h"
+#include "remoteproc_kernel.h"
+
+/* Set to 0 to leave the binary log out */
+#define BINLOG_ENABLE			1
+
+/* Header of the binary log in the carveout, see lscript.ld */
+#define BINLOG_RING				((struct trace_ring *)BINLOG_RING_START)
+
+#if BINLOG_ENABLE
+
+/* Number of arguments passed to binlog(), counted up to 8 so that too many
+ * arguments are caught below instead of being dropped silently */
+#define BINLOG_NARGS(...) \
+	BINLOG_NARGS_(_, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define BINLOG_NARGS_(_, a1, a2, a3, a4, a5, a6, a7, a8, n, ...)	n
+
+/* The number of arguments, the array size turns negative and stops the
+ * build when there are more than BINLOG_ARGS_MAX */
+#define BINLOG_NARGS_CHECKED(...) \
+	(BINLOG_NARGS(__VA_ARGS__) + 0 * sizeof(char[ \
+		BINLOG_NARGS(__VA_ARGS__) <= BINLOG_ARGS_MAX ? 1 : -1]))
+
+#define binlog(format, ...) \
+	binlog_write(format, BINLOG_NARGS_CHECKED(__VA_ARGS__), ##__VA_ARGS__)
+
+/* Set up the binary log, first thing in main() */
+void binlog_init(void);
+
+/* Append a record with 'nargs' unsigned int arguments, use binlog() */
+void binlog_write(const char* format, unsigned int nargs, ...);
+
+/* Publish the records not handed to Linux yet, from vApplicationTickHook() */
+void binlog_drain(void);
+
+#else /* !BINLOG_ENABLE */
+
+#define binlog(format, ...)		do { } while (0)
+
+static inline void binlog_init(void)
+{
+}
+
+static inline void binlog_drain(void)
+{
+}
+
+#endif /* BINLOG_ENABLE */
+
+#endif /* BINLOG_H */
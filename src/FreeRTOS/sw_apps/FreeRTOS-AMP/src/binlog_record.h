@@ -0,0 +1,35 @@
+/*
+ * Records of the binary log in memory shared between FreeRTOS and Linux.
+ * This header is common for the FreeRTOS application and the latencystat
+ * application, keep both copies the same.
+ *
+ * The binary log is a second trace buffer with a struct trace_ring header
+ * (see trace_ring.h), which holds records instead of text. A record keeps
+ * the address of the printf format string in the firmware image and the raw
+ * arguments, the text is only formatted on Linux: latencystat looks the
+ * format string up in the loaded sections of the firmware ELF.
+ *
+ * Every record is one cache line, so the buffer holds a whole number of
+ * them and a record is never split at the end of the buffer. 'head' and
+ * 'tail' always advance by whole records.
+ */
+
+#ifndef BINLOG_RECORD_H
+#define BINLOG_RECORD_H
+
+/* Arguments of one record, each is one 32-bit word */
+#define BINLOG_ARGS_MAX			4
+
+struct binlog_record
+{
+	/* Address of the format string in the firmware image */
+	unsigned int format;
+	/* Arguments used in 'args' */
+	unsigned int nargs;
+	/* Global timer ticks, see 'timestamp_freq' of the header */
+	unsigned long long time;
+	/* A %s argument is the address of a string in the firmware image */
+	unsigned int args[BINLOG_ARGS_MAX];
+};
+
+#endif /* BINLOG_RECORD_H */
@@ -0,0 +1,45 @@
+/*
+ * Cache maintenance for memory shared with Linux.
+ *
+ * Linux maps the vrings, the rpmsg buffers and the trace buffer uncached, so
+ * its accesses neither see the L1 of this CPU nor the PL310 L2. Instead of
+ * flushing the whole L1 by set/way, only the cache lines of the descriptor,
+ * ring entry or buffer being handed over are maintained, in L1 and in L2
+ * (by address, the memory is identity mapped).
+ *
+ * Writing to Linux goes from the inside out: L1 is cleaned and invalidated
+ * before the PL310, so no dirty L1 line is left to be written to L2 later.
+ *
+ * Reading from Linux goes from the outside in: L1 is cleaned first, so the
+ * PL310 holds everything this CPU has written, then the PL310 lines are
+ * cleaned and invalidated, and L1 is invalidated last. A linefill of L1
+ * between the first two steps, speculative or by the caller, could else be
+ * served from the stale PL310 line. Invalidating without cleaning could
+ * discard data of this CPU sharing a partial cache line with the range.
+ * Cleaning a line this CPU has not written to does not write anything back,
+ * so reading data from Linux is safe as long as a buffer is synced to Linux
+ * before it is given back (which also drops lines a handler has dirtied
+ * meanwhile).
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "xil_cache_l.h"
+
+/* Write the range back to memory before Linux reads it */
+static inline void cache_sync_to_linux(volatile void *addr, unsigned int len)
+{
+	Xil_L1DCacheFlushRange((unsigned long)addr, len);
+	Xil_L2CacheFlushRange((unsigned long)addr, len);
+}
+
+/* Drop cached copies of the range before reading what Linux wrote to it */
+static inline void cache_sync_from_linux(volatile void *addr, unsigned int len)
+{
+	Xil_L1DCacheFlushRange((unsigned long)addr, len);
+	Xil_L2CacheFlushRange((unsigned long)addr, len);
+	Xil_L1DCacheInvalidateRange((unsigned long)addr, len);
+}
+
+#endif /* CACHE_H */
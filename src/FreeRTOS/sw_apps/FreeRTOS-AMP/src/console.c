@@ -0,0 +1,99 @@
+/*
+ * Buffered serial console, see console.h.
+ *
+ * Writers are tasks and interrupt handlers, the reader is the tick
+ * interrupt. Both sides keep interrupts masked while they touch the ring or
+ * the UART, which is a few instructions per character: a writer never waits
+ * for the UART. A character goes straight into the FIFO when nothing is
+ * queued before it and the FIFO has room, so short messages are sent at
+ * once and only the rest waits for the next tick.
+ *
+ * The TX FIFO holds 64 characters, the tick drains at most that much, about
+ * 6400 characters per second at the default tick rate of 100 Hz.
+ */
+
+#include "FreeRTOS.h"
+#include "xparameters.h"
+#include "xuartps_hw.h"
+
+#include "console.h"
+
+#if configUSE_TICK_HOOK == 0
+#error "The console is drained by vApplicationTickHook(), set use_tick_hook"
+#endif
+
+#define CONSOLE_MASK			(CONSOLE_BUFFER_SIZE - 1)
+
+static char console_buffer[CONSOLE_BUFFER_SIZE];
+
+/* Running counts, the number of queued characters is head - tail */
+static unsigned int console_head;
+static unsigned int console_tail;
+static unsigned int console_drops;
+
+/* Mask IRQ and FIQ and return the previous state, usable in any context */
+static inline unsigned int console_lock(void)
+{
+	unsigned int cpsr;
+
+	__asm__ __volatile__(
+		"mrs	%0, cpsr\n"
+		"cpsid	if\n"
+		: "=r" (cpsr) : : "memory");
+	return cpsr;
+}
+
+static inline void console_unlock(unsigned int cpsr)
+{
+	__asm__ __volatile__("msr	cpsr_c, %0" : : "r" (cpsr) : "memory");
+}
+
+static inline int console_tx_full(void)
+{
+	return XUartPs_ReadReg(STDOUT_BASEADDRESS, XUARTPS_SR_OFFSET) &
+			XUARTPS_SR_TXFULL;
+}
+
+static inline void console_tx(char c)
+{
+	XUartPs_WriteReg(STDOUT_BASEADDRESS, XUARTPS_FIFO_OFFSET, c);
+}
+
+void console_putc(char c)
+{
+	unsigned int cpsr = console_lock();
+
+	if (console_head == console_tail && !console_tx_full()) {
+		console_tx(c);
+	} else if (console_head - console_tail < CONSOLE_BUFFER_SIZE) {
+		console_buffer[console_head & CONSOLE_MASK] = c;
+		console_head++;
+	} else {
+		console_drops++;
+	}
+
+	console_unlock(cpsr);
+}
+
+void console_drain(void)
+{
+	unsigned int cpsr = console_lock();
+
+	while (console_head != console_tail && !console_tx_full()) {
+		console_tx(console_buffer[console_tail & CONSOLE_MASK]);
+		console_tail++;
+	}
+
+	console_unlock(cpsr);
+}
+
+unsigned int console_dropped(void)
+{
+	return console_drops;
+}
+
+/* Replaces the polled outbyte() of the BSP, xil_printf() writes through it */
+void outbyte(char c)
+{
+	console_putc(c);
+}
@@ -0,0 +1,32 @@
+/*
+ * Buffered serial console.
+ *
+ * xil_printf() writes each character with outbyte(), which waits for room
+ * in the UART TX FIFO: an 80 character line at 115200 baud holds the caller
+ * for about 7 ms. console.c replaces outbyte() with a write into a ring
+ * buffer which never waits. The FIFO is refilled from the ring by the tick
+ * interrupt. The UART interrupt itself belongs to Linux, which uses the
+ * same UART as its console.
+ *
+ * When the ring is full further characters are dropped and counted, a
+ * message may then lose its end but the caller is never held up.
+ */
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+/* Size of the ring, a power of two. At 115200 baud the UART sends about
+ * 115 characters per 10 ms tick. */
+#define CONSOLE_BUFFER_SIZE		2048
+
+/* Queue 'c' for the UART, from tasks and interrupt handlers */
+void console_putc(char c);
+
+/* Move queued characters into the UART TX FIFO as long as it has room,
+ * from vApplicationTickHook() */
+void console_drain(void);
+
+/* Characters dropped because the ring was full */
+unsigned int console_dropped(void);
+
+#endif /* CONSOLE_H */
@@ -0,0 +1,280 @@
+/*
+ * Copies by the PS DMA controller (PL330), see dma.h.
+ *
+ * Each copy runs a small DMAC program: load the addresses and the burst
+ * shape, move the data in bursts (two nested loops), send an event which
+ * raises the channel interrupt and end. The program is started through the
+ * debug registers of the manager thread.
+ *
+ * The DMAC sees memory only, like Linux. The source is written back and
+ * the destination dropped from the caches around the transfer. Only whole
+ * cache lines of the destination are transferred by the DMAC, the partial
+ * lines at both ends are copied by the CPU while the transfer runs, so no
+ * cache line is written by both.
+ *
+ * The DMAC registers are in the same 1 MB section as the TTC, which is
+ * mapped by the "ttc" entry of the resource table.
+ */
+
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "xil_printf.h"
+
+#include "cache.h"
+#include "dma.h"
+
+#if DMA_COPY_ENABLE && defined(__arm__)
+
+/* Secure DMAC registers, the Zynq boots with the DMAC secure */
+#define DMAC_BASEADDR			0xF8003000
+#define DMAC_INTEN				0x020
+#define DMAC_INTCLR				0x02C
+#define DMAC_FSRC				0x034
+#define DMAC_CSR(ch)			(0x100 + (ch) * 8)
+#define DMAC_DBGSTATUS			0xD00
+#define DMAC_DBGCMD				0xD04
+#define DMAC_DBGINST0			0xD08
+#define DMAC_DBGINST1			0xD0C
+
+#define DMAC_CSR_STATUS_MASK	0xf
+#define DMAC_DBGSTATUS_BUSY		0x1
+/* DBGINST0: the instruction is for a channel thread, not the manager */
+#define DMAC_DBGINST_CHANNEL	0x1
+
+/* Channel, event and interrupt (SPI 43) used by FreeRTOS, the last ones so
+ * they are the least likely to be in use by Linux */
+#define DMA_CHANNEL				7
+#define DMA_EVENT				7
+#define DMA_IRQ					75
+
+/* DMAC instructions */
+#define DMAEND					0x00
+#define DMAKILL					0x01
+#define DMALD					0x04
+#define DMAST					0x08
+#define DMAWMB					0x13
+#define DMALP					0x20
+#define DMALPEND				0x38
+#define DMASEV					0x34
+#define DMAGO					0xA0
+#define DMAMOV					0xBC
+#define DMAMOV_SAR				0
+#define DMAMOV_CCR				1
+#define DMAMOV_DAR				2
+
+/* Channel control: incrementing 4 byte beats, 'beats' per burst, on both
+ * sides. Secure, non-cacheable accesses. */
+#define DMA_CCR(beats)			(0x1 | (2 << 1) | (((beats) - 1) << 4) | \
+		(0x1 << 14) | (2 << 15) | (((beats) - 1) << 18))
+
+/* Largest burst, 16 beats. A burst never crosses a 4 KB boundary because
+ * both addresses are aligned to the burst size. */
+#define DMA_BURST_MAX			64
+/* Most bursts of one program, two nested loops of 256 */
+#define DMA_BURSTS_MAX			(256 * 256)
+#define DMA_CACHE_LINE			32
+
+/* Time a copy may take before the channel is killed */
+#define DMA_TIMEOUT				(100 / portTICK_RATE_MS)
+
+static unsigned char dma_program[64] __attribute__((aligned(DMA_CACHE_LINE)));
+
+/* One copy at a time on the channel */
+static xSemaphoreHandle dma_lock = NULL;
+/* Given by the interrupt when the program is done */
+static xSemaphoreHandle dma_done = NULL;
+/* Cleared when the channel is not usable */
+static unsigned int dma_available = 0;
+
+static inline unsigned int dmac_read(unsigned int reg)
+{
+	return *(volatile unsigned int *)(DMAC_BASEADDR + reg);
+}
+
+static inline void dmac_write(unsigned int reg, unsigned int value)
+{
+	*(volatile unsigned int *)(DMAC_BASEADDR + reg) = value;
+}
+
+/* Execute one instruction through the debug registers */
+static void dmac_debug_insn(unsigned int inst0, unsigned int inst1)
+{
+	while (dmac_read(DMAC_DBGSTATUS) & DMAC_DBGSTATUS_BUSY)
+		;
+	dmac_write(DMAC_DBGINST0, inst0);
+	dmac_write(DMAC_DBGINST1, inst1);
+	dmac_write(DMAC_DBGCMD, 0);
+}
+
+static void dmac_start(void *program)
+{
+	/* DMAGO by the manager thread, channel and address as arguments */
+	dmac_debug_insn((DMAGO << 16) | (DMA_CHANNEL << 24),
+			(unsigned int)program);
+}
+
+static void dmac_kill(void)
+{
+	dmac_debug_insn((DMAKILL << 16) | (DMA_CHANNEL << 8) |
+			DMAC_DBGINST_CHANNEL, 0);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Program */
+
+static unsigned char *emit_mov(unsigned char *p, unsigned int reg,
+		unsigned int value)
+{
+	p[0] = DMAMOV;
+	p[1] = reg;
+	p[2] = value;
+	p[3] = value >> 8;
+	p[4] = value >> 16;
+	p[5] = value >> 24;
+	return p + 6;
+}
+
+/* Loop 'count' (1 - 256) times over the burst, 'lc' is the loop counter */
+static unsigned char *emit_burst_loop(unsigned char *p, unsigned int lc,
+		unsigned int count)
+{
+	p[0] = DMALP | (lc << 1);
+	p[1] = count - 1;
+	p[2] = DMALD;
+	p[3] = DMAST;
+	p[4] = DMALPEND | (lc << 2);
+	p[5] = 2; /* back to DMALD */
+	return p + 6;
+}
+
+static unsigned int build_program(unsigned int dst, unsigned int src,
+		unsigned int burst, unsigned int bursts)
+{
+	unsigned char *p = dma_program;
+
+	p = emit_mov(p, DMAMOV_SAR, src);
+	p = emit_mov(p, DMAMOV_DAR, dst);
+	p = emit_mov(p, DMAMOV_CCR, DMA_CCR(burst / 4));
+
+	if (bursts >= 256) {
+		p[0] = DMALP | (1 << 1);
+		p[1] = bursts / 256 - 1;
+		p = emit_burst_loop(p + 2, 0, 256);
+		p[0] = DMALPEND | (1 << 2);
+		p[1] = 6; /* back to the inner DMALP */
+		p += 2;
+	}
+	if (bursts % 256) {
+		p = emit_burst_loop(p, 0, bursts % 256);
+	}
+
+	/* All data written before the event */
+	*p++ = DMAWMB;
+	*p++ = DMASEV;
+	*p++ = DMA_EVENT << 3;
+	*p++ = DMAEND;
+	return p - dma_program;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void dma_irq(void *data)
+{
+	signed portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+	dmac_write(DMAC_INTCLR, 1 << DMA_EVENT);
+	xSemaphoreGiveFromISR(dma_done, &xHigherPriorityTaskWoken);
+	if (xHigherPriorityTaskWoken) {
+		portYIELD_FROM_ISR();
+	}
+}
+
+void *dma_memcpy(void *dst, const void *src, unsigned int len)
+{
+	unsigned int head = -(unsigned int)dst & (DMA_CACHE_LINE - 1);
+	unsigned int d = (unsigned int)dst + head;
+	unsigned int s = (unsigned int)src + head;
+	unsigned int burst = DMA_BURST_MAX;
+	unsigned int n;
+	unsigned int faulted;
+	signed portBASE_TYPE done;
+
+	if (!dma_available || len < DMA_COPY_THRESHOLD || head >= len ||
+			(s & 3) != 0) {
+		return memcpy(dst, src, len);
+	}
+
+	/* Largest burst both addresses are aligned to, then only whole bursts
+	 * and whole cache lines */
+	while ((d | s) & (burst - 1)) {
+		burst /= 2;
+	}
+	n = (len - head) & ~((burst > DMA_CACHE_LINE ? burst : DMA_CACHE_LINE) - 1);
+	if (n == 0 || n / burst > DMA_BURSTS_MAX) {
+		return memcpy(dst, src, len);
+	}
+
+	xSemaphoreTake(dma_lock, portMAX_DELAY);
+
+	cache_sync_to_linux((void *)s, n);
+	cache_sync_to_linux((void *)d, n);
+	cache_sync_to_linux(dma_program, build_program(d, s, burst, n / burst));
+	dmac_start(dma_program);
+
+	/* The partial cache lines at both ends meanwhile */
+	memcpy(dst, src, head);
+	memcpy((unsigned char *)d + n, (const unsigned char *)s + n,
+			len - head - n);
+
+	done = xSemaphoreTake(dma_done, DMA_TIMEOUT);
+	faulted = dmac_read(DMAC_FSRC) & (1 << DMA_CHANNEL);
+	if (done != pdTRUE || faulted) {
+		/* Stop the channel and copy with the CPU */
+		dmac_kill();
+		xil_printf("dma: copy %s, DMAC disabled\r\n",
+				faulted ? "faulted" : "timed out");
+		dma_available = 0;
+		cache_sync_from_linux((void *)d, n);
+		memcpy((void *)d, (const void *)s, n);
+	} else {
+		/* Drop lines fetched speculatively during the transfer */
+		cache_sync_from_linux((void *)d, n);
+	}
+
+	xSemaphoreGive(dma_lock);
+	return dst;
+}
+
+void dma_init(void)
+{
+	dma_lock = xSemaphoreCreateMutex();
+	vSemaphoreCreateBinary(dma_done);
+	if (dma_lock == NULL || dma_done == NULL) {
+		xil_printf("ERROR: Failed to create DMA semaphores!\r\n");
+		return;
+	}
+	/* Binary semaphores are created given */
+	xSemaphoreTake(dma_done, 0);
+
+	/* Leave the DMAC to Linux if it runs a program on our channel */
+	if (dmac_read(DMAC_CSR(DMA_CHANNEL)) & DMAC_CSR_STATUS_MASK) {
+		xil_printf("dma: channel %d is busy, DMAC not used\r\n", DMA_CHANNEL);
+		return;
+	}
+	dma_available = 1;
+}
+
+void dma_init_irqs(void)
+{
+	if (!dma_available) {
+		return;
+	}
+	/* The event raises the interrupt instead of waking DMAWFE */
+	dmac_write(DMAC_INTCLR, 1 << DMA_EVENT);
+	dmac_write(DMAC_INTEN, dmac_read(DMAC_INTEN) | (1 << DMA_EVENT));
+	setupIRQhandler(DMA_IRQ, &dma_irq, NULL);
+}
+
+#endif /* DMA_COPY_ENABLE && __arm__ */
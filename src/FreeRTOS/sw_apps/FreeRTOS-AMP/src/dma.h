@@ -0,0 +1,54 @@
+/*
+ * Copies by the PS DMA controller (PL330), so large copies run while the
+ * CPU serves other tasks.
+ *
+ * dma_memcpy() hands copies of DMA_COPY_THRESHOLD bytes or more to one
+ * channel of the DMAC and blocks the calling task until the channel signals
+ * completion, smaller copies are done by the CPU. It must be called from a
+ * task, never from an interrupt handler.
+ *
+ * The DMAC is shared with Linux. The firmware only uses channel DMA_CHANNEL
+ * and its interrupt, Linux must leave them alone (see README.md). The path
+ * is disabled by default, dma_memcpy() is memcpy() then.
+ */
+
+#ifndef DMA_H
+#define DMA_H
+
+#include <string.h>
+
+/* Set to 1 to copy with the DMAC */
+#define DMA_COPY_ENABLE			0
+
+/* Smallest copy handed to the DMAC. Below that the cache maintenance and
+ * the interrupt cost more than the copy. */
+#define DMA_COPY_THRESHOLD		256
+
+#if DMA_COPY_ENABLE && defined(__arm__)
+
+/* Set up the DMAC channel, before the scheduler is started */
+void dma_init(void);
+
+/* Connect the completion interrupt, from the register_handler() callback */
+void dma_init_irqs(void);
+
+void *dma_memcpy(void *dst, const void *src, unsigned int len);
+
+#else /* !(DMA_COPY_ENABLE && __arm__) */
+
+static inline void dma_init(void)
+{
+}
+
+static inline void dma_init_irqs(void)
+{
+}
+
+static inline void *dma_memcpy(void *dst, const void *src, unsigned int len)
+{
+	return memcpy(dst, src, len);
+}
+
+#endif /* DMA_COPY_ENABLE && __arm__ */
+
+#endif /* DMA_H */
@@ -14,7 +14,8 @@
  * The message passing interface (rpmsg) is used to communicate with the 
  * latency demo FreeRTOS application through the use of vring buffers. In this
  * specific application the demo only responds to requests made by Linux. These
- * requests are detailed in the 'message_handler' function of this file.
+ * requests are detailed in the 'demo_commands' table of this file, 'rpc.c'
+ * dispatches them and records how long each kind of request takes.
  *
  * The remoteproc section of this application is also responsible for setting up
  * the AMP state of the system to allow for access to shared memory as well as
@@ -51,10 +52,15 @@
  * 
  * This task is to demonstrate that FreeRTOS is able to schedule the remoteproc,
  * IRQ latency measurement all while maintaining the expected scheduling jitter.
+ *
+ * The application also registers the transport benchmark service of 'bench.c'
+ * as a second channel.
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 #include "FreeRTOS.h"
 #include "task.h"
 #include "queue.h"
@@ -62,16 +68,27 @@
 #include "xil_printf.h"
 #include "xil_cache.h"
 #include "xil_cache_l.h"
+#include "xparameters.h"
 #include "semphr.h"
 
 #include "remoteproc.h"
 #include "latencydemo.h"
-
-/* trace() prints to trace buffer */
-#define trace(x)		xputs(x)
-/* console() prints to serial device */
-#define console(x)		xil_printf(x)
-#define log(x)			trace(x)
+#include "bench.h"
+#include "rpc.h"
+#include "spsc.h"
+#include "dma.h"
+#include "mailbox.h"
+#include "binlog.h"
+#include "timestamp.h"
+#include "logging.h"
+#include "console.h"
+#include "stats.h"
+
+/* This FreeRTOS application address used in the communication with Linux */
+#define FREERTOS_APP_ADDR 0x50
+/* Service name. It needs to match the driver name of the corresponding
+ * RPMSG driver in Linux. */
+#define FREERTOS_APP_SERVICE_NAME "rpmsg-timer-statistic"
 
 /* -------------------------------------------------------------------------- */
 
@@ -84,13 +101,36 @@ struct histogram* hist = 0;
 struct histogram* hist_clone = 0;
 /* Flag to enable/disable sampling of data */
 unsigned volatile int histogram_enable = 0;
+/* Set by the CLEAR mailbox handler, the histogram is cleared in task context
+ * before the next sample is taken */
+static unsigned volatile int histogram_clear_pending = 0;
+
+/* Samples since boot, the histogram may be cleared. The statistics task
+ * publishes them (see stats.h). */
+static unsigned int samples = 0;
+static unsigned int sample_overruns = 0;
+/* Entry of the statistics page */
+static struct stats_entry* stat_heap_used;
+
+/* Heap malloc() takes its memory from, see lscript.ld */
+extern char _heap_start;
+extern char _heap_end;
 
 /* Clear the Data */
 void clear_histogram()
 {
 	memset(hist, 0, sizeof(struct histogram));
 	hist->min = 0xffffffff; /* invalid minimum */
-	Xil_L1DCacheFlush();
+}
+
+/* Clear the Data if a clear is pending. Only called while no sample is in
+ * flight, the ISR does not touch the histogram then. */
+static void clear_histogram_pending()
+{
+	if (histogram_clear_pending) {
+		histogram_clear_pending = 0;
+		clear_histogram();
+	}
 }
 
 struct ttc_timer
@@ -111,6 +151,14 @@ struct ttc_timer
 #define TTC_CHANNEL2			2
 #define TTC_SAMPLE_CHANNEL		TTC_CHANNEL1
 
+/* Clock of the sampling TTC (TTC1 channel 1), CPU_1X unless the hardware
+ * description says otherwise */
+#ifdef XPAR_PS7_TTC_4_TTC_CLK_FREQ_HZ
+#define TTC_SAMPLE_FREQ			XPAR_PS7_TTC_4_TTC_CLK_FREQ_HZ
+#else
+#define TTC_SAMPLE_FREQ			(XPAR_CPU_CORTEXA9_0_CPU_CLK_FREQ_HZ / 6)
+#endif
+
 struct ttc_timer* ttc = (struct ttc_timer*)TTC_BASEADDR;
 
 /* -------------------------------------------------------------------------- */
@@ -136,17 +184,19 @@ void irq70_ttc(void* data)
 
 	hist->total_sum += cnt_value;
 	hist->sample_count++;
+	samples++;
 
 	if (cnt_value > HISTOGRAM_SIZE) {
 		/* value is outside the range of the histogram, count it separately */
 		hist->out_count++;
+		sample_overruns++;
 	} else {
 		/* increment histogram value */
 		hist->data[cnt_value]++;
 	}
 
-	/* Flush cache */
-	Xil_L1DCacheFlush();
+	/* No cache maintenance needed, the histogram is private to FreeRTOS and
+	 * reaches Linux as a copy in the rpmsg buffers */
 
 	/* trigger ISR waiting semaphore */
 	signed portBASE_TYPE xHigherPriorityTaskWoken;
@@ -180,11 +230,13 @@ static void task_latency( void *pvParameters )
 	vSemaphoreCreateBinary(wait_for_irq);
 	vSemaphoreCreateBinary(wait_for_clone);
 	if (wait_for_irq == NULL || wait_for_clone == NULL) {
-		log("task_latency: Unable to create message semaphores.\r\n");
+		log_error(LOG_CAT_SAMPLE,
+				"task_latency: Unable to create message semaphores.\r\n");
 		while(1);
 	}
 
-	log("task_latency: starting sampling of irq latency\r\n");
+	log_info(LOG_CAT_SAMPLE,
+			"task_latency: starting sampling of irq latency\r\n");
 
 	/* Init next - this only needs to be done once. */
 	portTickType next;
@@ -221,11 +273,14 @@ static void task_latency( void *pvParameters )
 			 * the sampling task is paused.
 			 */
 			if (xSemaphoreTake(wait_for_irq, 1000 / portTICK_RATE_MS) == pdTRUE) {
+				/* the previous sample is complete, a clear cannot race it */
+				clear_histogram_pending();
 				/* once the semaphore is locked, access the timer and set it up */
 				ttc->counter_control[TTC_SAMPLE_CHANNEL] = 0x10; /* reset counter */
 				ttc->interrupt_enable[TTC_SAMPLE_CHANNEL] = 0x10; /* enable irq */
 			} else {
-				log("task_latency: failed to get semaphore\r\n");
+				log_warning(LOG_CAT_SAMPLE,
+						"task_latency: failed to get semaphore\r\n");
 			}
 			
 
@@ -233,7 +288,8 @@ static void task_latency( void *pvParameters )
 			sample_counter++;
 			if (sample_counter == (1000)) {
 				sample_counter = 0;
-				log("task_latency: sampled 1 full buffers\r\n");
+				log_debug(LOG_CAT_SAMPLE,
+						"task_latency: sampled 1 full buffers\r\n");
 			}
 		} else {
 			/* stop counter while sampling is disabled */
@@ -256,6 +312,7 @@ static void task_latency( void *pvParameters )
 				 */
 				clone_unlock_mutex();
 			}
+			clear_histogram_pending();
 		}
 		/* wait between samples, in order to let the system schedule */
 		vTaskDelayUntil( &next, 1 / portTICK_RATE_MS );
@@ -275,7 +332,7 @@ static void task_demo(void* pvParameters)
 	next = xTaskGetTickCount();
 	delay = 100000 / portTICK_RATE_MS;
 
-	log("task_demo: started\r\n");
+	log_info(LOG_CAT_DEMO, "task_demo: started\r\n");
 
 	while (1)
 	{
@@ -285,56 +342,181 @@ static void task_demo(void* pvParameters)
 
 		/* print out the difference between delay expected and actual */
 		if ((current_delay_end - current_delay_start) != delay) {
-			log("task_demo: task resumed out of expected boundary\r\n");
+			log_warning(LOG_CAT_DEMO,
+					"task_demo: task resumed out of expected boundary\r\n");
 		} else {
-			log("task_demo: task resumed as expected\r\n");
+			log_debug(LOG_CAT_DEMO, "task_demo: task resumed as expected\r\n");
 		}
 	}
 }
 
 /* -------------------------------------------------------------------------- */
 
-void message_handler(struct remoteproc_request* req, unsigned char* data,
-		unsigned int len)
+/* Request handlers, see the 'demo_commands' table */
+
+static void* cmd_clear(unsigned char* data, unsigned int len)
 {
-	switch (req->state)
-	{
-		case CLEAR:
-			log("rpmsg: CLEAR request\r\n");
-			clear_histogram(NULL);
-			remoteproc_request_ack(req);
-			break;
-		case START:
-			log("rpmsg: START request\r\n");
-			histogram_enable = 1;
-			remoteproc_request_ack(req);
-			break;
-		case STOP:
-			log("rpmsg: STOP request\r\n");
-			histogram_enable = 0;
-			remoteproc_request_ack(req);
-			break;
-		case CLONE:
-			log("rpmsg: CLONE request\r\n");
-			clone_lock_mutex();
-			memcpy(hist_clone, hist, sizeof(struct histogram));
-			clone_unlock_mutex();
-			remoteproc_request_ack(req);
-			break;
-		case GET:
-			log("rpmsg: GET request\r\n");
-			remoteproc_request_ack(req);
-			remoteproc_request_response(req, (unsigned char*)hist_clone,
-					sizeof(struct histogram));
-			break;
-		case QUIT:
-			log("rpmsg: QUIT request\r\n");
-			histogram_enable = 0;
-			remoteproc_request_ack(req);
-			break;
-		default:
-			log("rpmsg: Unimplemented request\r\n");
+	clear_histogram();
+	return NULL;
+}
+
+static void* cmd_start(unsigned char* data, unsigned int len)
+{
+	histogram_enable = 1;
+	return NULL;
+}
+
+static void* cmd_stop(unsigned char* data, unsigned int len)
+{
+	histogram_enable = 0;
+	return NULL;
+}
+
+static void* cmd_clone(unsigned char* data, unsigned int len)
+{
+	clone_lock_mutex();
+	/* sampling is stopped, apply a clear task_latency has not seen yet */
+	clear_histogram_pending();
+	dma_memcpy(hist_clone, hist, sizeof(struct histogram));
+	clone_unlock_mutex();
+	return NULL;
+}
+
+static void* cmd_get(unsigned char* data, unsigned int len)
+{
+	return hist_clone;
+}
+
+static void* cmd_quit(unsigned char* data, unsigned int len)
+{
+	histogram_enable = 0;
+	return NULL;
+}
+
+static struct rpc_stats rpc_stats_snapshot;
+
+static void* cmd_stats(unsigned char* data, unsigned int len)
+{
+	rpc_get_stats(&rpc_stats_snapshot);
+	return &rpc_stats_snapshot;
+}
+
+static struct upload_checksum checksum_result;
+
+/* Target of an upload, the 32-bit FNV-1a hash of the data */
+static void* cmd_checksum(unsigned char* data, unsigned int len)
+{
+	unsigned int hash = 2166136261U;
+	unsigned int i;
+
+	for (i = 0; i < len; i++) {
+		hash = (hash ^ data[i]) * 16777619U;
 	}
+	checksum_result.len = len;
+	checksum_result.hash = hash;
+	return &checksum_result;
+}
+
+static xTaskSnapshot task_snapshot[RPC_TASKS_MAX];
+static struct rpc_tasks tasks_result;
+
+/* Task table for latencystat --top */
+static void* cmd_tasks(unsigned char* data, unsigned int len)
+{
+	unsigned long total_runtime;
+	unsigned int i;
+
+	tasks_result.total = uxTaskGetSnapshot(task_snapshot, RPC_TASKS_MAX,
+			&total_runtime);
+	tasks_result.count = tasks_result.total < RPC_TASKS_MAX ?
+			tasks_result.total : RPC_TASKS_MAX;
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+	tasks_result.runtime_freq = TIMESTAMP_FREQ >> portRUN_TIME_SHIFT;
+#else
+	tasks_result.runtime_freq = 0;
+#endif
+	tasks_result.total_runtime = total_runtime;
+
+	for (i = 0; i < tasks_result.count; i++) {
+		struct rpc_task_info* info = &tasks_result.task[i];
+		xTaskSnapshot* task = &task_snapshot[i];
+
+		memset(info->name, 0, sizeof(info->name));
+		strncpy(info->name, (char *)task->pcTaskName,
+				configMAX_TASK_NAME_LEN < RPC_TASK_NAME_MAX ?
+				configMAX_TASK_NAME_LEN : RPC_TASK_NAME_MAX - 1);
+		info->number = task->uxTaskNumber;
+		info->state = task->cStatus;
+		info->priority = task->uxPriority;
+		info->runtime = task->ulRunTimeCounter;
+		info->stack_free = task->usStackHighWaterMark;
+	}
+	return &tasks_result;
+}
+
+static struct rpc_time time_result;
+
+static void* cmd_time(unsigned char* data, unsigned int len)
+{
+	time_result.timestamp_freq = TIMESTAMP_FREQ;
+	time_result.sample_freq = TTC_SAMPLE_FREQ;
+	time_result.time = timestamp_read();
+	return &time_result;
+}
+
+static struct rpc_log_state log_result;
+
+static void* cmd_logging(unsigned char* data, unsigned int len)
+{
+	struct rpc_log_config* config = (struct rpc_log_config *)data;
+
+	log_configure(config->level, config->mask);
+	log_get_state(&log_result);
+	return &log_result;
+}
+
+/* Requests of the latencystat application. Each request is the opcode word
+ * alone (LOGGING carries its settings, CHECKSUM is sent as an upload), every
+ * request is ACKed before its response is sent. The requests with large
+ * responses go to the bulk lane. */
+static const struct rpc_command demo_commands[] = {
+	RPC_COMMAND(CLEAR, cmd_clear, unsigned int, 0),
+	RPC_COMMAND(START, cmd_start, unsigned int, 0),
+	RPC_COMMAND(STOP, cmd_stop, unsigned int, 0),
+	RPC_COMMAND(CLONE, cmd_clone, unsigned int, 0),
+	RPC_BULK_COMMAND(GET, cmd_get, unsigned int, sizeof(struct histogram)),
+	RPC_COMMAND(QUIT, cmd_quit, unsigned int, 0),
+	RPC_BULK_COMMAND(STATS, cmd_stats, unsigned int,
+			sizeof(struct rpc_stats)),
+	RPC_BULK_COMMAND(CHECKSUM, cmd_checksum, unsigned char,
+			sizeof(struct upload_checksum)),
+	RPC_BULK_COMMAND(TASKS, cmd_tasks, unsigned int,
+			sizeof(struct rpc_tasks)),
+	RPC_COMMAND(LOGGING, cmd_logging, struct rpc_log_config,
+			sizeof(struct rpc_log_state)),
+	RPC_COMMAND(TIME, cmd_time, unsigned int, sizeof(struct rpc_time)),
+};
+
+/* Mailbox handlers, run by the doorbell interrupt (see mailbox.h). Linux
+ * sends the commands which switch the sampling through the mailbox when it
+ * is there, they take effect without a round trip through rpmsg. */
+
+/* Clearing the histogram is a memset of several KB, too long for the
+ * doorbell interrupt and racing the TTC interrupt while sampling runs.
+ * task_latency does it before the next sample instead. */
+static void mb_clear(unsigned int arg)
+{
+	histogram_clear_pending = 1;
+}
+
+static void mb_start(unsigned int arg)
+{
+	cmd_start(NULL, 0);
+}
+
+static void mb_stop(unsigned int arg)
+{
+	cmd_stop(NULL, 0);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -343,6 +525,8 @@ void setup_handler(void)
 {
 	/* Setup remoteproc IRQs */
 	remoteproc_init_irqs();
+	dma_init_irqs();
+	mailbox_init_irqs();
 
 	/* This is the interrupt from the TTC1 - Channel #2
 	 * necessary to stop it because if firmware failed counter can still work */
@@ -359,8 +543,11 @@ extern void Init_Uart(unsigned int BaudRate);
 
 int main(void)
 {
-	/* Init trace buffer */
+	/* Init trace buffer, binary log, kernel event trace and statistics page */
 	trace_init();
+	binlog_init();
+	event_trace_init(EVENT_RING_START, EVENT_BUFFER_START, EVENT_BUFFER_SIZE);
+	stats_init();
 
 	/* MMU resource setup */
 	mmu_resource_table_setup();
@@ -369,21 +556,44 @@ int main(void)
 	Init_Uart(115200);
 
 	/* Print Message */
-	log("FreeRTOS main demo application " __DATE__ " " __TIME__ "\r\n");
+	log_info(LOG_CAT_DEMO,
+			"FreeRTOS main demo application " __DATE__ " " __TIME__ "\r\n");
 
 	/* Allocate histogram structure */
 	hist = (struct histogram*)malloc(sizeof (struct histogram));
 	hist_clone = (struct histogram*)malloc(sizeof (struct histogram));
 	if (hist == NULL || hist_clone == NULL) {
-		log("ERROR: Failed to allocate memory!\r\n");
+		log_error(LOG_CAT_DEMO, "ERROR: Failed to allocate memory!\r\n");
 		return -1;
 	}
 
 	/* IRQ handler must be registered before vTaskStartScheduler */
 	register_handler(&setup_handler);
 
+	/* DMAC for large copies */
+	dma_init();
+
 	/* Init the remoteproc communication */
-	remoteproc_init(&message_handler);
+	remoteproc_init();
+	rpc_init();
+	rpc_register(demo_commands, sizeof(demo_commands) / sizeof(demo_commands[0]));
+	remoteproc_register_endpoint(FREERTOS_APP_SERVICE_NAME, FREERTOS_APP_ADDR,
+			&rpc_dispatch);
+	/* Bulk channel to Linux, next to rpmsg */
+	spsc_init(BULK_CHANNEL, BULK_CHANNEL_DATA_SIZE, SPSC_NO_DOORBELL);
+	/* Transport benchmark service */
+	bench_init();
+	/* Control mailbox for the sampling commands */
+	mailbox_init();
+	mailbox_register(CLEAR, &mb_clear);
+	mailbox_register(START, &mb_start);
+	mailbox_register(STOP, &mb_stop);
+	/* Sampling and memory on the statistics page */
+	stats_register_counter("samples", &samples);
+	stats_register_counter("sample_overruns", &sample_overruns);
+	stat_heap_used = stats_register("heap_used", STATS_GAUGE);
+	stats_set(stats_register("heap_size", STATS_GAUGE),
+			&_heap_end - &_heap_start);
 
 	/* Create sampler task */
 	xTaskCreate(task_latency, (signed char*)"TIMER", configMINIMAL_STACK_SIZE,
@@ -441,3 +651,18 @@ void vApplicationStackOverflowHook(xTaskHandle* pxTask, signed char* pcTaskName)
 	taskDISABLE_INTERRUPTS();
 	for( ;; );
 }
+
+/* -------------------------------------------------------------------------- */
+
+void vApplicationTickHook(void)
+{
+	/* Refill the UART from the console buffer, see console.h */
+	console_drain();
+
+	/* Hand the binary log records of the last tick to Linux */
+	binlog_drain();
+
+	/* Heap malloc() has claimed so far. It only grows, newlib keeps what
+	 * is freed for later allocations. */
+	stats_set(stat_heap_used, (char*)sbrk(0) - &_heap_start);
+}
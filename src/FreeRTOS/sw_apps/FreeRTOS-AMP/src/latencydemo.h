@@ -15,9 +15,188 @@ typedef enum {
 	CLONE,
 	GET,
 	QUIT,
+	/* Respond with a struct rpc_stats */
+	STATS,
+	/* One chunk of an upload, see struct rpc_upload_chunk */
+	UPLOAD,
+	/* Target of an upload, respond with a struct upload_checksum */
+	CHECKSUM,
+	/* Respond with a struct rpc_tasks */
+	TASKS,
+	/* Set the log level and mask, see struct rpc_log_config. Respond with
+	 * a struct rpc_log_state. */
+	LOGGING,
+	/* Respond with a struct rpc_time */
+	TIME,
 	STATE_MASK = 0xF,
 } latency_demo_msg_type;
 
+/* Number of opcodes, the opcode is the low part of the first word */
+#define RPC_OPCODES_MAX			(STATE_MASK + 1)
+
+/* Service time histogram of an opcode. Bucket i counts the calls which took
+ * less than 2^(i + RPC_HISTOGRAM_SHIFT) timestamp ticks, the last bucket
+ * also the longer ones. */
+#define RPC_HISTOGRAM_SIZE		16
+#define RPC_HISTOGRAM_SHIFT		7
+
+/* Call counts and service times of one opcode, in timestamp ticks */
+struct rpc_opcode_stats
+{
+	unsigned int calls;
+	unsigned int min;
+	unsigned int max;
+	unsigned long long total;
+	unsigned int data[RPC_HISTOGRAM_SIZE];
+};
+
+/* Response to STATS */
+struct rpc_stats
+{
+	/* Frequency of the timestamps in Hz */
+	unsigned int timestamp_freq;
+	/* Requests with an unknown opcode or a too short payload, or which
+	 * found the queue of their lane full */
+	unsigned int rejected;
+	struct rpc_opcode_stats opcode[RPC_OPCODES_MAX];
+};
+
+/* Status of an ACK. Any other than RPC_OK makes it a NAK: the request was
+ * not handled and nothing follows the ACK. */
+typedef enum {
+	RPC_OK = 0,
+	/* The queue of its lane was full, the request may be sent again */
+	RPC_BUSY,
+	/* Unknown opcode or a payload of the wrong size */
+	RPC_REJECTED,
+} rpc_status;
+
+/* ACK of a request, sent before its response. The times are global timer
+ * ticks (see struct rpc_time): 'rx_time' when the request arrived (the
+ * kick interrupt, or the RX task finding it if it was polled), 'tx_time'
+ * when the ACK was sent. Together with the times Linux sent the request
+ * and read the ACK they give the time each way. */
+struct rpc_ack
+{
+	/* Opcode of the request with REMOTEPROC_REQUEST_ACK_MASK set */
+	unsigned int state;
+	/* An rpc_status */
+	unsigned int status;
+	unsigned long long rx_time;
+	unsigned long long tx_time;
+};
+
+/* Uploads: data larger than one message is sent as a sequence of UPLOAD
+ * chunks, each starting with this header. FreeRTOS reassembles the data and
+ * passes it to the handler of 'target' as if it had been a single request.
+ * Only the upload as a whole is ACKed (as UPLOAD), the ACK is followed by a
+ * struct rpc_upload_result and, if the upload was complete, by the response
+ * of 'target'. A chunk with 'seq' 0 starts a new upload. */
+struct rpc_upload_chunk
+{
+	unsigned int opcode;
+	/* Opcode of the command the data is for */
+	unsigned int target;
+	/* Chunk number, counting from 0 */
+	unsigned int seq;
+	/* Length of the whole upload */
+	unsigned int total;
+};
+
+/* Largest upload */
+#define RPC_UPLOAD_MAX			16384
+
+typedef enum {
+	RPC_UPLOAD_OK = 0,
+	/* The previous upload is still being handled */
+	RPC_UPLOAD_BUSY,
+	/* A chunk is missing or the chunks add up to more than 'total' */
+	RPC_UPLOAD_SEQUENCE,
+	/* 'total' is larger than RPC_UPLOAD_MAX or the target rejects it */
+	RPC_UPLOAD_SIZE,
+	/* Unknown target */
+	RPC_UPLOAD_TARGET,
+} rpc_upload_status;
+
+struct rpc_upload_result
+{
+	unsigned int status;
+	/* Bytes received */
+	unsigned int len;
+};
+
+/* Response to CHECKSUM, the 32-bit FNV-1a hash of the uploaded data */
+struct upload_checksum
+{
+	unsigned int len;
+	unsigned int hash;
+};
+
+/* Task table, the response to TASKS. The run times are 32-bit counters
+ * which wrap, the CPU load over an interval is the difference of two
+ * snapshots. */
+#define RPC_TASKS_MAX			12
+#define RPC_TASK_NAME_MAX		16
+
+struct rpc_task_info
+{
+	char name[RPC_TASK_NAME_MAX];
+	/* Number in order of creation */
+	unsigned int number;
+	/* 'R'eady or running, 'B'locked, 'S'uspended or 'D'eleted */
+	unsigned int state;
+	unsigned int priority;
+	/* Time the task has run, in ticks of runtime_freq */
+	unsigned int runtime;
+	/* Stack never used so far, in words */
+	unsigned int stack_free;
+};
+
+struct rpc_tasks
+{
+	/* Frequency of the run time counters in Hz, 0 if FreeRTOS does not
+	 * collect run time stats */
+	unsigned int runtime_freq;
+	/* Run time counter at the snapshot, the time base of 'runtime' */
+	unsigned int total_runtime;
+	/* Tasks in 'task' and tasks in the system, which may be more */
+	unsigned int count;
+	unsigned int total;
+	struct rpc_task_info task[RPC_TASKS_MAX];
+};
+
+/* Request of LOGGING, the level and the mask are values of log_category.h
+ * or LOG_KEEP */
+struct rpc_log_config
+{
+	unsigned int opcode;
+	unsigned int level;
+	unsigned int mask;
+};
+
+/* Response to LOGGING, the settings now in effect */
+struct rpc_log_state
+{
+	unsigned int level;
+	unsigned int mask;
+	/* Messages above this level are compiled out */
+	unsigned int max_level;
+};
+
+/* Response to TIME. The global timer is shared by both CPUs and is the
+ * time base of FreeRTOS: the timestamps of the ACKs, the trace buffers and
+ * the request statistics count its ticks. */
+struct rpc_time
+{
+	/* Frequency of the global timer in Hz */
+	unsigned int timestamp_freq;
+	/* Frequency of the TTC the latency samples (struct histogram) are
+	 * counted with in Hz */
+	unsigned int sample_freq;
+	/* Global timer when the request was handled */
+	unsigned long long time;
+};
+
 /* Number of data pieces stored in the histogram */
 #define HISTOGRAM_SIZE 1000
 
@@ -39,4 +218,63 @@ struct histogram
 	unsigned volatile int data[HISTOGRAM_SIZE];
 };
 
+/* Transport benchmark service, a second channel next to the demo one. The
+ * first word of every message is the command. */
+typedef enum {
+	/* Send the message back, with the timestamps filled in */
+	BENCH_ECHO = 0x10,
+	/* Count the message, no response */
+	BENCH_SINK,
+	/* Send 'count' messages of 'len' bytes as fast as possible */
+	BENCH_SOURCE,
+	/* Respond with a struct bench_stats */
+	BENCH_STATS,
+	/* Write 'count' bytes into the bulk channel, byte i of the stream is
+	 * i & 0xff. No response. */
+	BENCH_BULK,
+	/* Poll the RX vring for 'count' us after each message, 0 to wait for
+	 * the kick interrupt right away. No response. */
+	BENCH_POLL,
+} bench_msg_type;
+
+/* Header of the benchmark messages, the payload follows it. The timestamps
+ * are taken by FreeRTOS in ticks of the global timer. */
+struct bench_msg
+{
+	unsigned int cmd;
+	/* Sequence number, copied to the response */
+	unsigned int seq;
+	/* Number and size of the messages for BENCH_SOURCE, number of bytes
+	 * for BENCH_BULK, poll budget for BENCH_POLL */
+	unsigned int count;
+	unsigned int len;
+	/* Kick interrupt from Linux (rxvring_irq3), 0 if the message was
+	 * polled before its kick was handled */
+	unsigned long long t_kick;
+	/* RX task picked up the message (rxvring_task) */
+	unsigned long long t_task;
+	/* Service handler was called */
+	unsigned long long t_handler;
+	/* Response was passed to the transport */
+	unsigned long long t_send;
+};
+
+/* Benchmark counters, the response to BENCH_STATS */
+struct bench_stats
+{
+	/* Messages and bytes received by the service */
+	unsigned int rx_messages;
+	unsigned long long rx_bytes;
+	/* Transport counters, see struct remoteproc_stats */
+	unsigned int tx_messages;
+	unsigned int tx_full;
+	unsigned long long tx_time;
+	unsigned int rx_polled;
+	unsigned int rx_woken;
+	/* Frequency of the timestamps in Hz */
+	unsigned int timestamp_freq;
+	/* BENCH_ECHO responses lost to a full TX ring */
+	unsigned int echo_dropped;
+};
+
 #endif /* LATENCYDEMO_H */
@@ -0,0 +1,34 @@
+/*
+ * Log levels and categories of the FreeRTOS application.
+ * This header is common for the FreeRTOS application and the latencystat
+ * application, keep both copies the same.
+ *
+ * The LOGGING request (latencydemo.h) sets the current level and mask with
+ * these values, 'latencystat --log' takes the level by name and the mask as
+ * a number made of the LOG_CAT_* bits.
+ */
+
+#ifndef LOG_CATEGORY_H
+#define LOG_CATEGORY_H
+
+/* A message is written if its level is at most the current level and its
+ * category is in the current mask */
+typedef enum {
+	LOG_ERROR = 0,
+	LOG_WARNING,
+	LOG_INFO,
+	LOG_DEBUG,
+	LOG_LEVELS,
+} log_level_type;
+
+/* Log categories, one bit each in the mask */
+#define LOG_CAT_DEMO			(1 << 0)	/* Application setup and demo task */
+#define LOG_CAT_SAMPLE			(1 << 1)	/* Latency sampler */
+#define LOG_CAT_RPC				(1 << 2)	/* Request dispatcher */
+#define LOG_CAT_BENCH			(1 << 3)	/* Transport benchmark service */
+#define LOG_CAT_ALL				0x0000ffff
+
+/* Leave the level or the mask as it is */
+#define LOG_KEEP				0xffffffff
+
+#endif /* LOG_CATEGORY_H */
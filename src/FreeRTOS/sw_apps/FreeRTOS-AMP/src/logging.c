@@ -0,0 +1,25 @@
+/*
+ * Run time settings of the log messages, see logging.h.
+ */
+
+#include "logging.h"
+
+volatile unsigned int log_level = LOG_LEVEL_DEFAULT;
+volatile unsigned int log_mask = LOG_MASK_DEFAULT;
+
+void log_configure(unsigned int level, unsigned int mask)
+{
+	if (level != LOG_KEEP) {
+		log_level = level < LOG_LEVELS ? level : LOG_LEVELS - 1;
+	}
+	if (mask != LOG_KEEP) {
+		log_mask = mask;
+	}
+}
+
+void log_get_state(struct rpc_log_state* state)
+{
+	state->level = log_level;
+	state->mask = log_mask;
+	state->max_level = LOG_LEVEL_MAX;
+}
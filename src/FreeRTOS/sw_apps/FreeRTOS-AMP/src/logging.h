@@ -0,0 +1,54 @@
+/*
+ * Leveled log messages of the application, written to the trace buffer.
+ *
+ *   log_info(LOG_CAT_DEMO, "task_demo: started\r\n");
+ *
+ * Each message has a level and a category (log_category.h). Messages above
+ * LOG_LEVEL_MAX are compiled out, the condition is a constant and the string
+ * is not even part of the image. The others are written if their level is
+ * at most the current level and their category is in the current mask,
+ * both set at run time by the LOGGING request. A message which is filtered
+ * out costs a load and a compare, not the copy into the trace buffer and
+ * the cache flushes of xputs().
+ */
+
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include "FreeRTOS.h"
+#include "xil_printf.h"
+#include "latencydemo.h"
+#include "log_category.h"
+
+/* Messages above this level are compiled out, LOG_DEBUG keeps them all */
+#ifndef LOG_LEVEL_MAX
+#define LOG_LEVEL_MAX			LOG_INFO
+#endif
+
+/* Settings after boot */
+#define LOG_LEVEL_DEFAULT		LOG_INFO
+#define LOG_MASK_DEFAULT		LOG_CAT_ALL
+
+extern volatile unsigned int log_level;
+extern volatile unsigned int log_mask;
+
+#define log_enabled(level, cat) \
+	((level) <= LOG_LEVEL_MAX && (level) <= log_level && ((cat) & log_mask))
+
+/* Write 'str' to the trace buffer */
+#define log_trace(level, cat, str) \
+	do { if (log_enabled(level, cat)) xputs(str); } while (0)
+
+#define log_error(cat, str)		log_trace(LOG_ERROR, cat, str)
+#define log_warning(cat, str)	log_trace(LOG_WARNING, cat, str)
+#define log_info(cat, str)		log_trace(LOG_INFO, cat, str)
+#define log_debug(cat, str)		log_trace(LOG_DEBUG, cat, str)
+
+/* Set the level and the mask, LOG_KEEP leaves one as it is. A level above
+ * LOG_LEVEL_MAX is accepted, the messages in between stay compiled out. */
+void log_configure(unsigned int level, unsigned int mask);
+
+/* The settings in effect */
+void log_get_state(struct rpc_log_state* state);
+
+#endif /* LOGGING_H */
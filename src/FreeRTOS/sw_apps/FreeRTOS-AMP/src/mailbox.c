@@ -0,0 +1,85 @@
+/*
+ * Control mailbox, see mailbox.h.
+ *
+ * Linux maps the mailbox uncached. The request line is only read here, it
+ * is dropped from the caches before each read. The response line is written
+ * back once the command is done.
+ */
+
+#include <stdlib.h>
+#include "FreeRTOS.h"
+#include "xil_printf.h"
+
+#include "atomic.h"
+#include "cache.h"
+#include "mailbox.h"
+
+#if MAILBOX_ENABLE
+
+static mailbox_handler* mailbox_handlers[MAILBOX_COMMANDS];
+
+static void mailbox_irq(void *data)
+{
+	struct mailbox_slot* mb = MAILBOX;
+	unsigned int command;
+	unsigned int seq;
+
+	cache_sync_from_linux(&mb->seq, MAILBOX_CACHE_LINE);
+	seq = mb->seq;
+	if (seq == mb->done) {
+		/* Nothing new, the command of an earlier doorbell */
+		return;
+	}
+	/* The command was written before seq */
+	smp_mb();
+	command = mb->command;
+
+	if (command == MAILBOX_PING) {
+		mb->status = MAILBOX_OK;
+	} else if (command < MAILBOX_COMMANDS &&
+			mailbox_handlers[command] != NULL) {
+		mailbox_handlers[command](mb->arg);
+		mb->status = MAILBOX_OK;
+	} else {
+		mb->status = MAILBOX_UNKNOWN;
+	}
+
+	/* The status is complete before Linux sees done */
+	smp_mb();
+	mb->done = seq;
+	cache_sync_to_linux(&mb->done, MAILBOX_CACHE_LINE);
+}
+
+int mailbox_register(unsigned int command, mailbox_handler* handler)
+{
+	if (command >= MAILBOX_COMMANDS || mailbox_handlers[command] != NULL) {
+		return -1;
+	}
+	mailbox_handlers[command] = handler;
+	return 0;
+}
+
+void mailbox_init(void)
+{
+	struct mailbox_slot* mb = MAILBOX;
+
+	mb->magic = 0;
+	mb->doorbell = MAILBOX_IRQ;
+	mb->seq = 0;
+	mb->done = 0;
+	mb->status = MAILBOX_OK;
+	cache_sync_to_linux(mb, sizeof(*mb));
+
+	/* Linux may only use the mailbox once the rest is visible */
+	smp_mb();
+	mb->magic = MAILBOX_MAGIC;
+	cache_sync_to_linux(&mb->magic, sizeof(mb->magic));
+}
+
+void mailbox_init_irqs(void)
+{
+	xil_printf("Setup irq handler for mailbox irq %d\r\n", MAILBOX_IRQ);
+	setupIRQhandler(MAILBOX_IRQ, &mailbox_irq, NULL);
+}
+
+#endif /* MAILBOX_ENABLE */
@@ -0,0 +1,62 @@
+/*
+ * Control mailbox, a shortcut for commands which have to take effect right
+ * away (see mailbox_slot.h for the protocol).
+ *
+ * A command through rpmsg passes a descriptor, a header, the RX task and a
+ * worker before its handler runs. A mailbox command is run by the doorbell
+ * interrupt handler itself. Its handler runs in interrupt context: it must
+ * be short and may only use the FromISR functions of FreeRTOS.
+ *
+ * The mailbox is optional, Linux sends its commands through rpmsg when the
+ * magic is missing.
+ */
+
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include "mailbox_slot.h"
+#include "remoteproc_kernel.h"
+
+/* Set to 0 to leave the mailbox out */
+#define MAILBOX_ENABLE			1
+
+/* Doorbell SGI from Linux, next to the vring kicks */
+#define MAILBOX_IRQ				4
+
+/* The mailbox in the carveout, see lscript.ld */
+#define MAILBOX					((struct mailbox_slot *)MAILBOX_START)
+
+/* Handler of one command, 'arg' is passed on from Linux */
+typedef void (mailbox_handler)(unsigned int arg);
+
+#if MAILBOX_ENABLE
+
+/* Set up the mailbox, before the scheduler is started */
+void mailbox_init(void);
+
+/* Connect the doorbell interrupt, from the register_handler() callback */
+void mailbox_init_irqs(void);
+
+/* Register the handler of 'command'. Returns 0, or -1 if the command is out
+ * of range or already registered. */
+int mailbox_register(unsigned int command, mailbox_handler* handler);
+
+#else /* !MAILBOX_ENABLE */
+
+static inline void mailbox_init(void)
+{
+}
+
+static inline void mailbox_init_irqs(void)
+{
+}
+
+static inline int mailbox_register(unsigned int command,
+		mailbox_handler* handler)
+{
+	return 0;
+}
+
+#endif /* MAILBOX_ENABLE */
+
+#endif /* MAILBOX_H */
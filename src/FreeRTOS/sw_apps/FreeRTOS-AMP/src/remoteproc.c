@@ -2,11 +2,10 @@
 
 /*
  * This file contains the implemention of message passing to and from the Linux
- * Kernel, as well has the implementation of Resource Table and MMU setup.
+ * Kernel. The Resource Table and MMU setup are in 'remoteproc_rsc.c'.
  *
  * - RPMSG tx/rx vring
  * - RPMSG interrupt handling and Linux<->FreeRTOS 'kicks'
- * - MMU Setup and configuration for peripherals
  * - Functions to wrap base message passing primitives for message requests
  */
 
@@ -23,72 +22,14 @@
 
 #include "remoteproc_kernel.h"
 #include "remoteproc.h"
+#include "atomic.h"
+#include "timestamp.h"
+#include "cache.h"
+#include "dma.h"
+#include "stats.h"
 
-/* Linux host needs to know what resources are required by the FreeRTOS
- * firmware.
- *
- * This table is accessed by the kernel during initialisation of the remoteproc
- * driver in order to setup the system for AMP.
- */
-struct resource_table {
-	unsigned int version;
-	unsigned int num;
-	unsigned int reserved[2];
-	unsigned int offset[NO_RESOURCE_ENTRIES];
-	/* text carveout entry */
-	struct fw_rsc_carveout text_cout;
-	/* rpmsg vdev entry */
-	struct fw_rsc_vdev rpmsg_vdev;
-	struct fw_rsc_vdev_vring rpmsg_vring0;
-	struct fw_rsc_vdev_vring rpmsg_vring1;
-	/* trace entry */
-	struct fw_rsc_trace trace;
-	struct fw_rsc_mmu slcr;
-	struct fw_rsc_mmu uart0;
-	struct fw_rsc_mmu scu;
-};
-
-struct resource_table __resource resources = {
-	1, /* we're the first version that implements this */
-	6, /* number of entries in the table */
-	{ 0, 0, }, /* reserved, must be zero */
-	/* offsets to entries */
-	{
-		offsetof(struct resource_table, text_cout),
-		offsetof(struct resource_table, rpmsg_vdev),
-		offsetof(struct resource_table, trace),
-		offsetof(struct resource_table, slcr),
-		offsetof(struct resource_table, uart0),
-		offsetof(struct resource_table, scu),
-	},
-
-	/* End of ELF file */
-	{ TYPE_CARVEOUT, 0, 0, ELF_END, 0, 0, "TEXT/DATA", },
-
-	/* rpmsg vdev entry */
-	{ TYPE_VDEV, VIRTIO_ID_RPMSG, 0, RPMSG_IPU_C0_FEATURES, 0, 0, 0, 2,
-			{ 0, 0 }, /* no config data */ },
-
-	/* the two vrings */
-	{ RING_TX, 0x1000, VRING_SIZE, 1, 0 },
-	{ RING_RX, 0x1000, VRING_SIZE, 2, 0 },
-
-	/* Trace buffer */
-	{ TYPE_TRACE, TRACE_BUFFER_START, TRACE_BUFFER_SIZE, 0, "trace_buffer", },
-
-	/* Peripherals */
-	{ TYPE_MMU, 0, TTC_BASEADDR, 0, 0xc02, "ttc", },
-	{ TYPE_MMU, 1, STDOUT_BASEADDRESS, 0, 0xc02, "uart", },
-	{ TYPE_MMU, 2, XPS_SCU_PERIPH_BASE, 0, 0xc02, "scu", },
-};
-
-/* This FreeRTOS application address used in the communication with Linux */
-#define FREERTOS_APP_ADDR 0x50
 /* Linux address to receive service announcement */
 #define LINUX_SERVICE_ANNOUNCEMENT_ADDR 0x35
-/* Service name. It needs to match the driver name of the corresponding
- * RPMSG driver in Linux. */
-#define FREERTOS_APP_SERVICE_NAME "rpmsg-timer-statistic"
 
 xTaskHandle txVring_handler;
 xTaskHandle rxVring_handler;
@@ -96,37 +37,166 @@ xTaskHandle rxVring_handler;
 unsigned int txvring_kicks = 0;
 unsigned int rxvring_kicks = 0;
 
-/* The following variables are to record the TX ring status. 
- * The TX ring is like a round FIFO queue. We use head and tail to 
- * record whether the tx ring queue is full. The queue is full when
- * head == tail.
- * the ring_tx_ready is "1" when Linux site is ready to receive data,
- * it is "0" otherwise. */
-static unsigned int ring_tx_used_head = 0;
-static unsigned int ring_tx_used_tail = (VRING_SIZE - 1);
-static unsigned int ring_tx_ready = 0;
+/* Time of each RX kick and the avail index Linux had reached by then. Linux
+ * may put several messages into the vring for one kick, and messages may
+ * be polled before their kick is handled, so read_message() matches the
+ * messages against the avail index instead of counting kicks. */
+struct rx_kick {
+	unsigned long long time;
+	unsigned short avail;
+};
+static struct rx_kick rxvring_kick_log[VRING_SIZE];
+/* Oldest kick which may belong to a message not read yet */
+static unsigned int rxvring_kicks_read = 0;
+
+/* How long rx_poll_task polls the RX vring for the next message once
+ * rxvring_task waits for a kick, in timestamp ticks. 0 disables polling. */
+static unsigned long long rx_poll_budget =
+		(unsigned long long)REMOTEPROC_POLL_BUDGET_US * TIMESTAMP_FREQ / 1000000;
+/* End of the current poll, set before rxvring_poll is given */
+static volatile unsigned long long rx_poll_deadline = 0;
+/* Set by rx_poll_task when it woke rxvring_task instead of a kick */
+static volatile unsigned int rx_poll_found = 0;
+/* Given by rxvring_task when it starts to wait, starts rx_poll_task */
+static xSemaphoreHandle rxvring_poll;
+
+/* Counting semaphores given by the kick interrupts, the vring tasks take one
+ * per kick. Unlike suspending and resuming the tasks this cannot lose a kick
+ * that arrives while a task is about to block. */
+static xSemaphoreHandle txvring_kick;
+static xSemaphoreHandle rxvring_kick;
+
+/* The following variables are to record the TX ring status. They are
+ * updated lock-free, so messages can be sent from several tasks and from
+ * interrupt handlers at the same time.
+ *
+ * The TX ring is like a round FIFO queue. A producer reserves a slot by
+ * incrementing ring_tx_head, which may not reach ring_tx_limit (the queue is
+ * full then). ring_tx_limit moves on each time Linux releases a buffer.
+ * Once the producer has filled the slot it sets ring_tx_filled for it.
+ * Slots are published to Linux in order, ring_tx_published counts them.
+ * ring_tx_ready is "1" when Linux site is ready to receive data, it is "0"
+ * otherwise. Whoever takes it from 1 to 0 publishes the next filled slot. */
+static volatile unsigned int ring_tx_head = 0;
+static volatile unsigned int ring_tx_limit = (VRING_SIZE - 1);
+static volatile unsigned int ring_tx_published = 0;
+static volatile unsigned int ring_tx_ready = 0;
+static volatile unsigned char ring_tx_filled[VRING_SIZE];
+
+/* Senders waiting for a free TX buffer block on this semaphore, it is
+ * given each time Linux releases a buffer */
+static xSemaphoreHandle tx_space;
+
+/* Transport statistics */
+static struct remoteproc_stats stats;
+
+/* Messages handed to the endpoints, for the statistics page (stats.h) */
+static unsigned int rx_messages = 0;
+
+/* Payload size of the TX buffers. It is negotiated once Linux is ready, from
+ * the length of the buffers Linux has put into the TX vring, and is never
+ * larger than the configured PACKET_LEN_MAX. */
+static unsigned int tx_data_len_max = DATA_LEN_MAX;
+
+/* Reassembly buffer for messages passed as an indirect descriptor table */
+static unsigned char rx_chain_buf[RPMSG_RX_CHAIN_MAX];
+
+/* Largest indirect descriptor table accepted. A message never takes more
+ * descriptors than the vring has, larger tables are rejected unread. */
+#define RX_INDIRECT_MAX			VRING_SIZE
+
+/* Endpoint table. Each entry is announced to Linux as its own channel and
+ * incoming messages are dispatched on their destination address. */
+struct remoteproc_endpoint {
+	char name[RPMSG_NAME_SIZE];
+	unsigned int addr;
+	remoteproc_rx_callback* handler;
+};
 
-xSemaphoreHandle txring_mutex;
+static struct remoteproc_endpoint endpoints[RPMSG_MAX_ENDPOINTS];
+static unsigned int endpoint_count = 0;
 
-/* Application callback function pointer */
-remoteproc_rx_callback* rxcallback_handler = NULL;
+/* Set once the endpoints have been announced, endpoints registered later
+ * are announced immediately */
+static unsigned int endpoints_announced = 0;
 
 /* -------------------------------------------------------------------------- */
 
 void block_send_message(u32 src, u32 dst, void *data, u32 len);
 void read_message(void);
+static void announce_endpoint(struct remoteproc_endpoint* ept);
 
 /* -------------------------------------------------------------------------- */
-/* Mutex lock/unlock */
+/* Lock-free TX ring */
 
-static void lock_txring_mutex()
+/*
+ * Reserve the next TX slot.
+ * @return:
+ *  0: succeeded, the slot number is stored in 'slot'
+ *  -1: the TX ring is full
+ */
+static int tx_reserve(unsigned int *slot)
 {
-	while (xSemaphoreTake(txring_mutex, portMAX_DELAY) == pdFALSE)
-		;
+	unsigned int head;
+
+	do {
+		head = ring_tx_head;
+		if (head == ring_tx_limit) {
+			return -1;
+		}
+	} while (atomic_cmpxchg(&ring_tx_head, head, head + 1) != head);
+
+	*slot = head % VRING_SIZE;
+	return 0;
+}
+
+/*
+ * Publish the next filled slot to Linux if Linux is ready for it. Safe to
+ * call from any context, at most one caller publishes at a time.
+ */
+static void tx_publish(void)
+{
+	struct vring_used volatile *ring_tx_used = (void *)RING_TX_USED;
+	unsigned int slot;
+
+	for (;;) {
+		/* Only the one who takes the ready flag may publish */
+		if (atomic_cmpxchg(&ring_tx_ready, 1, 0) != 1) {
+			return;
+		}
+
+		slot = ring_tx_published % VRING_SIZE;
+		if (ring_tx_filled[slot]) {
+			ring_tx_filled[slot] = 0;
+			ring_tx_published++;
+			/* Since Linux uses idx to get the buffer sent by FreeRTOS
+			 * the buffer must be complete before idx is updated */
+			smp_mb();
+			ring_tx_used->idx = (unsigned short)ring_tx_published;
+			cache_sync_to_linux(&ring_tx_used->idx,
+					sizeof(ring_tx_used->idx));
+			/* Kick Linux since it is ready to accept data */
+			swirq_to_linux(NOTIFY_LINUX_IRQ, 1);
+			return;
+		}
+
+		/* Nothing to publish, give the ready flag back. A producer may have
+		 * filled the slot meanwhile and failed to take the flag, so check
+		 * once more. */
+		ring_tx_ready = 1;
+		smp_mb();
+		if (!ring_tx_filled[slot]) {
+			return;
+		}
+	}
 }
-static void unlock_txring_mutex()
+
+/* Linux is ready for the next message, publish it if there is one */
+static void tx_set_ready(void)
 {
-	xSemaphoreGive(txring_mutex);
+	ring_tx_ready = 1;
+	smp_mb();
+	tx_publish();
 }
 
 /* -------------------------------------------------------------------------- */
@@ -134,11 +204,14 @@ static void unlock_txring_mutex()
 
 void txvring_irq2(void *data)
 {
+	signed portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
 	/* Linux kick since it is ready for data */
-	vPortEnterCritical();
 	txvring_kicks++;
-	vPortExitCritical();
-	xTaskResumeFromISR(txVring_handler);
+	xSemaphoreGiveFromISR(txvring_kick, &xHigherPriorityTaskWoken);
+	if (xHigherPriorityTaskWoken) {
+		portYIELD_FROM_ISR();
+	}
 }
 
 static void txvring_task( void *pvParameters )
@@ -149,150 +222,294 @@ static void txvring_task( void *pvParameters )
 	} state_machine;
 
 	state_machine state = SERVICE_ANNOUNCE;
-	struct rpmsg_channel_info data;
+	unsigned int count;
+	unsigned int i;
 
-	struct vring_used volatile *ring_tx_used = (void *)RING_TX_USED;
+	struct vring_desc volatile *ring_tx = (void *)RING_TX;
 
 	for( ;; ) {
-		/* Enter a critical section, for atomicity */
-		vPortEnterCritical();
-		if (txvring_kicks) {
-			txvring_kicks--;
-			vPortExitCritical();
+		if (xSemaphoreTake(txvring_kick, portMAX_DELAY) == pdTRUE) {
 			/* Linux expects to get message*/
 			switch(state) {
 			case SERVICE_ANNOUNCE:
-				lock_txring_mutex();
-				ring_tx_ready = 1;
-				unlock_txring_mutex();
-
-				memset(&data, 0, sizeof(data));
-
-				data.src = FREERTOS_APP_ADDR;
-				data.dst = 0;
-				strncpy(data.name, FREERTOS_APP_SERVICE_NAME, RPMSG_NAME_SIZE);
+				tx_set_ready();
+
+				/* Linux has filled the TX vring, use its buffer size */
+				cache_sync_from_linux(&ring_tx[0], sizeof(ring_tx[0]));
+				if (ring_tx[0].len > sizeof(struct rpmsg_hdr) &&
+						ring_tx[0].len < PACKET_LEN_MAX) {
+					tx_data_len_max = ring_tx[0].len -
+							sizeof(struct rpmsg_hdr);
+				}
 
-				block_send_message(FREERTOS_APP_ADDR,
-						LINUX_SERVICE_ANNOUNCEMENT_ADDR, &data, sizeof(data));
+				/* Announce every registered endpoint as a channel. An
+				 * endpoint registered from now on announces itself. */
+				vPortEnterCritical();
+				count = endpoint_count;
+				endpoints_announced = 1;
+				vPortExitCritical();
+				for (i = 0; i < count; i++) {
+					announce_endpoint(&endpoints[i]);
+				}
 				state = RUNNING;
 				break;
 			case RUNNING:
-				lock_txring_mutex();
-				ring_tx_used_tail++; /* Linux has released a buffer */
-				if (ring_tx_used->idx != ring_tx_used_head) {
-					/* If there is message pending in the TX ring,
-					 * send it. */
-					ring_tx_used->idx += 1;
-					Xil_L1DCacheFlush();
-					/* Kick Linux since it is ready for data */
-					swirq_to_linux(NOTIFY_LINUX_IRQ, 1);
-				} else {
-					ring_tx_ready = 1;
-				}
-				unlock_txring_mutex();
+				/* Linux has released a buffer */
+				atomic_add_return(&ring_tx_limit, 1);
+				/* If there is message pending in the TX ring, send it. */
+				tx_set_ready();
+				/* Wake up a sender waiting for a free buffer */
+				xSemaphoreGive(tx_space);
 				break;
 			default:
 				xil_printf("Unknown state\r\n");
 				break;
 			}
-		} else {
-			vPortExitCritical();
-			vTaskSuspend(NULL);
 		}
 	}
 }
 
 void rxvring_irq3(void *data)
 {
-	/* Enter a critical section, for atomicity */
-	vPortEnterCritical();
+	signed portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+	struct vring_avail volatile *ring_rx_avail = (void *)RING_RX_AVAIL;
+	struct rx_kick *kick = &rxvring_kick_log[rxvring_kicks % VRING_SIZE];
+
 	/* Linux kick since it has put data to the RX ring */
+	kick->time = timestamp_read();
+	cache_sync_from_linux(&ring_rx_avail->idx, sizeof(ring_rx_avail->idx));
+	kick->avail = ring_rx_avail->idx;
 	rxvring_kicks++;
-	vPortExitCritical();
-	xTaskResumeFromISR(rxVring_handler);
+	xSemaphoreGiveFromISR(rxvring_kick, &xHigherPriorityTaskWoken);
+	if (xHigherPriorityTaskWoken) {
+		portYIELD_FROM_ISR();
+	}
+}
+
+/* Has Linux put a message into the RX vring that has not been read yet */
+static int rx_pending(void)
+{
+	struct vring_avail volatile *ring_rx_avail = (void *)RING_RX_AVAIL;
+	struct vring_used volatile *ring_rx_used = (void *)RING_RX_USED;
+
+	cache_sync_from_linux(&ring_rx_avail->idx, sizeof(ring_rx_avail->idx));
+	return ring_rx_avail->idx != ring_rx_used->idx;
+}
+
+/* Polls the RX vring while rxvring_task waits for a kick, until the
+ * deadline rxvring_task set. It runs at the idle priority, so polling only
+ * takes CPU time no other task wants, and it wakes rxvring_task like a kick
+ * as soon as a message is there. */
+static void rx_poll_task( void *pvParameters )
+{
+	for( ;; ) {
+		if (xSemaphoreTake(rxvring_poll, portMAX_DELAY) != pdTRUE) {
+			continue;
+		}
+		while (timestamp_read() < rx_poll_deadline) {
+			if (rx_pending()) {
+				rx_poll_found = 1;
+				xSemaphoreGive(rxvring_kick);
+				break;
+			}
+			taskYIELD();
+		}
+	}
 }
 
 static void rxvring_task( void *pvParameters )
 {
 	for( ;; ) {
-		/* Enter a critical section, for atomicity */
-		vPortEnterCritical();
-		if (rxvring_kicks) {
-			rxvring_kicks--;
-			vPortExitCritical();
+		if (rx_pending()) {
 			/* Linux has put data into rxring */
 			read_message();
-		} else {
-			vPortExitCritical();
-			vTaskSuspend(NULL);
+			continue;
+		}
+
+		/* Idle, wait for a kick. Kicks of messages which have been read
+		 * already are dropped first, any kick after the check below wakes
+		 * us up. */
+		while (xSemaphoreTake(rxvring_kick, 0) == pdTRUE)
+			;
+		if (rx_pending()) {
+			continue;
+		}
+		if (rx_poll_budget != 0) {
+			rx_poll_found = 0;
+			rx_poll_deadline = timestamp_read() + rx_poll_budget;
+			xSemaphoreGive(rxvring_poll);
+		}
+		if (xSemaphoreTake(rxvring_kick, portMAX_DELAY) == pdTRUE) {
+			if (rx_poll_found) {
+				atomic_add_return(&stats.rx_polled, 1);
+			} else {
+				atomic_add_return(&stats.rx_woken, 1);
+			}
 		}
 	}
 }
 
+void remoteproc_set_poll_budget(unsigned int us)
+{
+	rx_poll_budget = (unsigned long long)us * TIMESTAMP_FREQ / 1000000;
+}
+
 /* -------------------------------------------------------------------------- */
 
 /*
- * Function to send messages to Linux through txvring.
+ * Reserve the next TX buffer for a message. It does not block and may be
+ * called from tasks as well as from interrupt handlers.
  * @para:
- *  src: source address of the remote processor message
- *  dst: destination address of the remote processor message
- *  data: data of the message
- *  len: length of the data
+ *  buf: the reservation, filled in on success
  * @return:
  *  0: succeeded
- *  1: failed
+ *  -1: the TX ring is full
  */
-int __send_message(u32 src, u32 dst, void *data, u32 len)
+int remoteproc_try_reserve(struct remoteproc_tx_buffer* buf)
 {
-	struct vring_used volatile *ring_tx_used = (void *)RING_TX_USED;
 	struct vring_desc volatile *ring_tx = (void *)RING_TX;
-	
+	unsigned long long start = timestamp_read();
 	unsigned int index;
-	
-	lock_txring_mutex();
-	index = ring_tx_used_head % VRING_SIZE;
-	if (index == (ring_tx_used_tail % VRING_SIZE)) {
-		unlock_txring_mutex();
-		xil_printf("Vring TX is full\r\n");
+
+	if (tx_reserve(&index)) {
+		atomic_add_return(&stats.tx_full, 1);
 		return -1;
 	}
-	ring_tx_used_head++;
-	unlock_txring_mutex();
-	struct rpmsg_hdr *hdr = (struct rpmsg_hdr *)(ring_tx[index].addr &
-			VRING_ADDR_MASK);
+	cache_sync_from_linux(&ring_tx[index], sizeof(ring_tx[index]));
 
-	/* Check if data size is greater than packed size - if yes, send just part
-	 * of it */
-	len = len > DATA_LEN_MAX ? DATA_LEN_MAX : len;
+	buf->__hdr = vring_desc_buf(&ring_tx[index]);
+	buf->__slot = index;
+	buf->__start = start;
+	buf->data = buf->__hdr->data;
+	buf->size = tx_data_len_max;
+	return 0;
+}
+
+/*
+ * Reserve the next TX buffer for a message.
+ * If the TX ring is full it waits until Linux releases a buffer, but not
+ * longer than 'timeout' ticks. Must not be called from interrupt handlers.
+ * @para:
+ *  buf: the reservation, filled in on success
+ *  timeout: ticks to wait at most, portMAX_DELAY waits forever
+ * @return:
+ *  0: succeeded
+ *  -1: timed out
+ */
+int remoteproc_reserve(struct remoteproc_tx_buffer* buf, portTickType timeout)
+{
+	portTickType start = xTaskGetTickCount();
+	portTickType waited;
+	unsigned int blocked = 0;
+
+	while (remoteproc_try_reserve(buf)) {
+		if (timeout != portMAX_DELAY) {
+			waited = xTaskGetTickCount() - start;
+			if (waited >= timeout) {
+				return -1;
+			}
+			xSemaphoreTake(tx_space, timeout - waited);
+		} else {
+			xSemaphoreTake(tx_space, portMAX_DELAY);
+		}
+		blocked = 1;
+	}
+
+	/* Several buffers may have been released while we were waiting but only
+	 * one sender was woken, pass the wake up on to the next one */
+	if (blocked) {
+		xSemaphoreGive(tx_space);
+	}
+	return 0;
+}
+
+/*
+ * Pass a reserved TX buffer to Linux as a message of 'len' bytes. The
+ * payload has been written to buf->data already.
+ * @para:
+ *  buf: the reservation
+ *  src: source address of the remote processor message
+ *  dst: destination address of the remote processor message
+ *  len: length of the payload, at most buf->size
+ */
+void remoteproc_commit(struct remoteproc_tx_buffer* buf, unsigned int src,
+		unsigned int dst, unsigned int len)
+{
+	struct vring_used volatile *ring_tx_used = (void *)RING_TX_USED;
+	struct rpmsg_hdr *hdr = buf->__hdr;
+	unsigned int index = buf->__slot;
+
+	len = len > buf->size ? buf->size : len;
 
-	/* Clear the whole message */
-	memset(hdr, 0, (char)PACKET_LEN_MAX);
 	hdr->src = src;
 	hdr->dst = dst;
 	hdr->reserved = 0;
 	hdr->flags = 0;
 	hdr->len = (unsigned short)len; // data len
-	memcpy(&hdr->data, data, hdr->len);
+	cache_sync_to_linux(hdr, sizeof(struct rpmsg_hdr) + len);
 
 	ring_tx_used->ring[index].id = index;
-	ring_tx_used->ring[index].len = PACKET_LEN_MAX;
-
-	lock_txring_mutex();
-	if (ring_tx_ready) {
-		/* Since Linux uses idx to get the buffer sent by FreeRTOS
-		 * We should not modify this TX used ring's idx until Linux
-		 * is ready to accept new data. */
-		ring_tx_used->idx += 1; 
-		Xil_L1DCacheFlush();
-		/* Kick Linux since it is ready to accept data */
-		swirq_to_linux(NOTIFY_LINUX_IRQ, 1);
-		ring_tx_ready--;
-	} else {
-		/* Linux is not ready. Just update the buffer content,
-		 * but not kick Linux */
-		Xil_L1DCacheFlush();
+	ring_tx_used->ring[index].len = sizeof(struct rpmsg_hdr) + len;
+	cache_sync_to_linux(&ring_tx_used->ring[index],
+			sizeof(ring_tx_used->ring[index]));
+
+	/* The slot is complete. We should not modify this TX used ring's idx
+	 * until Linux is ready to accept new data, tx_publish() takes care of
+	 * that. */
+	smp_mb();
+	ring_tx_filled[index] = 1;
+	tx_publish();
+
+	/* Account the time from the reservation to the message being sent */
+	vPortEnterCritical();
+	stats.tx_messages++;
+	stats.tx_time += timestamp_read() - buf->__start;
+	vPortExitCritical();
+}
+
+/*
+ * Function to send messages to Linux through txvring, by copying the data
+ * into a reserved buffer.
+ * If the TX ring is full it waits until Linux releases a buffer, but not
+ * longer than 'timeout' ticks. Must not be called from interrupt handlers.
+ * @para:
+ *  src: source address of the remote processor message
+ *  dst: destination address of the remote processor message
+ *  data: data of the message
+ *  len: length of the data, the part that does not fit a buffer is dropped
+ *  timeout: ticks to wait at most, portMAX_DELAY waits forever
+ * @return:
+ *  0: succeeded
+ *  -1: timed out
+ */
+int remoteproc_send(unsigned int src, unsigned int dst, void *data,
+		unsigned int len, portTickType timeout)
+{
+	struct remoteproc_tx_buffer buf;
+
+	if (remoteproc_reserve(&buf, timeout)) {
+		return -1;
 	}
-	unlock_txring_mutex();
+	len = len > buf.size ? buf.size : len;
+	dma_memcpy(buf.data, data, len);
+	remoteproc_commit(&buf, src, dst, len);
+	return 0;
+}
+
+/* Non-blocking send, may be called from interrupt handlers. The copy must
+ * not wait for the DMAC then. */
+int remoteproc_try_send(unsigned int src, unsigned int dst, void *data,
+		unsigned int len)
+{
+	struct remoteproc_tx_buffer buf;
+
+	if (remoteproc_try_reserve(&buf)) {
+		return -1;
+	}
+	len = len > buf.size ? buf.size : len;
+	memcpy(buf.data, data, len);
+	remoteproc_commit(&buf, src, dst, len);
 	return 0;
 }
 
@@ -309,45 +526,229 @@ int __send_message(u32 src, u32 dst, void *data, u32 len)
  */
 void block_send_message(u32 src, u32 dst, void *data, u32 len)
 {
-	while(__send_message(src, dst, data , len)) {
-		portTickType xNextWakeTime;
-		/* Initialise xNextWakeTime */
-		xNextWakeTime = xTaskGetTickCount();
-		vTaskDelayUntil( &xNextWakeTime, 1 / portTICK_RATE_MS );
+	remoteproc_send(src, dst, data, len, portMAX_DELAY);
+}
+
+/*
+ * Copy a message passed as an indirect descriptor table into the reassembly
+ * buffer. The descriptors of the table are chained via their "next" field.
+ * Linux writes the table, so its size and every link are checked before
+ * they are used.
+ * @para:
+ *  table: the indirect descriptor table
+ *  num: number of descriptors in the table
+ * @return:
+ *  total length of the message, -1 if the table is malformed
+ */
+static int read_indirect_chain(struct vring_desc volatile *table,
+		unsigned int num)
+{
+	unsigned int count = num;
+	unsigned int len = 0;
+	unsigned int part;
+	unsigned int i = 0;
+
+	if (num == 0 || num > RX_INDIRECT_MAX) {
+		return -1;
+	}
+	cache_sync_from_linux(table, num * sizeof(struct vring_desc));
+	while (count-- && len < RPMSG_RX_CHAIN_MAX) {
+		part = table[i].len;
+		if (part > RPMSG_RX_CHAIN_MAX - len) {
+			part = RPMSG_RX_CHAIN_MAX - len;
+		}
+		cache_sync_from_linux(vring_desc_buf(&table[i]), part);
+		memcpy(rx_chain_buf + len, vring_desc_buf(&table[i]), part);
+		len += part;
+
+		if (!(table[i].flags & VRING_DESC_F_NEXT)) {
+			break;
+		}
+		i = table[i].next;
+		if (i >= num) {
+			return -1;
+		}
 	}
+	return len;
+}
+
+/* Look up the endpoint registered at a local address */
+static struct remoteproc_endpoint* find_endpoint(unsigned int addr)
+{
+	unsigned int i;
+
+	for (i = 0; i < endpoint_count; i++) {
+		if (endpoints[i].addr == addr) {
+			return &endpoints[i];
+		}
+	}
+	return NULL;
+}
+
+/* Time of the first kick after Linux had made the message at 'used'
+ * available, REMOTEPROC_NO_KICK if that kick has not been handled yet (the
+ * message was polled). A kick stays in the log as long as it may belong to
+ * a later message too. */
+static unsigned long long rx_kick_time(unsigned short used)
+{
+	unsigned int kicks = rxvring_kicks;
+	struct rx_kick *kick;
+
+	/* The log wraps when kicks are not matched for a long time, which only
+	 * happens to kicks of messages that have been polled */
+	if (kicks - rxvring_kicks_read > VRING_SIZE) {
+		rxvring_kicks_read = kicks - VRING_SIZE;
+	}
+
+	while (rxvring_kicks_read != kicks) {
+		kick = &rxvring_kick_log[rxvring_kicks_read % VRING_SIZE];
+		/* Linux had put the message in by the time of this kick */
+		if ((short)(kick->avail - used) > 0) {
+			return kick->time;
+		}
+		/* The kick was for earlier messages only */
+		rxvring_kicks_read++;
+	}
+	return REMOTEPROC_NO_KICK;
 }
 
 /* Function to receive message from Linux from rxvring. */
 void read_message(void)
 {
+	unsigned long long task_time = timestamp_read();
 	struct vring_used volatile *ring_rx_used = (void *)RING_RX_USED;
 	unsigned int index = ring_rx_used->idx % VRING_SIZE;
 
 	struct vring_desc volatile *ring_rx = (void *)RING_RX;
-	struct rpmsg_hdr *hdr = (struct rpmsg_hdr *)(ring_rx[index].addr &
-			VRING_ADDR_MASK);
+	struct rpmsg_hdr *hdr;
+	struct remoteproc_request req;
+	struct remoteproc_endpoint* ept;
+	int total = PACKET_LEN_MAX;
+
+	cache_sync_from_linux(&ring_rx[index], sizeof(ring_rx[index]));
+	if (ring_rx[index].flags & VRING_DESC_F_INDIRECT) {
+		/* Large message, gather it from the descriptor table */
+		total = read_indirect_chain(vring_desc_buf(&ring_rx[index]),
+				ring_rx[index].len / sizeof(struct vring_desc));
+		hdr = (struct rpmsg_hdr *)rx_chain_buf;
+		if (total < 0) {
+			/* Not read, the buffer only goes back to Linux */
+			atomic_add_return(&stats.rx_dropped, 1);
+			total = 0;
+			hdr = NULL;
+		} else if (total < sizeof(struct rpmsg_hdr)) {
+			hdr->len = 0;
+		} else if (hdr->len > total - sizeof(struct rpmsg_hdr)) {
+			hdr->len = total - sizeof(struct rpmsg_hdr);
+		}
+	} else if (ring_rx[index].flags & VRING_DESC_F_NEXT) {
+		/* Direct descriptor chains are not supported, a message of several
+		 * buffers has to come as an indirect table. Reading the first buffer
+		 * alone would pass on a truncated message. */
+		atomic_add_return(&stats.rx_dropped, 1);
+		total = 0;
+		hdr = NULL;
+	} else {
+		hdr = vring_desc_buf(&ring_rx[index]);
+		cache_sync_from_linux(hdr, sizeof(struct rpmsg_hdr));
+		if (hdr->len > DATA_LEN_MAX) {
+			hdr->len = DATA_LEN_MAX;
+		}
+		cache_sync_from_linux(hdr->data, hdr->len);
+	}
+	req.kick_time = rx_kick_time(ring_rx_used->idx);
+	req.task_time = task_time;
+
+	if (hdr != NULL) {
+		/* Create a req structure to pass to handler */
+		req.__hdr = hdr;
+		req.state = *(unsigned int *)hdr->data;
+		rx_messages++;
+
+		/* Dispatch to the endpoint the message is addressed to */
+		ept = find_endpoint(hdr->dst);
+		if (ept != NULL) {
+			ept->handler(&req, hdr->data, hdr->len);
+		}
+	}
 
-	/* Update index */
+	/* Update index. Only now the buffer is given back, the handler works on
+	 * it in place and may have written to it. */
+	if (hdr != NULL && hdr != (struct rpmsg_hdr *)rx_chain_buf) {
+		cache_sync_to_linux(hdr, sizeof(struct rpmsg_hdr) + hdr->len);
+	}
 	ring_rx_used->ring[index].id = index;
-	ring_rx_used->ring[index].len = PACKET_LEN_MAX;
+	ring_rx_used->ring[index].len = total;
+	cache_sync_to_linux(&ring_rx_used->ring[index],
+			sizeof(ring_rx_used->ring[index]));
+	smp_mb();
 	ring_rx_used->idx += 1; // last index 0 keep increasing
+	cache_sync_to_linux(&ring_rx_used->idx, sizeof(ring_rx_used->idx));
+	return;
+}
 
-	/* Create a req structure to pass to handler */
-	struct remoteproc_request req;
-	req.__hdr = hdr;
-	req.state = *(unsigned int *)hdr->data;
+/* -------------------------------------------------------------------------- */
+/* Endpoint functions */
+
+/* Send the name service announcement of an endpoint to Linux */
+static void announce_endpoint(struct remoteproc_endpoint* ept)
+{
+	struct rpmsg_channel_info data;
+
+	memset(&data, 0, sizeof(data));
+
+	data.src = ept->addr;
+	data.dst = 0;
+	/* NUL terminated and padded, see remoteproc_register_endpoint() */
+	memcpy(data.name, ept->name, RPMSG_NAME_SIZE);
 
-	if (rxcallback_handler != NULL) {
-		rxcallback_handler(&req, hdr->data, hdr->len);
+	block_send_message(ept->addr, LINUX_SERVICE_ANNOUNCEMENT_ADDR, &data,
+			sizeof(data));
+}
+
+int remoteproc_register_endpoint(const char* name, unsigned int addr,
+		remoteproc_rx_callback* handler)
+{
+	struct remoteproc_endpoint* ept;
+	unsigned int announce;
+
+	if (name == NULL || handler == NULL || strlen(name) >= RPMSG_NAME_SIZE) {
+		return -1;
 	}
 
-	Xil_L1DCacheFlush();
-	return;
+	vPortEnterCritical();
+	if (endpoint_count == RPMSG_MAX_ENDPOINTS || find_endpoint(addr) != NULL) {
+		vPortExitCritical();
+		return -1;
+	}
+	ept = &endpoints[endpoint_count];
+	memset(ept->name, 0, RPMSG_NAME_SIZE);
+	memcpy(ept->name, name, strlen(name));
+	ept->addr = addr;
+	ept->handler = handler;
+	endpoint_count++;
+	/* Decided together with adding the endpoint, txvring_task announces
+	 * either all endpoints counted so far or none of them */
+	announce = endpoints_announced;
+	vPortExitCritical();
+
+	/* Linux is already running, announce the new channel right away */
+	if (announce) {
+		announce_endpoint(ept);
+	}
+	return 0;
 }
 
 /* -------------------------------------------------------------------------- */
 /* Message handling functions */
 
+void remoteproc_get_stats(struct remoteproc_stats* out)
+{
+	vPortEnterCritical();
+	*out = stats;
+	vPortExitCritical();
+}
+
 void remoteproc_request_ack(struct remoteproc_request* req)
 {
 	/* Send acknowledgement */
@@ -369,10 +770,10 @@ void remoteproc_request_response(struct remoteproc_request* req,
 		int total = len;
 		int tmpsize = 0;
 		int sum = 0;
-		/* Segment the transfer into 'DATA_LEN_MAX' size chunks */
+		/* Segment the transfer into chunks of the negotiated buffer size */
 		for (; sum < total; ) {
-			tmpsize = (total - sum) <= DATA_LEN_MAX ? (total - sum) :
-					DATA_LEN_MAX;
+			tmpsize = (total - sum) <= tx_data_len_max ? (total - sum) :
+					tx_data_len_max;
 			block_send_message(req->__hdr->dst, req->__hdr->src,
 					(char *)(data + sum), tmpsize);
 			sum += tmpsize;
@@ -383,16 +784,38 @@ void remoteproc_request_response(struct remoteproc_request* req,
 /* -------------------------------------------------------------------------- */
 
 /* Setup Function */
-void remoteproc_init(remoteproc_rx_callback* handler)
+void remoteproc_init(void)
 {
-	rxcallback_handler = handler;
+	timestamp_init();
 
-	/* Create txring mutex */
-	vSemaphoreCreateBinary( txring_mutex );
-	if (txring_mutex == NULL) {
-		xil_printf("ERROR: Failed to create TX Ring mutext!\r\n");
+	/* Create the semaphore senders wait on while the TX ring is full */
+	vSemaphoreCreateBinary(tx_space);
+	if (tx_space == NULL) {
+		xil_printf("ERROR: Failed to create TX space semaphore!\r\n");
+		return;
+	}
+	/* vSemaphoreCreateBinary() creates the semaphore given */
+	xSemaphoreTake(tx_space, 0);
+
+	/* Create the semaphores counting the kicks from Linux */
+	txvring_kick = xSemaphoreCreateCounting(VRING_SIZE, 0);
+	rxvring_kick = xSemaphoreCreateCounting(VRING_SIZE, 0);
+	if (txvring_kick == NULL || rxvring_kick == NULL) {
+		xil_printf("ERROR: Failed to create vring kick semaphores!\r\n");
 		return;
 	}
+	rxvring_poll = xSemaphoreCreateCounting(1, 0);
+	if (rxvring_poll == NULL) {
+		xil_printf("ERROR: Failed to create RX poll semaphore!\r\n");
+		return;
+	}
+
+	/* The statistics task publishes the counters of the transport */
+	stats_register_counter("tx_kicks", &txvring_kicks);
+	stats_register_counter("rx_kicks", &rxvring_kicks);
+	stats_register_counter("tx_messages", &stats.tx_messages);
+	stats_register_counter("rx_messages", &rx_messages);
+	stats_register_counter("tx_full", &stats.tx_full);
 
 	/* Setup tx/rx vring processing tasks */
 	xTaskCreate( txvring_task, ( signed char * ) "TXVRING_TASK",
@@ -401,6 +824,8 @@ void remoteproc_init(remoteproc_rx_callback* handler)
 	xTaskCreate( rxvring_task, ( signed char * ) "RXVRING_TASK",
 			configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY + 3,
 			&rxVring_handler);
+	xTaskCreate( rx_poll_task, ( signed char * ) "RXPOLL_TASK",
+			configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY, NULL);
 }
 
 /* Setup IRQ Function */
@@ -411,68 +836,9 @@ void remoteproc_init_irqs(void)
 	setupIRQhandler(3, &rxvring_irq3, NULL);
 }
 
-/* Setup the Trace Buffer */
+/* Setup the Trace Buffer and the header Linux follows it with */
 void trace_init(void)
 {
 	stdio_lock_init(TRACE_BUFFER_START, TRACE_BUFFER_SIZE);
-}
-
-/* -------------------------------------------------------------------------- */
-/* Resource Setup Functions */
-
-void enable_tlb(unsigned int addr, unsigned int flags)
-{
-	extern char *MMUTable;
-	unsigned int link;
-
-	addr = addr & ~0xFFFFF; /* Address must be 1MB aligned */
-	link = (u32)&MMUTable + ((addr / 0x100000) * 4);
-	safe_printf("Setup TLB for address %x, TLBptr %x\n\r", addr, link);
-
-	*(u32 *)link = addr | flags;
-	Xil_L1DCacheFlush();
-}
-
-void disable_tlb(unsigned int addr)
-{
-	extern char *MMUTable;
-	unsigned int link;
-
-	addr = addr & ~0xFFFFF; /* Address must be 1MB aligned */
-	link = (u32)&MMUTable + ((addr / 0x100000) * 4);
-	safe_printf("Clear TLB for address %x, TLBptr %x\n\r", addr, link);
-
-	*(u32 *)link = addr | 0x000;
-	Xil_L1DCacheFlush();
-}
-
-void mmu_resource_table_setup(void)
-{
-	int i;
-
-	if (resources.version == 1) {
-		unsigned char *ptr = (unsigned char *)&resources;
-
-		for (i = 0; i < resources.num; i++) {
-			int offset = resources.offset[i];
-			unsigned int type = *(unsigned int *)(ptr + offset);
-			if (offset && (type == TYPE_MMU)) {
-				struct fw_rsc_mmu *mmu = (struct fw_rsc_mmu *)(ptr + offset);
-				safe_printf("Setup TLB for %d:%s\n", mmu->id, mmu->name);
-				enable_tlb(mmu->da, mmu->flags);
-			}
-		}
-	}
-
-	extern char *MMUTable;
-	safe_printf("Protect MMU Table at %x\n\r", (u32)&MMUTable);
-
-	/* This is the most important lines - disable access to MMU table
-	 * to avoid currupting Linux */
-	disable_tlb((u32)&MMUTable);
-	Xil_L1DCacheFlush();
-	/* Flush all TLBs */
-	__asm__ __volatile__("dsb; mov	%0,#0; \
-			mcr	p15, 0, r0, c8, c7, 0;" \
-				: "=r" (i));
+	stdio_ring_init(TRACE_RING_START);
 }
@@ -3,6 +3,8 @@
 #ifndef REMOTEPROC_H
 #define REMOTEPROC_H
 
+#include "FreeRTOS.h"
+
 /* TTC1 base address, mapped by the remoteproc resource initialization */
 #ifndef TTC_BASEADDR
 #define TTC_BASEADDR 0XF8002000
@@ -16,21 +18,106 @@ void mmu_resource_table_setup(void);
 struct remoteproc_request {
 	struct rpmsg_hdr* __hdr;
 	unsigned int state;
+	/* Timestamps of the kick interrupt and of the RX task picking up the
+	 * message, in timestamp ticks (see timestamp.h). The kick time is
+	 * REMOTEPROC_NO_KICK if the message was polled before its kick was
+	 * handled. */
+	unsigned long long kick_time;
+	unsigned long long task_time;
 };
 
+/* Kick time of a message read without a kick */
+#define REMOTEPROC_NO_KICK					0ULL
+
 /* Mask for the state field which is stored as the first word in each message */
 #define REMOTEPROC_REQUEST_ACK_MASK			0x80000000
 
 typedef void (remoteproc_rx_callback)(struct remoteproc_request* req,
 		unsigned char* data, unsigned int len);
 
+/* Transport statistics */
+struct remoteproc_stats {
+	/* Messages sent to Linux */
+	unsigned int tx_messages;
+	/* Send attempts that found the TX ring full */
+	unsigned int tx_full;
+	/* Total time from reserving the TX buffer to passing it to Linux for
+	 * the sent messages, in timestamp ticks (see timestamp.h) */
+	unsigned long long tx_time;
+	/* Messages found by polling the RX vring, and wake ups of the RX task
+	 * by a kick */
+	unsigned int rx_polled;
+	unsigned int rx_woken;
+	/* Messages dropped because Linux passed a malformed descriptor table or
+	 * a direct descriptor chain */
+	unsigned int rx_dropped;
+};
+
+void remoteproc_get_stats(struct remoteproc_stats* out);
+
+/* Default poll budget of the RX vring in microseconds, see
+ * remoteproc_set_poll_budget() */
+#define REMOTEPROC_POLL_BUDGET_US		0
+
+/* After the last message a task at the idle priority polls the RX vring for
+ * 'us' microseconds while the RX task waits for the kick interrupt, and
+ * wakes it when the next message is there. This saves the interrupt for
+ * messages following each other closely, using CPU time no other task
+ * wants. 0 disables polling. */
+void remoteproc_set_poll_budget(unsigned int us);
+
 /* trace buffer init function */
 void trace_init(void);
 
 /* Remoteproc init functions */
-void remoteproc_init(remoteproc_rx_callback* handler);
+void remoteproc_init(void);
 void remoteproc_init_irqs(void);
 
+/* Register an endpoint at the local address 'addr'. Every endpoint is
+ * announced to Linux as a channel named 'name', messages sent to it are
+ * passed to 'handler'. Returns 0 on success, -1 if the name does not fit
+ * into RPMSG_NAME_SIZE with its terminating NUL, the address is in use or
+ * the endpoint table is full. */
+int remoteproc_register_endpoint(const char* name, unsigned int addr,
+		remoteproc_rx_callback* handler);
+
+/* Message send functions. remoteproc_send() blocks while the TX ring is full,
+ * at most 'timeout' ticks (portMAX_DELAY waits forever), and returns -1 if it
+ * timed out. remoteproc_try_send() never blocks and may be called from
+ * interrupt handlers, it returns -1 if the TX ring is full. */
+int remoteproc_send(unsigned int src, unsigned int dst, void* data,
+		unsigned int len, portTickType timeout);
+int remoteproc_try_send(unsigned int src, unsigned int dst, void* data,
+		unsigned int len);
+
+/* A TX buffer reserved for one message, see remoteproc_reserve() */
+struct remoteproc_tx_buffer {
+	struct rpmsg_hdr* __hdr;
+	unsigned int __slot;
+	unsigned long long __start;
+	/* Payload of the message, written in place by the sender */
+	unsigned char* data;
+	/* Space at 'data', the negotiated buffer size */
+	unsigned int size;
+};
+
+/* Zero-copy send. remoteproc_reserve() hands out the next TX buffer, the
+ * sender writes the payload to 'data' in place and remoteproc_commit()
+ * passes the first 'len' bytes to Linux.
+ *
+ * Buffers are passed to Linux in the order they were reserved, a reserved
+ * buffer holds up the messages of all other senders until it is committed.
+ * Fill it without blocking and commit it right away. A reservation cannot
+ * be taken back, commit it with 'len' 0 to send an empty message instead.
+ *
+ * remoteproc_reserve() waits like remoteproc_send() and returns -1 if it
+ * timed out, remoteproc_try_reserve() never blocks and may be called from
+ * interrupt handlers, it returns -1 if the TX ring is full. */
+int remoteproc_reserve(struct remoteproc_tx_buffer* buf, portTickType timeout);
+int remoteproc_try_reserve(struct remoteproc_tx_buffer* buf);
+void remoteproc_commit(struct remoteproc_tx_buffer* buf, unsigned int src,
+		unsigned int dst, unsigned int len);
+
 /* Message response functions */
 void remoteproc_request_ack(struct remoteproc_request* req);
 void remoteproc_request_response(struct remoteproc_request* req,
@@ -0,0 +1,56 @@
+/*
+ * Build-time configuration of the shared memory layout used for the
+ * communication with Linux.
+ *
+ * This header is the single definition of the vring depth, the rpmsg buffer
+ * size and the sizes of the trace buffers. The linker script includes
+ * 'remoteproc_config.ld', which is generated from this file by running:
+ *
+ *   tclsh ../data/FreeRTOS-AMP.tcl .
+ *
+ * Keep every value a plain '#define NAME value' line with a numeric value so
+ * the generator can pick it up. Regenerate the linker fragment after editing.
+ */
+
+#ifndef REMOTEPROC_CONFIG_H
+#define REMOTEPROC_CONFIG_H
+
+/* Number of descriptors in each vring (must be a power of two) */
+#define RPMSG_VRING_SIZE			256
+
+/* Alignment of the used ring inside a vring. A whole vring (descriptors,
+ * avail and used ring) has to fit into twice this size, the linker script
+ * checks it. */
+#define RPMSG_VRING_ALIGN			0x1000
+
+/* Size of one rpmsg buffer including the rpmsg header. This must not be
+ * larger than the buffers Linux allocates (RPMSG_BUF_SIZE in
+ * virtio_rpmsg_bus.c), it is clamped at run time to the length of the
+ * descriptors. Messages to Linux never take more than one buffer. */
+#define RPMSG_BUFFER_SIZE			512
+
+/* Largest message accepted on the RX path when Linux passes an indirect
+ * descriptor table, including the rpmsg header. Direct descriptor chains
+ * are dropped. Only the RX path takes large messages, TX is limited to one
+ * buffer of RPMSG_BUFFER_SIZE. */
+#define RPMSG_RX_CHAIN_MAX			4096
+
+/* Number of rpmsg endpoints (services) the firmware can announce */
+#define RPMSG_MAX_ENDPOINTS			8
+
+/* Size of the trace buffer in the carveout, a power of two */
+#define TRACE_BUFFER_SIZE			0x8000
+
+/* Size of the binary log in the carveout (see binlog.h), a power of two.
+ * Each record takes 32 bytes. */
+#define BINLOG_BUFFER_SIZE			0x2000
+
+/* Size of the kernel event buffer in the carveout (portTRACE_EVENTS in
+ * portmacro.h), a power of two. Each event takes 16 bytes. */
+#define EVENT_BUFFER_SIZE			0x8000
+
+/* Size of the data area of the bulk channel in the carveout (see spsc.c),
+ * a power of two. The channel takes one more page for its indices. */
+#define BULK_CHANNEL_DATA_SIZE		0x10000
+
+#endif /* REMOTEPROC_CONFIG_H */
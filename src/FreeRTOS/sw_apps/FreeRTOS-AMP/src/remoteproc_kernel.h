@@ -12,36 +12,53 @@
 #ifndef REMOTEPROC_KERNEL_H
 #define REMOTEPROC_KERNEL_H
 
-/* Just load all symbols from Linker script */
-extern char *__ring_rx_addr;
-#define RING_RX					(unsigned int)&__ring_rx_addr
-extern char *__ring_tx_addr;
-#define RING_TX					(unsigned int)&__ring_tx_addr
-
-extern char *__ring_tx_addr_used;
-#define RING_TX_USED			(unsigned int)&__ring_tx_addr_used
-extern char *__ring_rx_addr_used;
-#define RING_RX_USED			(unsigned int)&__ring_rx_addr_used
-
-extern char *_start; /* ELF_START should be zero all the time */
-#define ELF_START				(unsigned int)&_start
-extern char *__elf_end;
-#define ELF_END					(unsigned int)&__elf_end
+#include "remoteproc_config.h"
 
-extern char *__trace_buffer_start;
-#define TRACE_BUFFER_START		(unsigned int)&__trace_buffer_start
-extern char *__trace_buffer_end;
-#define TRACE_BUFFER_END		(unsigned int)&__trace_buffer_end
-
-/* This value should be shared with Linker script */
-#define TRACE_BUFFER_SIZE		0x8000
+/* Just load all symbols from Linker script */
+extern char __ring_rx_addr[];
+#define RING_RX					(unsigned long)&__ring_rx_addr
+extern char __ring_tx_addr[];
+#define RING_TX					(unsigned long)&__ring_tx_addr
+
+extern char __ring_tx_addr_used[];
+#define RING_TX_USED			(unsigned long)&__ring_tx_addr_used
+extern char __ring_rx_addr_used[];
+#define RING_RX_USED			(unsigned long)&__ring_rx_addr_used
+
+extern char _start[]; /* ELF_START should be zero all the time */
+#define ELF_START				(unsigned long)&_start
+extern char __elf_end[];
+#define ELF_END					(unsigned long)&__elf_end
+
+extern char __trace_buffer_start[];
+#define TRACE_BUFFER_START		(unsigned long)&__trace_buffer_start
+extern char __trace_buffer_end[];
+#define TRACE_BUFFER_END		(unsigned long)&__trace_buffer_end
+extern char __trace_ring_start[];
+#define TRACE_RING_START		(unsigned long)&__trace_ring_start
+extern char __binlog_ring_start[];
+#define BINLOG_RING_START		(unsigned long)&__binlog_ring_start
+extern char __binlog_buffer_start[];
+#define BINLOG_BUFFER_START		(unsigned long)&__binlog_buffer_start
+extern char __event_ring_start[];
+#define EVENT_RING_START		(unsigned long)&__event_ring_start
+extern char __event_buffer_start[];
+#define EVENT_BUFFER_START		(unsigned long)&__event_buffer_start
+
+extern char __bulk_channel_start[];
+#define BULK_CHANNEL_START		(unsigned long)&__bulk_channel_start
+
+extern char __mailbox_start[];
+#define MAILBOX_START			(unsigned long)&__mailbox_start
+extern char __stats_page_start[];
+#define STATS_PAGE_START		(unsigned long)&__stats_page_start
 
 /* section helpers */
 #define __section(S)			__attribute__((__section__(#S)))
 #define __resource				__section(.resource_table)
 
 /* flip up bits whose indices represent features we support */
-#define RPMSG_IPU_C0_FEATURES	1
+#define RPMSG_IPU_C0_FEATURES	(1 << VIRTIO_RPMSG_F_NS)
 
 /* virtio ids: keep in sync with the linux "include/linux/virtio_ids.h" */
 #define VIRTIO_ID_CONSOLE		3 /* virtio console */
@@ -133,6 +150,13 @@ struct rpmsg_hdr {
 } __packed;
 
 
+/* This marks a buffer as continuing via the next field. */
+#define VRING_DESC_F_NEXT			1
+/* This marks a buffer as write-only (otherwise read-only). */
+#define VRING_DESC_F_WRITE			2
+/* This means the buffer contains a list of buffer descriptors. */
+#define VRING_DESC_F_INDIRECT		4
+
 /* Virtio ring descriptors: 16 bytes.  These can chain together via "next" */
 struct vring_desc {
 	unsigned int addr; /* Address (guest-physical). */
@@ -142,6 +166,17 @@ struct vring_desc {
 	unsigned short next; /* We chain unused descriptors via this, too */
 };
 
+/* Available ring, written by the driver side (Linux). It directly follows the
+ * descriptor table of a vring. */
+struct vring_avail {
+	unsigned short flags;
+	unsigned short idx;
+	unsigned short ring[];
+};
+
+#define RING_TX_AVAIL			(RING_TX + VRING_SIZE * sizeof(struct vring_desc))
+#define RING_RX_AVAIL			(RING_RX + VRING_SIZE * sizeof(struct vring_desc))
+
 /* unsigned int is used here for ids for padding reasons. */
 struct vring_used_elem {
 	unsigned int id; /* Index of start of used descriptor chain. */
@@ -155,7 +190,14 @@ struct vring_used {
 };
 
 #define VRING_ADDR_MASK				0xffffff
-#define VRING_SIZE					256
+#define VRING_SIZE					RPMSG_VRING_SIZE
+
+/* Buffer a descriptor points to. The descriptors hold 32-bit addresses, an
+ * unsigned long has the size of a pointer. */
+static inline void *vring_desc_buf(const volatile struct vring_desc *desc)
+{
+	return (void *)(unsigned long)(desc->addr & VRING_ADDR_MASK);
+}
 
 /* Tx Vring IRQ from Linux */
 #define TXVRING_IRQ					2
@@ -165,7 +207,7 @@ struct vring_used {
 #define NOTIFY_LINUX_IRQ			6
 
 /* vring data buffer max length including the header */
-#define PACKET_LEN_MAX				512
+#define PACKET_LEN_MAX				RPMSG_BUFFER_SIZE
 #define DATA_LEN_MAX				(PACKET_LEN_MAX - sizeof(struct rpmsg_hdr))
 
 #endif /* REMOTEPROC_KERNEL_H */
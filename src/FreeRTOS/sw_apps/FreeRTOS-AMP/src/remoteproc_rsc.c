@@ -0,0 +1,157 @@
+/* Copyright (C) 2012 Xilinx Inc. */
+
+/*
+ * This file contains the implementation of the Resource Table and MMU setup.
+ *
+ * - Resource Table describing the carveout, vrings, trace buffer, statistics
+ *   page, bulk channel and the peripherals used by the FreeRTOS firmware
+ * - MMU Setup and configuration for peripherals
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "FreeRTOS.h"
+#include "xil_printf.h"
+#include "xil_cache.h"
+#include "xil_cache_l.h"
+
+#include "remoteproc_kernel.h"
+#include "remoteproc.h"
+#include "binlog.h"
+#include "stats.h"
+#include "spsc.h"
+
+/* Linux host needs to know what resources are required by the FreeRTOS
+ * firmware.
+ *
+ * This table is accessed by the kernel during initialisation of the remoteproc
+ * driver in order to setup the system for AMP.
+ */
+struct resource_table {
+	unsigned int version;
+	unsigned int num;
+	unsigned int reserved[2];
+	unsigned int offset[NO_RESOURCE_ENTRIES];
+	/* text carveout entry */
+	struct fw_rsc_carveout text_cout;
+	/* rpmsg vdev entry */
+	struct fw_rsc_vdev rpmsg_vdev;
+	struct fw_rsc_vdev_vring rpmsg_vring0;
+	struct fw_rsc_vdev_vring rpmsg_vring1;
+	/* trace entry */
+	struct fw_rsc_trace trace;
+	/* statistics page entry */
+	struct fw_rsc_devmem stats;
+	/* bulk channel entry */
+	struct fw_rsc_devmem bulk;
+	struct fw_rsc_mmu slcr;
+	struct fw_rsc_mmu uart0;
+	struct fw_rsc_mmu scu;
+};
+
+struct resource_table __resource resources = {
+	1, /* we're the first version that implements this */
+	8, /* number of entries in the table */
+	{ 0, 0, }, /* reserved, must be zero */
+	/* offsets to entries */
+	{
+		offsetof(struct resource_table, text_cout),
+		offsetof(struct resource_table, rpmsg_vdev),
+		offsetof(struct resource_table, trace),
+		offsetof(struct resource_table, stats),
+		offsetof(struct resource_table, bulk),
+		offsetof(struct resource_table, slcr),
+		offsetof(struct resource_table, uart0),
+		offsetof(struct resource_table, scu),
+	},
+
+	/* End of ELF file */
+	{ TYPE_CARVEOUT, 0, 0, ELF_END, 0, 0, "TEXT/DATA", },
+
+	/* rpmsg vdev entry */
+	{ TYPE_VDEV, VIRTIO_ID_RPMSG, 0, RPMSG_IPU_C0_FEATURES, 0, 0, 0, 2,
+			{ 0, 0 }, /* no config data */ },
+
+	/* the two vrings */
+	{ RING_TX, RPMSG_VRING_ALIGN, VRING_SIZE, 1, 0 },
+	{ RING_RX, RPMSG_VRING_ALIGN, VRING_SIZE, 2, 0 },
+
+	/* Trace buffer */
+	{ TYPE_TRACE, TRACE_BUFFER_START, TRACE_BUFFER_SIZE, 0, "trace_buffer", },
+
+	/* Statistics page, identity mapped inside the carveout. Without an
+	 * IOMMU Linux has nothing to map for it, latencystat finds the page
+	 * through this entry. */
+	{ TYPE_DEVMEM, STATS_PAGE_START, STATS_PAGE_START, STATS_PAGE_SIZE, 0, 0,
+			STATS_RESOURCE_NAME, },
+
+	/* Bulk channel, found by latencystat the same way */
+	{ TYPE_DEVMEM, BULK_CHANNEL_START, BULK_CHANNEL_START,
+			sizeof(struct spsc_channel) + BULK_CHANNEL_DATA_SIZE, 0, 0,
+			SPSC_BULK_RESOURCE_NAME, },
+
+	/* Peripherals */
+	{ TYPE_MMU, 0, TTC_BASEADDR, 0, 0xc02, "ttc", },
+	{ TYPE_MMU, 1, STDOUT_BASEADDRESS, 0, 0xc02, "uart", },
+	{ TYPE_MMU, 2, XPS_SCU_PERIPH_BASE, 0, 0xc02, "scu", },
+};
+
+/* -------------------------------------------------------------------------- */
+/* Resource Setup Functions */
+
+void enable_tlb(unsigned int addr, unsigned int flags)
+{
+	extern char *MMUTable;
+	unsigned int link;
+
+	addr = addr & ~0xFFFFF; /* Address must be 1MB aligned */
+	link = (u32)&MMUTable + ((addr / 0x100000) * 4);
+	binlog("Setup TLB for address %x, TLBptr %x\n\r", addr, link);
+
+	*(u32 *)link = addr | flags;
+	Xil_L1DCacheFlush();
+}
+
+void disable_tlb(unsigned int addr)
+{
+	extern char *MMUTable;
+	unsigned int link;
+
+	addr = addr & ~0xFFFFF; /* Address must be 1MB aligned */
+	link = (u32)&MMUTable + ((addr / 0x100000) * 4);
+	binlog("Clear TLB for address %x, TLBptr %x\n\r", addr, link);
+
+	*(u32 *)link = addr | 0x000;
+	Xil_L1DCacheFlush();
+}
+
+void mmu_resource_table_setup(void)
+{
+	int i;
+
+	if (resources.version == 1) {
+		unsigned char *ptr = (unsigned char *)&resources;
+
+		for (i = 0; i < resources.num; i++) {
+			int offset = resources.offset[i];
+			unsigned int type = *(unsigned int *)(ptr + offset);
+			if (offset && (type == TYPE_MMU)) {
+				struct fw_rsc_mmu *mmu = (struct fw_rsc_mmu *)(ptr + offset);
+				binlog("Setup TLB for %d:%s\n", mmu->id, mmu->name);
+				enable_tlb(mmu->da, mmu->flags);
+			}
+		}
+	}
+
+	extern char *MMUTable;
+	binlog("Protect MMU Table at %x\n\r", (u32)&MMUTable);
+
+	/* This is the most important lines - disable access to MMU table
+	 * to avoid currupting Linux */
+	disable_tlb((u32)&MMUTable);
+	Xil_L1DCacheFlush();
+	/* Flush all TLBs */
+	__asm__ __volatile__("dsb; mov	%0,#0; \
+			mcr	p15, 0, r0, c8, c7, 0;" \
+				: "=r" (i));
+}
@@ -0,0 +1,341 @@
+/*
+ * Table-driven dispatch of request messages, see rpc.h.
+ *
+ * Every call is timed with the global timer, from the dispatch to the return
+ * of the handler, so the time a request waits in its lane is included.
+ * Sending the ACK and the response is not, it depends on Linux reading the
+ * messages.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "xil_printf.h"
+
+#include "remoteproc_kernel.h"
+#include "remoteproc.h"
+#include "timestamp.h"
+#include "rpc.h"
+#include "logging.h"
+
+static const struct rpc_command* rpc_commands[RPC_OPCODES_MAX];
+static struct rpc_stats rpc_stats;
+
+/* A queued request. The RX buffer goes back to Linux once rpc_dispatch()
+ * returns, so the header and the payload are copied. The payload of an
+ * upload stays in the reassembly buffer. */
+struct rpc_job {
+	struct rpmsg_hdr hdr;
+	struct remoteproc_request req;
+	unsigned long long start;
+	/* Opcode of the handler, the target of an upload */
+	unsigned int opcode;
+	/* Set for uploads, which are answered with a struct rpc_upload_result */
+	unsigned int upload;
+	rpc_upload_status upload_status;
+	unsigned int len;
+	unsigned char data[RPC_REQUEST_MAX];
+};
+
+/* Upload reassembly, the receiving state is only used by rpc_dispatch() */
+static unsigned char rpc_upload_buf[RPC_UPLOAD_MAX];
+static unsigned int rpc_upload_active = 0;
+static unsigned int rpc_upload_target;
+static unsigned int rpc_upload_total;
+static unsigned int rpc_upload_received;
+static unsigned int rpc_upload_seq;
+static unsigned long long rpc_upload_start;
+/* Set while a complete upload waits for or is in its handler */
+static volatile unsigned int rpc_upload_busy = 0;
+
+static xQueueHandle rpc_queues[RPC_LANES];
+
+/* Worker priorities of the lanes, control preempts bulk */
+static const unsigned portBASE_TYPE rpc_priorities[RPC_LANES] = {
+	tskIDLE_PRIORITY + 3,
+	tskIDLE_PRIORITY + 2,
+};
+static const char* const rpc_worker_names[RPC_LANES] = {
+	"RPC_CONTROL",
+	"RPC_BULK",
+};
+
+int rpc_register(const struct rpc_command* commands, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		if (commands[i].opcode >= RPC_OPCODES_MAX ||
+				rpc_commands[commands[i].opcode] != NULL) {
+			return -1;
+		}
+	}
+	for (i = 0; i < count; i++) {
+		rpc_commands[commands[i].opcode] = &commands[i];
+		rpc_stats.opcode[commands[i].opcode].min = 0xffffffff;
+	}
+	rpc_stats.timestamp_freq = TIMESTAMP_FREQ;
+	return 0;
+}
+
+static void rpc_account(struct rpc_opcode_stats* stats,
+		unsigned long long ticks)
+{
+	unsigned int time = ticks > 0xffffffff ? 0xffffffff : (unsigned int)ticks;
+	unsigned int bucket = 0;
+
+	while (bucket < RPC_HISTOGRAM_SIZE - 1 &&
+			(time >> (bucket + RPC_HISTOGRAM_SHIFT)) != 0) {
+		bucket++;
+	}
+
+	vPortEnterCritical();
+	stats->calls++;
+	stats->total += time;
+	if (time < stats->min) {
+		stats->min = time;
+	}
+	if (time > stats->max) {
+		stats->max = time;
+	}
+	stats->data[bucket]++;
+	vPortExitCritical();
+}
+
+/* ACK 'req' with the time it arrived and the time now */
+static void rpc_fill_ack(struct rpc_ack* ack, struct remoteproc_request* req,
+		rpc_status status)
+{
+	ack->state = req->state | REMOTEPROC_REQUEST_ACK_MASK;
+	ack->status = status;
+	ack->rx_time = req->kick_time;
+	if (ack->rx_time == REMOTEPROC_NO_KICK) {
+		/* Polled, it arrived no later than the RX task found it */
+		ack->rx_time = req->task_time;
+	}
+	ack->tx_time = timestamp_read();
+}
+
+/* Tell Linux a request will not be handled. Sent from the RX task, which
+ * must not wait for a TX buffer, so the NAK is lost if the TX ring is
+ * full. */
+static void rpc_nak(struct remoteproc_request* req, rpc_status status)
+{
+	struct rpc_ack ack;
+
+	rpc_fill_ack(&ack, req, status);
+	if (remoteproc_try_send(req->__hdr->dst, req->__hdr->src, &ack,
+			sizeof(ack)) < 0) {
+		log_warning(LOG_CAT_RPC, "rpc: NAK dropped, TX ring full\r\n");
+	}
+}
+
+static void rpc_queue(struct rpc_job* job, rpc_lane lane)
+{
+	/* Never wait here, the RX task serves all endpoints */
+	if (xQueueSend(rpc_queues[lane], job, 0) != pdTRUE) {
+		log_warning(LOG_CAT_RPC, "rpc: Request queue full\r\n");
+		/* A failed upload has been counted already */
+		if (!job->upload || job->upload_status == RPC_UPLOAD_OK) {
+			rpc_stats.rejected++;
+		}
+		if (job->upload && job->upload_status == RPC_UPLOAD_OK) {
+			rpc_upload_busy = 0;
+		}
+		rpc_nak(&job->req, RPC_BUSY);
+	}
+}
+
+static void rpc_init_job(struct rpc_job* job, struct remoteproc_request* req,
+		unsigned int opcode)
+{
+	job->start = timestamp_read();
+	job->hdr = *req->__hdr;
+	job->req = *req;
+	job->opcode = opcode;
+	job->upload = 0;
+	job->upload_status = RPC_UPLOAD_OK;
+	job->len = 0;
+}
+
+/* Answer an upload which ends now, completed or not */
+static void rpc_upload_done(struct remoteproc_request* req,
+		rpc_upload_status status)
+{
+	const struct rpc_command* command = rpc_commands[rpc_upload_target];
+	struct rpc_job job;
+
+	rpc_upload_active = 0;
+	rpc_init_job(&job, req, rpc_upload_target);
+	job.upload = 1;
+	job.upload_status = status;
+	job.len = rpc_upload_received;
+	if (status != RPC_UPLOAD_OK) {
+		rpc_stats.rejected++;
+		rpc_queue(&job, RPC_LANE_CONTROL);
+		return;
+	}
+
+	job.start = rpc_upload_start;
+	rpc_upload_busy = 1;
+	rpc_queue(&job, command->lane);
+}
+
+static void rpc_upload_chunk(struct remoteproc_request* req,
+		unsigned char* data, unsigned int len)
+{
+	const struct rpc_command* command;
+	struct rpc_upload_chunk chunk;
+
+	if (len < sizeof(chunk)) {
+		rpc_stats.rejected++;
+		rpc_nak(req, RPC_REJECTED);
+		return;
+	}
+	memcpy(&chunk, data, sizeof(chunk));
+	data += sizeof(chunk);
+	len -= sizeof(chunk);
+
+	if (chunk.seq == 0) {
+		rpc_upload_target = chunk.target & STATE_MASK;
+		rpc_upload_total = chunk.total;
+		rpc_upload_received = 0;
+		rpc_upload_seq = 0;
+		rpc_upload_start = timestamp_read();
+		rpc_upload_active = 1;
+
+		command = rpc_commands[rpc_upload_target];
+		if (rpc_upload_busy) {
+			rpc_upload_done(req, RPC_UPLOAD_BUSY);
+			return;
+		} else if (command == NULL || rpc_upload_target == UPLOAD) {
+			rpc_upload_done(req, RPC_UPLOAD_TARGET);
+			return;
+		} else if (chunk.total > RPC_UPLOAD_MAX ||
+				chunk.total < command->request_len) {
+			rpc_upload_done(req, RPC_UPLOAD_SIZE);
+			return;
+		}
+	} else if (!rpc_upload_active) {
+		/* The rest of an upload which has been answered already */
+		return;
+	}
+
+	if (chunk.seq != rpc_upload_seq ||
+			len > rpc_upload_total - rpc_upload_received) {
+		rpc_upload_done(req, RPC_UPLOAD_SEQUENCE);
+		return;
+	}
+	memcpy(rpc_upload_buf + rpc_upload_received, data, len);
+	rpc_upload_received += len;
+	rpc_upload_seq++;
+
+	if (rpc_upload_received == rpc_upload_total) {
+		rpc_upload_done(req, RPC_UPLOAD_OK);
+	}
+}
+
+void rpc_dispatch(struct remoteproc_request* req, unsigned char* data,
+		unsigned int len)
+{
+	unsigned int opcode = req->state & STATE_MASK;
+	const struct rpc_command* command = rpc_commands[opcode];
+	struct rpc_job job;
+
+	if (opcode == UPLOAD) {
+		rpc_upload_chunk(req, data, len);
+		return;
+	}
+
+	if (command == NULL || len < command->request_len ||
+			len > RPC_REQUEST_MAX) {
+		rpc_stats.rejected++;
+		log_warning(LOG_CAT_RPC, "rpc: Unimplemented request\r\n");
+		rpc_nak(req, RPC_REJECTED);
+		return;
+	}
+
+	rpc_init_job(&job, req, opcode);
+	job.len = len;
+	memcpy(job.data, data, len);
+	rpc_queue(&job, command->lane);
+}
+
+static void rpc_ack(struct rpc_job* job)
+{
+	struct rpc_ack ack;
+
+	rpc_fill_ack(&ack, &job->req, RPC_OK);
+	remoteproc_request_response(&job->req, (unsigned char*)&ack, sizeof(ack));
+}
+
+static void rpc_worker(void* param)
+{
+	xQueueHandle queue = param;
+	const struct rpc_command* command;
+	struct rpc_upload_result result;
+	struct rpc_job job;
+	void* response;
+
+	for (;;) {
+		if (xQueueReceive(queue, &job, portMAX_DELAY) != pdTRUE) {
+			continue;
+		}
+		job.req.__hdr = &job.hdr;
+		command = rpc_commands[job.opcode];
+		response = NULL;
+
+		if (job.upload_status == RPC_UPLOAD_OK) {
+			response = command->handler(job.upload ? rpc_upload_buf :
+					job.data, job.len);
+			rpc_account(&rpc_stats.opcode[job.opcode],
+					timestamp_read() - job.start);
+
+			/* The handler is done with the buffer, the next upload may use
+			 * it. Released before answering, Linux may start the next
+			 * upload as soon as it has the answer. */
+			if (job.upload) {
+				rpc_upload_busy = 0;
+			}
+		}
+
+		rpc_ack(&job);
+		if (job.upload) {
+			result.status = job.upload_status;
+			result.len = job.len;
+			remoteproc_request_response(&job.req, (unsigned char*)&result,
+					sizeof(result));
+		}
+		if (response != NULL && command->response_len != 0) {
+			remoteproc_request_response(&job.req, response,
+					command->response_len);
+		}
+	}
+}
+
+void rpc_init(void)
+{
+	unsigned int lane;
+
+	for (lane = 0; lane < RPC_LANES; lane++) {
+		rpc_queues[lane] = xQueueCreate(RPC_QUEUE_DEPTH,
+				sizeof(struct rpc_job));
+		if (rpc_queues[lane] == NULL) {
+			xil_printf("ERROR: Failed to create RPC queues!\r\n");
+			return;
+		}
+		/* The job is on the stack of the worker */
+		xTaskCreate(rpc_worker, (signed char*)rpc_worker_names[lane],
+				configMINIMAL_STACK_SIZE + sizeof(struct rpc_job) / 4,
+				rpc_queues[lane], rpc_priorities[lane], NULL);
+	}
+}
+
+void rpc_get_stats(struct rpc_stats* out)
+{
+	vPortEnterCritical();
+	*out = rpc_stats;
+	vPortExitCritical();
+}
@@ -0,0 +1,86 @@
+/*
+ * Table-driven dispatch of request messages (RPC) to opcode handlers.
+ *
+ * The opcode is the first word of a request, without the ACK bit. An
+ * application declares its commands in a table with the payload sizes of
+ * request and response and registers the table. rpc_dispatch() is then used
+ * as the endpoint handler, see remoteproc_register_endpoint().
+ *
+ * rpc_dispatch() only checks and queues a request, the handlers run in
+ * worker tasks. Each command belongs to a lane with its own queue and
+ * worker: control requests are short and served at a higher priority than
+ * bulk requests, so a large response in progress does not hold them up.
+ * Requests of one lane are served in order, requests of different lanes
+ * may overtake each other. A client which waits for the ACK of a request
+ * before sending the next one sees them in order. The ACK is a struct
+ * rpc_ack with the global timer times the request arrived and was answered.
+ * A request which is not handled, because it is malformed or its lane is
+ * full, gets a NAK instead: an ACK with a status other than RPC_OK.
+ *
+ * Requests larger than one message are sent as an upload (UPLOAD chunks,
+ * see latencydemo.h). rpc_dispatch() reassembles the chunks and queues the
+ * complete upload for the handler of its target command.
+ */
+
+#ifndef RPC_H
+#define RPC_H
+
+#include "remoteproc.h"
+#include "latencydemo.h"
+
+/*
+ * Handler of one opcode.
+ * @para:
+ *  data: payload of the request, at least 'request_len' bytes
+ *  len: length of the payload
+ * @return:
+ *  the response payload of 'response_len' bytes, or NULL for none
+ */
+typedef void* (rpc_handler)(unsigned char* data, unsigned int len);
+
+typedef enum {
+	/* Short requests, served first */
+	RPC_LANE_CONTROL,
+	/* Requests with large responses or long handlers */
+	RPC_LANE_BULK,
+	RPC_LANES,
+} rpc_lane;
+
+/* Requests waiting in each lane */
+#define RPC_QUEUE_DEPTH			8
+/* Largest request payload, it is copied into the queue. Larger requests
+ * are uploads. */
+#define RPC_REQUEST_MAX			64
+
+struct rpc_command {
+	unsigned int opcode;
+	const char* name;
+	/* Minimum payload size of the request, shorter requests are rejected */
+	unsigned int request_len;
+	/* Payload size of the response sent after the ACK, 0 for an ACK only */
+	unsigned int response_len;
+	rpc_handler* handler;
+	rpc_lane lane;
+};
+
+/* Declare a command from the types of its request and response payload */
+#define RPC_COMMAND(op, fn, request_type, response_len)					\
+	{ (op), #op, sizeof(request_type), (response_len), (fn), RPC_LANE_CONTROL }
+#define RPC_BULK_COMMAND(op, fn, request_type, response_len)				\
+	{ (op), #op, sizeof(request_type), (response_len), (fn), RPC_LANE_BULK }
+
+/* Create the lane queues and workers, before the scheduler is started */
+void rpc_init(void);
+
+/* Register 'count' commands. Returns 0, or -1 if an opcode is out of range
+ * or already registered. */
+int rpc_register(const struct rpc_command* commands, unsigned int count);
+
+/* Endpoint handler which queues a request for its opcode handler */
+void rpc_dispatch(struct remoteproc_request* req, unsigned char* data,
+		unsigned int len);
+
+/* Snapshot of the call counts and service times */
+void rpc_get_stats(struct rpc_stats* out);
+
+#endif /* RPC_H */
@@ -0,0 +1,140 @@
+/*
+ * Single-producer/single-consumer bulk channel, see spsc.h.
+ *
+ * Linux maps the channel uncached, so every range handed over is written
+ * back (or dropped before reading) with the range cache maintenance of
+ * cache.h. The indices are in cache lines of their own, maintaining one
+ * never touches the other side's index.
+ */
+
+#include <string.h>
+#include "FreeRTOS.h"
+
+#include "atomic.h"
+#include "cache.h"
+#include "spsc.h"
+
+void spsc_init(struct spsc_channel* ch, unsigned int size,
+		unsigned int doorbell)
+{
+	ch->magic = 0;
+	ch->size = size;
+	ch->doorbell = doorbell;
+	ch->head = 0;
+	ch->tail = 0;
+	cache_sync_to_linux(ch, sizeof(*ch));
+
+	/* Linux may only use the channel once the rest is visible */
+	smp_mb();
+	ch->magic = SPSC_MAGIC;
+	cache_sync_to_linux(&ch->magic, sizeof(ch->magic));
+}
+
+unsigned int spsc_count(struct spsc_channel* ch)
+{
+	cache_sync_from_linux(&ch->head, sizeof(ch->head));
+	cache_sync_from_linux(&ch->tail, sizeof(ch->tail));
+	return ch->head - ch->tail;
+}
+
+unsigned int spsc_space(struct spsc_channel* ch)
+{
+	return ch->size - spsc_count(ch);
+}
+
+/* Copy 'len' bytes from 'data' to the ring at byte counter 'pos' */
+static void spsc_copy_in(struct spsc_channel* ch, unsigned int pos,
+		const unsigned char* data, unsigned int len)
+{
+	unsigned int offset = pos & (ch->size - 1);
+	unsigned int first = ch->size - offset;
+
+	if (first > len) {
+		first = len;
+	}
+	memcpy(&ch->data[offset], data, first);
+	cache_sync_to_linux(&ch->data[offset], first);
+	if (len > first) {
+		memcpy(&ch->data[0], data + first, len - first);
+		cache_sync_to_linux(&ch->data[0], len - first);
+	}
+}
+
+/* Copy 'len' bytes from the ring at byte counter 'pos' to 'data' */
+static void spsc_copy_out(struct spsc_channel* ch, unsigned int pos,
+		unsigned char* data, unsigned int len)
+{
+	unsigned int offset = pos & (ch->size - 1);
+	unsigned int first = ch->size - offset;
+
+	if (first > len) {
+		first = len;
+	}
+	cache_sync_from_linux(&ch->data[offset], first);
+	memcpy(data, &ch->data[offset], first);
+	if (len > first) {
+		cache_sync_from_linux(&ch->data[0], len - first);
+		memcpy(data + first, &ch->data[0], len - first);
+	}
+}
+
+unsigned int spsc_write(struct spsc_channel* ch, const void* data,
+		unsigned int len)
+{
+	unsigned int head = ch->head;
+	unsigned int tail;
+	unsigned int space;
+
+	/* The consumer's tail, it only ever grows */
+	cache_sync_from_linux(&ch->tail, sizeof(ch->tail));
+	tail = ch->tail;
+	smp_mb();
+
+	space = ch->size - (head - tail);
+	if (len > space) {
+		len = space;
+	}
+	if (len == 0) {
+		return 0;
+	}
+
+	spsc_copy_in(ch, head, data, len);
+
+	/* The data must be complete before the consumer sees the new head */
+	smp_mb();
+	ch->head = head + len;
+	cache_sync_to_linux(&ch->head, sizeof(ch->head));
+
+	/* Only ring when the consumer may have gone to sleep on an empty
+	 * channel, not for every write */
+	if (ch->doorbell != SPSC_NO_DOORBELL && head == tail) {
+		swirq_to_linux(ch->doorbell, 0);
+	}
+	return len;
+}
+
+unsigned int spsc_read(struct spsc_channel* ch, void* data, unsigned int len)
+{
+	unsigned int tail = ch->tail;
+	unsigned int head;
+
+	cache_sync_from_linux(&ch->head, sizeof(ch->head));
+	head = ch->head;
+	/* Read the data only after the head that covers it */
+	smp_mb();
+
+	if (len > head - tail) {
+		len = head - tail;
+	}
+	if (len == 0) {
+		return 0;
+	}
+
+	spsc_copy_out(ch, tail, data, len);
+
+	/* The data must be read before the producer may overwrite it */
+	smp_mb();
+	ch->tail = tail + len;
+	cache_sync_to_linux(&ch->tail, sizeof(ch->tail));
+	return len;
+}
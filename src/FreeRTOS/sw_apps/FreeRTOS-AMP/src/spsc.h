@@ -0,0 +1,35 @@
+/*
+ * Single-producer/single-consumer bulk channel to Linux, see spsc_channel.h
+ * for the layout. It moves data without rpmsg framing, Linux maps the
+ * channel directly.
+ *
+ * Either side may be the producer. On the FreeRTOS side only one task (or
+ * interrupt handler) may write to a channel and only one may read from it.
+ */
+
+#ifndef SPSC_H
+#define SPSC_H
+
+#include "spsc_channel.h"
+#include "remoteproc_kernel.h"
+
+/* The bulk channel in the carveout, see lscript.ld */
+#define BULK_CHANNEL			((struct spsc_channel *)BULK_CHANNEL_START)
+
+/* Set up an empty channel with 'size' bytes of data (a power of two).
+ * 'doorbell' is the SGI raised towards Linux, or SPSC_NO_DOORBELL. */
+void spsc_init(struct spsc_channel* ch, unsigned int size,
+		unsigned int doorbell);
+
+/* Copy up to 'len' bytes into the channel, returns the number written */
+unsigned int spsc_write(struct spsc_channel* ch, const void* data,
+		unsigned int len);
+
+/* Copy up to 'len' bytes out of the channel, returns the number read */
+unsigned int spsc_read(struct spsc_channel* ch, void* data, unsigned int len);
+
+/* Bytes that can be read, and bytes that can be written */
+unsigned int spsc_count(struct spsc_channel* ch);
+unsigned int spsc_space(struct spsc_channel* ch);
+
+#endif /* SPSC_H */
@@ -0,0 +1,193 @@
+/*
+ * Statistics page, see stats.h.
+ *
+ * Linux maps the page uncached, so each step of an update is written back
+ * on its own before the next one: 'begin' has to reach memory before the
+ * values do, and the values before 'end'. The statistics task publishes all
+ * registered counters which changed in one such update. The counters are
+ * added to with LDREXD/STREXD, so a task interrupted in the middle of an
+ * update neither loses its own nor the handler's increment.
+ */
+
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "atomic.h"
+#include "cache.h"
+#include "stats.h"
+
+#if STATS_ENABLE
+
+/* A counter of another module and the part of it already on the page */
+struct stats_counter
+{
+	const volatile unsigned int* value;
+	unsigned int published;
+	struct stats_entry* entry;
+};
+
+static struct stats_counter stats_counters[STATS_COUNTERS_MAX];
+/* Counters in use, only the statistics task reads them */
+static volatile unsigned int stats_counter_count = 0;
+static struct stats_entry* stat_published;
+
+static inline void stats_begin(struct stats_page* page)
+{
+	atomic_add_return(&page->begin, 1);
+	cache_sync_to_linux(page, STATS_CACHE_LINE);
+}
+
+/* The values updated have been written back already */
+static inline void stats_end(struct stats_page* page)
+{
+	atomic_add_return(&page->end, 1);
+	cache_sync_to_linux(page, STATS_CACHE_LINE);
+}
+
+/* Add what the counters have counted since the last round to the page,
+ * in one update */
+static void stats_publish(void)
+{
+	struct stats_page* page = STATS_PAGE;
+	struct stats_counter* counter;
+	unsigned int count = stats_counter_count;
+	unsigned int started = 0;
+	unsigned int value;
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		counter = &stats_counters[i];
+		value = *counter->value;
+		if (value == counter->published) {
+			continue;
+		}
+		if (!started) {
+			stats_begin(page);
+			started = 1;
+		}
+		atomic64_add(&counter->entry->value, value - counter->published);
+		cache_sync_to_linux(counter->entry, sizeof(*counter->entry));
+		counter->published = value;
+	}
+	if (started) {
+		stats_end(page);
+	}
+}
+
+static void stats_task(void* pvParameters)
+{
+	portTickType next = xTaskGetTickCount();
+
+	for (;;) {
+		vTaskDelayUntil(&next, STATS_PUBLISH_MS / portTICK_RATE_MS);
+		stats_publish();
+		stats_add(stat_published, 1);
+	}
+}
+
+void stats_init(void)
+{
+	struct stats_page* page = STATS_PAGE;
+
+	memset(page, 0, sizeof(*page));
+	page->size = sizeof(*page);
+	cache_sync_to_linux(page, sizeof(*page));
+
+	/* Linux may only read the page once the rest is visible */
+	smp_mb();
+	page->magic = STATS_MAGIC;
+	cache_sync_to_linux(&page->magic, sizeof(page->magic));
+
+	stat_published = stats_register(STATS_PUBLISHED_NAME, STATS_COUNTER);
+	xTaskCreate(stats_task, (signed char *)"STATS", configMINIMAL_STACK_SIZE,
+			NULL, STATS_TASK_PRIORITY, NULL);
+}
+
+struct stats_entry* stats_register(const char* name, stats_kind kind)
+{
+	struct stats_page* page = STATS_PAGE;
+	struct stats_entry* entry = NULL;
+
+	portENTER_CRITICAL();
+	if (page->count < STATS_ENTRIES_MAX) {
+		entry = &page->entries[page->count];
+		strncpy(entry->name, name, STATS_NAME_MAX - 1);
+		entry->name[STATS_NAME_MAX - 1] = '\0';
+		entry->kind = kind;
+		entry->value = 0;
+		cache_sync_to_linux(entry, sizeof(*entry));
+
+		/* Count the entry once it is complete */
+		smp_mb();
+		page->count++;
+		cache_sync_to_linux(page, STATS_CACHE_LINE);
+	}
+	portEXIT_CRITICAL();
+	return entry;
+}
+
+struct stats_entry* stats_register_counter(const char* name,
+		const volatile unsigned int* value)
+{
+	struct stats_counter* counter;
+	struct stats_entry* entry;
+
+	if (stats_counter_count >= STATS_COUNTERS_MAX) {
+		return NULL;
+	}
+	entry = stats_register(name, STATS_COUNTER);
+	if (entry == NULL) {
+		return NULL;
+	}
+
+	/* The entry starts at 0, the task publishes all the counter has
+	 * counted so far in its next round */
+	portENTER_CRITICAL();
+	if (stats_counter_count >= STATS_COUNTERS_MAX) {
+		/* Another task took the last one meanwhile */
+		portEXIT_CRITICAL();
+		return NULL;
+	}
+	counter = &stats_counters[stats_counter_count];
+	counter->value = value;
+	counter->published = 0;
+	counter->entry = entry;
+
+	/* The task may only see the counter once it is complete */
+	smp_mb();
+	stats_counter_count++;
+	portEXIT_CRITICAL();
+	return entry;
+}
+
+void stats_add(struct stats_entry* entry, unsigned long long n)
+{
+	struct stats_page* page = STATS_PAGE;
+
+	if (entry == NULL) {
+		return;
+	}
+	stats_begin(page);
+	atomic64_add(&entry->value, n);
+	cache_sync_to_linux(entry, sizeof(*entry));
+	stats_end(page);
+}
+
+/* A gauge is meant to be set from one place, concurrent stores of the same
+ * gauge may tear the value */
+void stats_set(struct stats_entry* entry, unsigned long long value)
+{
+	struct stats_page* page = STATS_PAGE;
+
+	/* Spare Linux a retry when nothing changes */
+	if (entry == NULL || entry->value == value) {
+		return;
+	}
+	stats_begin(page);
+	entry->value = value;
+	cache_sync_to_linux(entry, sizeof(*entry));
+	stats_end(page);
+}
+
+#endif /* STATS_ENABLE */
@@ -0,0 +1,101 @@
+/*
+ * Statistics page, named counters and gauges Linux reads straight from
+ * shared memory (see stats_page.h for the layout and the protocol).
+ *
+ *   static unsigned int kicks;
+ *
+ *   stats_register_counter("rx_kicks", &kicks);
+ *   ...
+ *   kicks++;
+ *
+ * A counter on a hot path is a plain variable of its module, the statistics
+ * task adds its increase to the page every STATS_PUBLISH_MS. Counting costs
+ * an increment, not the cache maintenance of an update of the page. Rare
+ * events may update an entry directly with stats_add() or stats_set(), from
+ * tasks and from interrupt handlers. An update of an entry which is NULL,
+ * because stats_register() failed or has not run yet, does nothing.
+ *
+ * 'latencystat --counters' prints them without disturbing FreeRTOS.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+#include "stats_page.h"
+#include "remoteproc_kernel.h"
+
+/* Set to 0 to leave the statistics page out */
+#define STATS_ENABLE			1
+
+/* The page in the carveout, see lscript.ld */
+#define STATS_PAGE				((struct stats_page *)STATS_PAGE_START)
+
+/* Period and priority of the task publishing the counters */
+#define STATS_PUBLISH_MS		100
+#define STATS_TASK_PRIORITY		(tskIDLE_PRIORITY + 1)
+
+/* Counters registered with stats_register_counter() */
+#define STATS_COUNTERS_MAX		16
+
+/* Counter the statistics task increments after each round, everything
+ * counted before two rounds have passed is on the page */
+#define STATS_PUBLISHED_NAME	"stats_published"
+
+#if STATS_ENABLE
+
+/* Set up the page and create the statistics task, first thing in main() */
+void stats_init(void);
+
+/* Add an entry named 'name' with the value 0. Returns the entry, or NULL if
+ * the page is full. Must not be called from interrupt handlers. */
+struct stats_entry* stats_register(const char* name, stats_kind kind);
+
+/* Add a counter named 'name' which follows '*value', a counter the caller
+ * increments. Wrapping is fine as long as it does not wrap between two
+ * rounds. Returns the entry, or NULL if the page or the list of counters is
+ * full. Must not be called from interrupt handlers. */
+struct stats_entry* stats_register_counter(const char* name,
+		const volatile unsigned int* value);
+
+/* Add 'n' to a counter */
+void stats_add(struct stats_entry* entry, unsigned long long n);
+
+/* Set a gauge to 'value' */
+void stats_set(struct stats_entry* entry, unsigned long long value);
+
+#else /* !STATS_ENABLE */
+
+static inline void stats_init(void)
+{
+}
+
+static inline struct stats_entry* stats_register(const char* name,
+		stats_kind kind)
+{
+	return NULL;
+}
+
+static inline struct stats_entry* stats_register_counter(const char* name,
+		const volatile unsigned int* value)
+{
+	return NULL;
+}
+
+static inline void stats_add(struct stats_entry* entry, unsigned long long n)
+{
+}
+
+static inline void stats_set(struct stats_entry* entry,
+		unsigned long long value)
+{
+}
+
+#endif /* STATS_ENABLE */
+
+static inline void stats_inc(struct stats_entry* entry)
+{
+	stats_add(entry, 1);
+}
+
+#endif /* STATS_H */
@@ -0,0 +1,73 @@
+/*
+ * Timestamps from the Cortex-A9 64-bit global timer.
+ *
+ * The global timer is shared by both cores and runs at half the CPU clock. It
+ * is mapped through the "scu" entry of the resource table.
+ *
+ * When not compiling for ARM a host monotonic clock in nanoseconds is used,
+ * which allows building the transport on a host.
+ */
+
+#ifndef TIMESTAMP_H
+#define TIMESTAMP_H
+
+#ifdef __arm__
+
+#include "xparameters.h"
+
+/* Global timer registers */
+#define GLOBAL_TIMER_COUNTER_LOW	(XPS_GLOBAL_TMR_BASEADDR + 0x0)
+#define GLOBAL_TIMER_COUNTER_HIGH	(XPS_GLOBAL_TMR_BASEADDR + 0x4)
+#define GLOBAL_TIMER_CONTROL		(XPS_GLOBAL_TMR_BASEADDR + 0x8)
+#define GLOBAL_TIMER_ENABLE			0x1
+
+/* Timestamp ticks per second */
+#define TIMESTAMP_FREQ		(XPAR_CPU_CORTEXA9_0_CPU_CLK_FREQ_HZ / 2)
+
+/* Start the global timer, unless Linux has already done so */
+static inline void timestamp_init(void)
+{
+	volatile unsigned int *control = (void *)GLOBAL_TIMER_CONTROL;
+
+	if (!(*control & GLOBAL_TIMER_ENABLE)) {
+		*control |= GLOBAL_TIMER_ENABLE;
+	}
+}
+
+/* Read the 64-bit counter, re-reading if the upper word changed meanwhile */
+static inline unsigned long long timestamp_read(void)
+{
+	volatile unsigned int *low = (void *)GLOBAL_TIMER_COUNTER_LOW;
+	volatile unsigned int *high = (void *)GLOBAL_TIMER_COUNTER_HIGH;
+	unsigned int hi;
+	unsigned int lo;
+
+	do {
+		hi = *high;
+		lo = *low;
+	} while (hi != *high);
+
+	return ((unsigned long long)hi << 32) | lo;
+}
+
+#else /* !__arm__ */
+
+#include <time.h>
+
+#define TIMESTAMP_FREQ		1000000000ULL
+
+static inline void timestamp_init(void)
+{
+}
+
+static inline unsigned long long timestamp_read(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#endif /* __arm__ */
+
+#endif /* TIMESTAMP_H */
@@ -0,0 +1,514 @@
+/*
+ * Transport benchmark, the client of the FreeRTOS benchmark service (see
+ * bench.c in the FreeRTOS application).
+ *
+ * - Echo: round trips over message sizes and in-flight depths, with the
+ *   time spent in each stage on the FreeRTOS side. Once more with FreeRTOS
+ *   polling the RX vring instead of waiting for the kick interrupt.
+ * - Sink and source: throughput of each direction alone.
+ * - Bulk: throughput of the bulk channel next to rpmsg (spsc_channel.h).
+ * - Mailbox: round trips of the control mailbox (mailbox_slot.h), to
+ *   compare with the echo of the smallest message.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "latencydemo.h"
+#include "latencyrpmsg.h"
+#include "latencybench.h"
+#include "latencyspsc.h"
+#include "latencymailbox.h"
+
+/* Largest message, the payload of a 512 byte rpmsg buffer */
+#define BENCH_MSG_MAX		496
+/* Most messages in flight */
+#define BENCH_DEPTH_MAX		32
+/* Bytes read from the bulk channel at once */
+#define BENCH_BULK_READ		(64 * 1024)
+/* Give up when the bulk channel stays empty this long */
+#define BENCH_BULK_TIMEOUT_NS	2000000000ULL
+/* Round trip histogram buckets, bucket i > 0 counts [2^i, 2^(i+1)) us,
+ * bucket 0 everything below 2 us */
+#define BENCH_BUCKETS		20
+
+static const unsigned int bench_sizes[] = { sizeof(struct bench_msg), 64, 128,
+		256, BENCH_MSG_MAX };
+static const unsigned int bench_depths[] = { 1, 8, BENCH_DEPTH_MAX };
+
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+
+/* Frequency of the FreeRTOS timestamps */
+static unsigned int timestamp_freq = 1;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Convert a difference of FreeRTOS timestamps to nanoseconds */
+static double ticks_to_ns(unsigned long long ticks)
+{
+	return (double)ticks * 1e9 / timestamp_freq;
+}
+
+static int bench_write(struct rpmsg_target* target, void* buf, size_t len)
+{
+	if (write(target->fd, buf, len) != (ssize_t)len) {
+		perror(__FUNCTION__);
+		return -1;
+	}
+	return 0;
+}
+
+static int bench_get_stats(struct rpmsg_target* target,
+		struct bench_stats* stats)
+{
+	struct bench_msg msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.cmd = BENCH_STATS;
+	if (bench_write(target, &msg, sizeof(msg)) < 0) {
+		return -1;
+	}
+	if (rpmsg_read_response(target, (char *)stats, sizeof(*stats)) < 0) {
+		return -1;
+	}
+	return 0;
+}
+
+/* Set the poll budget of the FreeRTOS RX vring */
+static int bench_set_poll(struct rpmsg_target* target, unsigned int us)
+{
+	struct bench_msg msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.cmd = BENCH_POLL;
+	msg.count = us;
+	return bench_write(target, &msg, sizeof(msg));
+}
+
+static int compare_ull(const void* a, const void* b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* -------------------------------------------------------------------------- */
+
+struct bench_echo_result {
+	double msgs_per_sec;
+	/* round trip times in ns, sorted */
+	unsigned long long* rtt;
+	/* average time of each stage in ns, the first one of the messages
+	 * which were not polled */
+	double kick_to_task;
+	double task_to_handler;
+	double handler_to_send;
+	unsigned int hist[BENCH_BUCKETS];
+};
+
+static int bench_echo(struct rpmsg_target* target, unsigned int size,
+		unsigned int depth, unsigned int count,
+		struct bench_echo_result* result)
+{
+	unsigned long long sent_at[BENCH_DEPTH_MAX];
+	unsigned char buf[BENCH_MSG_MAX];
+	struct bench_msg* msg = (struct bench_msg *)buf;
+	unsigned long long start;
+	unsigned long long rtt;
+	unsigned int sent = 0;
+	unsigned int received = 0;
+	unsigned int kicked = 0;
+	unsigned int bucket;
+
+	memset(buf, 0xa5, sizeof(buf));
+	memset(result->hist, 0, sizeof(result->hist));
+	result->kick_to_task = 0;
+	result->task_to_handler = 0;
+	result->handler_to_send = 0;
+
+	start = now_ns();
+	while (received < count) {
+		/* Keep 'depth' messages in flight */
+		while (sent < count && sent - received < depth) {
+			memset(msg, 0, sizeof(*msg));
+			msg->cmd = BENCH_ECHO;
+			msg->seq = sent;
+			sent_at[sent % BENCH_DEPTH_MAX] = now_ns();
+			if (bench_write(target, buf, size) < 0) {
+				return -1;
+			}
+			sent++;
+		}
+
+		if (rpmsg_read_response(target, (char *)buf, size) < 0) {
+			return -1;
+		}
+		rtt = now_ns() - sent_at[msg->seq % BENCH_DEPTH_MAX];
+		if (msg->cmd != BENCH_ECHO || msg->seq != received) {
+			fprintf(stderr, "bench: unexpected response %u (expected %u)\n",
+					msg->seq, received);
+			return -1;
+		}
+		result->rtt[received] = rtt;
+		if (msg->t_kick != 0) {
+			result->kick_to_task += ticks_to_ns(msg->t_task - msg->t_kick);
+			kicked++;
+		}
+		result->task_to_handler += ticks_to_ns(msg->t_handler - msg->t_task);
+		result->handler_to_send += ticks_to_ns(msg->t_send - msg->t_handler);
+
+		for (bucket = 0; bucket < BENCH_BUCKETS - 1 &&
+				rtt >= (2000ULL << bucket); bucket++)
+			;
+		result->hist[bucket]++;
+		received++;
+	}
+
+	result->msgs_per_sec = count * 1e9 / (now_ns() - start);
+	if (kicked != 0) {
+		result->kick_to_task /= kicked;
+	}
+	result->task_to_handler /= count;
+	result->handler_to_send /= count;
+	qsort(result->rtt, count, sizeof(result->rtt[0]), compare_ull);
+	return 0;
+}
+
+static void print_histogram(unsigned int size, unsigned int* hist)
+{
+	unsigned int i;
+
+	printf("\t%u bytes, depth 1:\n", size);
+	for (i = 0; i < BENCH_BUCKETS; i++) {
+		if (hist[i] != 0) {
+			printf("\t\t%6u - %6u us: %u\n", i ? 1U << i : 0, 2U << i,
+					hist[i]);
+		}
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+
+static int bench_sink(struct rpmsg_target* target, unsigned int size,
+		unsigned int count)
+{
+	unsigned char buf[BENCH_MSG_MAX];
+	struct bench_msg* msg = (struct bench_msg *)buf;
+	struct bench_stats before;
+	struct bench_stats after;
+	unsigned long long start;
+	unsigned long long elapsed;
+	unsigned int i;
+
+	if (bench_get_stats(target, &before) < 0) {
+		return -1;
+	}
+
+	memset(buf, 0, sizeof(buf));
+	msg->cmd = BENCH_SINK;
+	start = now_ns();
+	for (i = 0; i < count; i++) {
+		msg->seq = i;
+		if (bench_write(target, buf, size) < 0) {
+			return -1;
+		}
+	}
+	/* Messages are handled in order, once the statistics come back all of
+	 * them have been received */
+	if (bench_get_stats(target, &after) < 0) {
+		return -1;
+	}
+	elapsed = now_ns() - start;
+
+	printf("\tsink   %5u %10.0f %10.2f", size, count * 1e9 / elapsed,
+			(double)count * size * 1e3 / elapsed);
+	/* The statistics request itself is counted as well */
+	if (after.rx_messages - before.rx_messages != count + 1) {
+		printf("   (%u messages lost)",
+				count + 1 - (after.rx_messages - before.rx_messages));
+	}
+	printf("\n");
+	return 0;
+}
+
+static int bench_source(struct rpmsg_target* target, unsigned int size,
+		unsigned int count)
+{
+	char* data = malloc((size_t)size * count);
+	struct bench_msg msg;
+	unsigned long long start;
+	unsigned long long elapsed;
+
+	if (data == NULL) {
+		return -1;
+	}
+
+	memset(&msg, 0, sizeof(msg));
+	msg.cmd = BENCH_SOURCE;
+	msg.count = count;
+	msg.len = size;
+	start = now_ns();
+	if (bench_write(target, &msg, sizeof(msg)) < 0 ||
+			rpmsg_read_response(target, data, (size_t)size * count) < 0) {
+		free(data);
+		return -1;
+	}
+	elapsed = now_ns() - start;
+	free(data);
+
+	printf("\tsource %5u %10.0f %10.2f\n", size, count * 1e9 / elapsed,
+			(double)count * size * 1e3 / elapsed);
+	return 0;
+}
+
+static int bench_bulk(struct rpmsg_target* target, unsigned int bytes)
+{
+	static unsigned char buf[BENCH_BULK_READ];
+	struct spsc_target channel;
+	struct bench_msg msg;
+	unsigned long long start;
+	unsigned long long progress;
+	unsigned long long elapsed;
+	unsigned int received = 0;
+	size_t len;
+	size_t i;
+	int ret = -1;
+
+	if (spsc_open(&channel, SPSC_BULK_RESOURCE_NAME) < 0) {
+		printf("\tbulk channel not available, skipped\n");
+		return 0;
+	}
+	spsc_discard(&channel);
+
+	memset(&msg, 0, sizeof(msg));
+	msg.cmd = BENCH_BULK;
+	msg.count = bytes;
+	start = now_ns();
+	progress = start;
+	if (bench_write(target, &msg, sizeof(msg)) < 0) {
+		goto out;
+	}
+	while (received < bytes) {
+		len = bytes - received;
+		if (len > sizeof(buf)) {
+			len = sizeof(buf);
+		}
+		len = spsc_read(&channel, buf, len);
+		if (len == 0) {
+			if (now_ns() - progress > BENCH_BULK_TIMEOUT_NS) {
+				fprintf(stderr, "bench: bulk channel stalled after %u bytes\n",
+						received);
+				goto out;
+			}
+			continue;
+		}
+		for (i = 0; i < len; i++) {
+			if (buf[i] != (unsigned char)(received + i)) {
+				fprintf(stderr, "bench: bulk data corrupted at byte %zu\n",
+						received + i);
+				goto out;
+			}
+		}
+		received += len;
+		progress = now_ns();
+	}
+	elapsed = now_ns() - start;
+
+	printf("\tbulk   %5s %10s %10.2f\n", "-", "-", bytes * 1e3 / elapsed);
+	ret = 0;
+
+out:
+	spsc_close(&channel);
+	return ret;
+}
+
+/* 'rtt' has room for 'count' round trips */
+static int bench_mailbox(unsigned int count, unsigned long long* rtt)
+{
+	struct mailbox_target mailbox;
+	unsigned long long start;
+	unsigned long long sum = 0;
+	unsigned int i;
+	int ret = -1;
+
+	if (mailbox_open(&mailbox) < 0) {
+		printf("\tcontrol mailbox not available, skipped\n");
+		return 0;
+	}
+
+	for (i = 0; i < count; i++) {
+		start = now_ns();
+		if (mailbox_call(&mailbox, MAILBOX_PING, 0) != MAILBOX_OK) {
+			goto out;
+		}
+		rtt[i] = now_ns() - start;
+		sum += rtt[i];
+	}
+	qsort(rtt, count, sizeof(rtt[0]), compare_ull);
+
+	printf("\t%8.1f %8.1f %8.1f %8.1f %8.1f\n", rtt[0] / 1e3,
+			sum / 1e3 / count, rtt[count / 2] / 1e3,
+			rtt[(unsigned long long)count * 99 / 100] / 1e3,
+			rtt[count - 1] / 1e3);
+	ret = 0;
+
+out:
+	mailbox_close(&mailbox);
+	return ret;
+}
+
+/* -------------------------------------------------------------------------- */
+
+int run_bench(char* dev, unsigned int count)
+{
+	struct rpmsg_target target;
+	struct bench_echo_result result;
+	struct bench_stats stats;
+	unsigned int hist[ARRAY_SIZE(bench_sizes)][BENCH_BUCKETS];
+	unsigned int i;
+	unsigned int j;
+	int ret = -1;
+
+	if (count == 0) {
+		return -1;
+	}
+	result.rtt = malloc(count * sizeof(result.rtt[0]));
+	if (result.rtt == NULL) {
+		return -1;
+	}
+	if (rpmsg_open_device(&target, dev) < 0) {
+		free(result.rtt);
+		return -1;
+	}
+
+	printf("Linux FreeRTOS AMP Transport Benchmark.\n");
+	if (bench_get_stats(&target, &stats) < 0) {
+		goto out;
+	}
+	timestamp_freq = stats.timestamp_freq;
+
+	printf("-----------------------------------------------------------\n");
+	printf("Echo (%u messages each, times in us):\n", count);
+	printf("\t%5s %5s %10s %8s %8s %8s %8s %8s | %8s %8s %8s\n",
+			"size", "depth", "msgs/s", "min", "avg", "p50", "p99", "max",
+			"irq>task", "task>hdl", "hdl>send");
+	for (i = 0; i < ARRAY_SIZE(bench_sizes); i++) {
+		for (j = 0; j < ARRAY_SIZE(bench_depths); j++) {
+			unsigned long long sum = 0;
+			unsigned int k;
+
+			if (bench_echo(&target, bench_sizes[i], bench_depths[j], count,
+					&result) < 0) {
+				goto out;
+			}
+			for (k = 0; k < count; k++) {
+				sum += result.rtt[k];
+			}
+			printf("\t%5u %5u %10.0f %8.1f %8.1f %8.1f %8.1f %8.1f | "
+					"%8.2f %8.2f %8.2f\n",
+					bench_sizes[i], bench_depths[j], result.msgs_per_sec,
+					result.rtt[0] / 1e3, sum / 1e3 / count,
+					result.rtt[count / 2] / 1e3,
+					result.rtt[(unsigned long long)count * 99 / 100] / 1e3,
+					result.rtt[count - 1] / 1e3,
+					result.kick_to_task / 1e3, result.task_to_handler / 1e3,
+					result.handler_to_send / 1e3);
+			if (bench_depths[j] == 1) {
+				memcpy(hist[i], result.hist, sizeof(hist[i]));
+			}
+		}
+	}
+
+	printf("-----------------------------------------------------------\n");
+	printf("Echo Round Trip Histograms:\n");
+	for (i = 0; i < ARRAY_SIZE(bench_sizes); i++) {
+		print_histogram(bench_sizes[i], hist[i]);
+	}
+
+	printf("-----------------------------------------------------------\n");
+	printf("Echo with FreeRTOS polling for %u us (depth 1, times in us):\n",
+			BENCH_POLL_US);
+	printf("\t%5s %10s %8s %8s %8s %8s | %8s %8s\n", "size", "msgs/s", "min",
+			"avg", "p99", "max", "polled", "woken");
+	if (bench_set_poll(&target, BENCH_POLL_US) < 0) {
+		goto out;
+	}
+	for (i = 0; i < ARRAY_SIZE(bench_sizes); i++) {
+		struct bench_stats before;
+		unsigned long long sum = 0;
+		unsigned int k;
+
+		if (bench_get_stats(&target, &before) < 0 ||
+				bench_echo(&target, bench_sizes[i], 1, count, &result) < 0 ||
+				bench_get_stats(&target, &stats) < 0) {
+			bench_set_poll(&target, 0);
+			goto out;
+		}
+		for (k = 0; k < count; k++) {
+			sum += result.rtt[k];
+		}
+		printf("\t%5u %10.0f %8.1f %8.1f %8.1f %8.1f | %8u %8u\n",
+				bench_sizes[i], result.msgs_per_sec, result.rtt[0] / 1e3,
+				sum / 1e3 / count,
+				result.rtt[(unsigned long long)count * 99 / 100] / 1e3,
+				result.rtt[count - 1] / 1e3,
+				stats.rx_polled - before.rx_polled,
+				stats.rx_woken - before.rx_woken);
+	}
+	if (bench_set_poll(&target, 0) < 0) {
+		goto out;
+	}
+
+	printf("-----------------------------------------------------------\n");
+	printf("Throughput (%u messages each):\n", count);
+	printf("\t%-6s %5s %10s %10s\n", "", "size", "msgs/s", "MB/s");
+	for (i = 0; i < ARRAY_SIZE(bench_sizes); i++) {
+		if (bench_sink(&target, bench_sizes[i], count) < 0 ||
+				bench_source(&target, bench_sizes[i], count) < 0) {
+			goto out;
+		}
+	}
+	/* The same amount of data as the largest messages above */
+	if (bench_bulk(&target, count * BENCH_MSG_MAX) < 0) {
+		goto out;
+	}
+
+	printf("-----------------------------------------------------------\n");
+	printf("Control Mailbox Round Trip (%u commands, times in us):\n", count);
+	printf("\t%8s %8s %8s %8s %8s\n", "min", "avg", "p50", "p99", "max");
+	if (bench_mailbox(count, result.rtt) < 0) {
+		goto out;
+	}
+
+	printf("-----------------------------------------------------------\n");
+	printf("FreeRTOS Transport Statistics:\n");
+	if (bench_get_stats(&target, &stats) < 0) {
+		goto out;
+	}
+	printf("\tmessages sent: %u\n", stats.tx_messages);
+	printf("\tsends with TX ring full: %u\n", stats.tx_full);
+	printf("\techo responses dropped: %u\n", stats.echo_dropped);
+	printf("\tmessages found by polling: %u\n", stats.rx_polled);
+	printf("\tRX task woken by a kick: %u\n", stats.rx_woken);
+	if (stats.tx_messages) {
+		printf("\tavg send time: %.2f us\n",
+				ticks_to_ns(stats.tx_time) / 1e3 / stats.tx_messages);
+	}
+	printf("-----------------------------------------------------------\n");
+	ret = 0;
+
+out:
+	rpmsg_close_device(&target);
+	free(result.rtt);
+	return ret;
+}
@@ -0,0 +1,14 @@
+#ifndef LATENCYBENCH_H
+#define LATENCYBENCH_H
+
+/* Default device of the FreeRTOS benchmark service, the second channel */
+#define BENCH_DEVICE			"/dev/rpmsg1"
+/* Default number of messages per benchmark run */
+#define BENCH_COUNT				10000
+/* Poll budget of the RX vring for the polling echo run, in us */
+#define BENCH_POLL_US			100
+
+/* Run the transport benchmark against the service at 'dev' */
+int run_bench(char* dev, unsigned int count);
+
+#endif /* LATENCYBENCH_H */
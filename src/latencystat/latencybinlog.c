@@ -0,0 +1,164 @@
+/*
+ * Linux side of the binary log, see binlog_record.h.
+ *
+ * The records are read through the trace buffer reader, the log has the
+ * same header. FreeRTOS only stores the address of the format string and
+ * the raw arguments; the format strings (and the strings passed for %s) are
+ * looked up in the sections of the firmware image, which is loaded once.
+ * The image has to be the one FreeRTOS runs, otherwise the addresses point
+ * at the wrong text.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "latencybinlog.h"
+
+/* Everything that may stand between '%' and the conversion */
+#define BINLOG_SPEC_CHARS		"#0- +'123456789.hlqjzt"
+/* Length modifiers, dropped since every argument is an unsigned int */
+#define BINLOG_LENGTH_CHARS		"hlqjzt"
+
+int binlog_open(struct binlog_target* target, const char* file)
+{
+	struct trace_ring* ring;
+
+	if (trace_open_symbol(&target->trace, BINLOG_SYMBOL) < 0) {
+		return -1;
+	}
+	ring = target->trace.ring;
+
+	if (ring->timestamp_freq == 0 ||
+			ring->size < sizeof(struct binlog_record)) {
+		fprintf(stderr, "%s: not a binary log\n", BINLOG_SYMBOL);
+		trace_close(&target->trace);
+		return -1;
+	}
+	target->freq = ring->timestamp_freq;
+
+	if (shmem_load_image(file, &target->image) < 0) {
+		trace_close(&target->trace);
+		return -1;
+	}
+	return 0;
+}
+
+void binlog_close(struct binlog_target* target)
+{
+	shmem_free_image(&target->image);
+	trace_close(&target->trace);
+}
+
+/* Copy the conversion at 'format' to 'spec' without its length modifiers,
+ * returns the length of the conversion in 'format' or 0 if it is invalid */
+static size_t binlog_spec(const char* format, char* spec, size_t len)
+{
+	size_t n = 1 + strspn(format + 1, BINLOG_SPEC_CHARS);
+	size_t i;
+
+	if (format[n] == '\0' || n + 2 > len) {
+		return 0;
+	}
+	n++;
+
+	for (i = 0; i < n; i++) {
+		if (i == 0 || strchr(BINLOG_LENGTH_CHARS, format[i]) == NULL) {
+			*spec++ = format[i];
+		}
+	}
+	*spec = '\0';
+	return n;
+}
+
+void binlog_format(const struct shmem_image* image,
+		const struct binlog_record* rec, char* buf, size_t len)
+{
+	const char* format = shmem_image_string(image, rec->format);
+	const char* str;
+	unsigned int arg = 0;
+	unsigned int value;
+	size_t used = 0;
+	char spec[32];
+	char conv;
+	size_t n;
+	int ret;
+
+	if (format == NULL) {
+		snprintf(buf, len, "[binlog: format 0x%08x not in the image]\n",
+				rec->format);
+		return;
+	}
+
+	while (*format != '\0' && used + 1 < len) {
+		if (*format != '%') {
+			buf[used++] = *format++;
+			continue;
+		}
+
+		n = binlog_spec(format, spec, sizeof(spec));
+		if (n == 0) {
+			break;
+		}
+		format += n;
+		conv = spec[strlen(spec) - 1];
+
+		if (conv == '%') {
+			buf[used++] = '%';
+			continue;
+		}
+		if (arg >= rec->nargs || arg >= BINLOG_ARGS_MAX) {
+			ret = snprintf(buf + used, len - used, "<?>");
+		} else if (conv == 's') {
+			value = rec->args[arg++];
+			str = shmem_image_string(image, value);
+			if (str == NULL) {
+				ret = snprintf(buf + used, len - used, "<0x%08x>", value);
+			} else {
+				ret = snprintf(buf + used, len - used, spec, str);
+			}
+		} else if (strchr("diouxXc", conv) != NULL) {
+			ret = snprintf(buf + used, len - used, spec, rec->args[arg++]);
+		} else {
+			/* Floating point, pointers and the like */
+			ret = snprintf(buf + used, len - used, "<%%%c>", conv);
+			arg++;
+		}
+		if (ret < 0) {
+			break;
+		}
+		used += (size_t)ret < len - used ? (size_t)ret : len - used - 1;
+	}
+	buf[used] = '\0';
+}
+
+int binlog_follow(struct binlog_target* target, FILE* out)
+{
+	struct binlog_record recs[64];
+	char line[BINLOG_LINE_MAX];
+	unsigned int lost;
+	size_t len;
+	size_t i;
+
+	for (;;) {
+		len = trace_read(&target->trace, recs, sizeof(recs), &lost);
+		if (lost != 0) {
+			fprintf(out, "[binlog: %u records lost]\n",
+					lost / (unsigned int)sizeof(recs[0]));
+		}
+		if (len == 0) {
+			fflush(out);
+			usleep(TRACE_POLL_US);
+			continue;
+		}
+
+		for (i = 0; i < len / sizeof(recs[0]); i++) {
+			binlog_format(&target->image, &recs[i], line, sizeof(line));
+			if (fprintf(out, "[%12.6f] %s",
+					(double)recs[i].time / target->freq, line) < 0) {
+				perror(__FUNCTION__);
+				return -1;
+			}
+		}
+	}
+}
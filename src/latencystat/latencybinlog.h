@@ -0,0 +1,37 @@
+#ifndef LATENCYBINLOG_H
+#define LATENCYBINLOG_H
+
+#include <stdio.h>
+
+#include "binlog_record.h"
+#include "latencyshmem.h"
+#include "latencytrace.h"
+
+/* Symbol of the binary log header in the firmware image */
+#define BINLOG_SYMBOL			"__binlog_ring_start"
+
+/* Longest line formatted from one record */
+#define BINLOG_LINE_MAX			512
+
+struct binlog_target {
+	struct trace_target trace;
+	/* Firmware image the format strings are taken from */
+	struct shmem_image image;
+	/* Ticks per second of the record timestamps */
+	unsigned int freq;
+};
+
+/* Map the binary log and load the firmware image 'file' it was written by,
+ * usually SHMEM_FIRMWARE. Reading starts at the oldest record. */
+int binlog_open(struct binlog_target* target, const char* file);
+void binlog_close(struct binlog_target* target);
+
+/* Format 'rec' like printf would have on FreeRTOS, into 'buf' of 'len'
+ * bytes. Conversions which do not fit in a 32-bit word are not supported. */
+void binlog_format(const struct shmem_image* image,
+		const struct binlog_record* rec, char* buf, size_t len);
+
+/* Write the records to 'out' as they arrive, until an error occurs */
+int binlog_follow(struct binlog_target* target, FILE* out);
+
+#endif /* LATENCYBINLOG_H */
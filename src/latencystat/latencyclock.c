@@ -0,0 +1,137 @@
+/*
+ * Common time base of FreeRTOS and Linux.
+ *
+ * FreeRTOS takes its timestamps from the global timer, which both CPUs
+ * share. Linux reads the same counter through /dev/mem between two reads
+ * of CLOCK_MONOTONIC; the middle of the two is taken as the moment of the
+ * global timer reading. An uncached read of the timer may take a while or
+ * be interrupted, so the calibration keeps the reading with the shortest
+ * window out of CLOCK_SAMPLES.
+ *
+ * Without access to /dev/mem the offset is estimated through rpmsg from
+ * the timestamps in the ACKs of TIME requests.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "latencyclock.h"
+
+/* Registers of the global timer, the counter is read high, low, high until
+ * the high word is stable */
+struct clock_global_timer {
+	volatile unsigned int low;
+	volatile unsigned int high;
+};
+
+unsigned long long clock_monotonic_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static unsigned long long clock_read_global(struct clock_global_timer* timer)
+{
+	unsigned int high;
+	unsigned int low;
+
+	do {
+		high = timer->high;
+		low = timer->low;
+	} while (timer->high != high);
+	return ((unsigned long long)high << 32) | low;
+}
+
+/* Nanoseconds of 'ticks', without overflowing for large counter values */
+static unsigned long long clock_ticks_ns(unsigned long long ticks,
+		unsigned int freq)
+{
+	return ticks / freq * 1000000000ULL +
+			ticks % freq * 1000000000ULL / freq;
+}
+
+int clock_calibrate(struct clock_sync* sync, unsigned int freq)
+{
+	struct shmem_mapping map;
+	struct clock_global_timer* timer;
+	unsigned long long before;
+	unsigned long long after;
+	unsigned long long ticks;
+	int i;
+
+	if (freq == 0) {
+		fprintf(stderr, "%s: global timer frequency unknown\n", __FUNCTION__);
+		return -1;
+	}
+	if (shmem_map(&map, CLOCK_GLOBAL_TIMER, sizeof(*timer)) < 0) {
+		return -1;
+	}
+	timer = map.ptr;
+
+	sync->freq = freq;
+	sync->window_ns = ~0ULL;
+	for (i = 0; i < CLOCK_SAMPLES; i++) {
+		before = clock_monotonic_ns();
+		ticks = clock_read_global(timer);
+		after = clock_monotonic_ns();
+		if (after - before < sync->window_ns) {
+			sync->window_ns = after - before;
+			sync->offset_ns = (long long)(before + (after - before) / 2) -
+					(long long)clock_ticks_ns(ticks, freq);
+		}
+	}
+
+	shmem_unmap(&map);
+	return 0;
+}
+
+int clock_calibrate_rpmsg(struct clock_sync* sync, struct rpmsg_target* target,
+		struct rpc_time* time)
+{
+	long long transit;
+	long long rx;
+	long long tx;
+	int i;
+
+	sync->window_ns = ~0ULL;
+	for (i = 0; i < CLOCK_RPMSG_SAMPLES; i++) {
+		if (rpmsg_send_message(target, TIME) < 0 ||
+				rpmsg_read_response(target, (char *)time, sizeof(*time)) < 0) {
+			return -1;
+		}
+		if (time->timestamp_freq == 0) {
+			fprintf(stderr, "%s: global timer frequency unknown\n",
+					__FUNCTION__);
+			return -1;
+		}
+		sync->freq = time->timestamp_freq;
+
+		rx = clock_ticks_ns(target->ack.rx_time, sync->freq);
+		tx = clock_ticks_ns(target->ack.tx_time, sync->freq);
+		transit = (long long)(target->acked_ns - target->sent_ns) - (tx - rx);
+		if (transit >= 0 && (unsigned long long)transit < sync->window_ns) {
+			sync->window_ns = transit;
+			sync->offset_ns = ((long long)(target->sent_ns + target->acked_ns) -
+					(rx + tx)) / 2;
+		}
+	}
+	return 0;
+}
+
+void clock_one_way(const struct clock_sync* sync,
+		const struct rpmsg_target* target, long long* to_freertos,
+		long long* to_linux)
+{
+	*to_freertos = clock_to_monotonic(sync, target->ack.rx_time) -
+			(long long)target->sent_ns;
+	*to_linux = (long long)target->acked_ns -
+			clock_to_monotonic(sync, target->ack.tx_time);
+}
+
+long long clock_to_monotonic(const struct clock_sync* sync,
+		unsigned long long ticks)
+{
+	return (long long)clock_ticks_ns(ticks, sync->freq) + sync->offset_ns;
+}
@@ -0,0 +1,52 @@
+#ifndef LATENCYCLOCK_H
+#define LATENCYCLOCK_H
+
+#include "latencyshmem.h"
+#include "latencyrpmsg.h"
+
+/* Global timer of the Cortex-A9 MPCore, one 64-bit counter shared by both
+ * CPUs which FreeRTOS stamps its events and log records with */
+#define CLOCK_GLOBAL_TIMER		0xF8F00200
+
+/* Readings taken for a calibration, the one taken fastest is used */
+#define CLOCK_SAMPLES			64
+/* TIME requests sent for a calibration through rpmsg */
+#define CLOCK_RPMSG_SAMPLES		8
+
+/* Mapping of global timer ticks to Linux CLOCK_MONOTONIC */
+struct clock_sync {
+	/* Ticks per second of the global timer */
+	unsigned int freq;
+	/* CLOCK_MONOTONIC in ns when the global timer was 0 */
+	long long offset_ns;
+	/* Time the best reading took, the offset is good to half of it */
+	unsigned long long window_ns;
+};
+
+/* Nanoseconds of CLOCK_MONOTONIC */
+unsigned long long clock_monotonic_ns(void);
+
+/* Work out the offset of the global timer, which runs at 'freq' Hz, to
+ * CLOCK_MONOTONIC by reading both close together. The timer is read
+ * through /dev/mem, which needs root. */
+int clock_calibrate(struct clock_sync* sync, unsigned int freq);
+
+/* Same through rpmsg, without root: the ACK of a TIME request carries the
+ * global timer when the request arrived and when it was answered (struct
+ * rpc_ack). Like NTP the offset assumes the message took as long each way,
+ * the exchange with the least time in transit is used. 'time' is set to
+ * the response of the last request. */
+int clock_calibrate_rpmsg(struct clock_sync* sync, struct rpmsg_target* target,
+		struct rpc_time* time);
+
+/* Time in ns the last request on 'target' took to reach FreeRTOS and its
+ * ACK to come back */
+void clock_one_way(const struct clock_sync* sync,
+		const struct rpmsg_target* target, long long* to_freertos,
+		long long* to_linux);
+
+/* CLOCK_MONOTONIC in ns at global timer 'ticks' */
+long long clock_to_monotonic(const struct clock_sync* sync,
+		unsigned long long ticks);
+
+#endif /* LATENCYCLOCK_H */
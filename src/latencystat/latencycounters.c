@@ -0,0 +1,115 @@
+/*
+ * Linux side of the statistics page, see stats_page.h.
+ *
+ * The address of the page is taken from its entry in the resource table of
+ * the firmware image, the page is mapped uncached through /dev/mem. Reading
+ * it sends no message and FreeRTOS does not notice, so the counters can be
+ * watched while the transport is busy or stuck. The 64-bit values are read
+ * as two words, the snapshot protocol makes sure no update was in between.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sched.h>
+
+#include "latencycounters.h"
+
+/* Word by word, the mapping does not allow unaligned accesses */
+static void counters_copy(void* dst, const volatile void* src, size_t len)
+{
+	uint32_t* to = dst;
+	const volatile uint32_t* from = src;
+
+	for (; len >= sizeof(*to); len -= sizeof(*to)) {
+		*to++ = *from++;
+	}
+}
+
+int counters_open(struct counters_target* target, const char* file)
+{
+	unsigned int addr;
+	unsigned int len;
+
+	if (shmem_find_resource(file, STATS_RESOURCE_NAME, &addr, &len) < 0) {
+		return -1;
+	}
+	if (len < sizeof(struct stats_page)) {
+		fprintf(stderr, "%s: statistics page of %u bytes too small\n", file,
+				len);
+		return -1;
+	}
+	if (shmem_map(&target->map, addr, sizeof(struct stats_page)) < 0) {
+		return -1;
+	}
+	target->page = target->map.ptr;
+
+	if (target->page->magic != STATS_MAGIC ||
+			target->page->size != sizeof(struct stats_page)) {
+		fprintf(stderr, "%s: statistics page not set up by FreeRTOS\n",
+				STATS_RESOURCE_NAME);
+		shmem_unmap(&target->map);
+		return -1;
+	}
+	return 0;
+}
+
+void counters_close(struct counters_target* target)
+{
+	shmem_unmap(&target->map);
+}
+
+int counters_snapshot(struct counters_target* target, struct stats_page* copy)
+{
+	struct stats_page* page = target->page;
+	unsigned int count;
+	unsigned int end;
+	unsigned int i;
+
+	for (i = 0; i < COUNTERS_TRIES; i++) {
+		end = page->end;
+		__sync_synchronize();
+		count = page->count;
+		if (count > STATS_ENTRIES_MAX) {
+			count = STATS_ENTRIES_MAX;
+		}
+		counters_copy(copy, page, offsetof(struct stats_page, entries) +
+				count * sizeof(struct stats_entry));
+		__sync_synchronize();
+		if (page->begin == end) {
+			copy->count = count;
+			return count;
+		}
+		/* An update was in progress, let FreeRTOS finish it */
+		sched_yield();
+	}
+	fprintf(stderr, "%s: no consistent snapshot in %u attempts\n",
+			STATS_RESOURCE_NAME, COUNTERS_TRIES);
+	return -1;
+}
+
+int counters_print(FILE* out)
+{
+	static struct stats_page copy;
+	struct counters_target target;
+	struct stats_entry* entry;
+	int count;
+	int i;
+
+	if (counters_open(&target, SHMEM_FIRMWARE) < 0) {
+		return -1;
+	}
+	count = counters_snapshot(&target, &copy);
+	counters_close(&target);
+	if (count < 0) {
+		return -1;
+	}
+
+	fprintf(out, "%-*s %20s\n", STATS_NAME_MAX, "NAME", "VALUE");
+	for (i = 0; i < count; i++) {
+		entry = &copy.entries[i];
+		entry->name[STATS_NAME_MAX - 1] = '\0';
+		fprintf(out, "%-*s %20llu%s\n", STATS_NAME_MAX, entry->name,
+				entry->value, entry->kind == STATS_GAUGE ? " (gauge)" : "");
+	}
+	return 0;
+}
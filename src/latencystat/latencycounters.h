@@ -0,0 +1,29 @@
+#ifndef LATENCYCOUNTERS_H
+#define LATENCYCOUNTERS_H
+
+#include <stdio.h>
+
+#include "stats_page.h"
+#include "latencyshmem.h"
+
+/* Attempts at a consistent snapshot before giving up */
+#define COUNTERS_TRIES			1000
+
+struct counters_target {
+	struct shmem_mapping map;
+	struct stats_page* page;
+};
+
+/* Map the statistics page described in the resource table of the firmware
+ * image 'file', usually SHMEM_FIRMWARE */
+int counters_open(struct counters_target* target, const char* file);
+void counters_close(struct counters_target* target);
+
+/* Copy a consistent snapshot of the page to 'copy'. Returns the number of
+ * entries, or -1 if FreeRTOS was updating it on every attempt. */
+int counters_snapshot(struct counters_target* target, struct stats_page* copy);
+
+/* Print the counters and gauges of the firmware once */
+int counters_print(FILE* out);
+
+#endif /* LATENCYCOUNTERS_H */
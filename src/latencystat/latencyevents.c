@@ -0,0 +1,313 @@
+/*
+ * Conversion of the kernel events of FreeRTOS (see trace_event.h) to the
+ * Chrome JSON trace format.
+ *
+ * The event buffer is read once through the trace buffer reader, from the
+ * oldest event still there. Running times become complete ("X") events on
+ * the track of the task, interrupts on a track of their own; blocking,
+ * delays and queue operations become instant ("i") events.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "latencytrace.h"
+#include "latencyevents.h"
+
+/* Track of the interrupts, the tasks follow */
+#define EVENT_TID_IRQ			1
+#define EVENT_TID_TASK			2
+
+struct event_task {
+	unsigned int tcb;
+	char name[EVENT_NAME_MAX + 1];
+};
+
+struct event_state {
+	FILE* out;
+	unsigned int freq;
+	double shift_us;
+	unsigned int written;
+
+	struct event_task tasks[EVENT_TASKS_MAX];
+	unsigned int count;
+
+	/* Task running since 'since', -1 before the first switch */
+	int running;
+	unsigned long long since;
+
+	/* Interrupt being handled since 'irq_since' */
+	int in_irq;
+	unsigned int irq;
+	unsigned long long irq_since;
+};
+
+static double event_us(struct event_state* st, unsigned long long time)
+{
+	return (double)time * 1000000.0 / st->freq + st->shift_us;
+}
+
+/* Track of the task with the TCB 'tcb', added if it is new */
+static int event_task(struct event_state* st, unsigned int tcb)
+{
+	unsigned int i;
+
+	for (i = 0; i < st->count; i++) {
+		if (st->tasks[i].tcb == tcb) {
+			return i;
+		}
+	}
+	if (st->count == EVENT_TASKS_MAX) {
+		return EVENT_TASKS_MAX - 1;
+	}
+	st->tasks[st->count].tcb = tcb;
+	snprintf(st->tasks[st->count].name, sizeof(st->tasks[0].name),
+			"task 0x%08x", tcb);
+	return st->count++;
+}
+
+void events_json_string(FILE* out, const char* str)
+{
+	fputc('"', out);
+	for (; *str != '\0'; str++) {
+		if (*str == '"' || *str == '\\') {
+			fprintf(out, "\\%c", *str);
+		} else if ((unsigned char)*str < 0x20) {
+			fprintf(out, "\\u%04x", *str);
+		} else {
+			fputc(*str, out);
+		}
+	}
+	fputc('"', out);
+}
+
+/* Start the next entry of the traceEvents array */
+static void event_begin(struct event_state* st)
+{
+	fprintf(st->out, "%s\n", st->written++ ? "," : "");
+}
+
+static void event_slice(struct event_state* st, const char* name,
+		unsigned int tid, unsigned long long from, unsigned long long to)
+{
+	event_begin(st);
+	fprintf(st->out, "{\"name\":");
+	events_json_string(st->out, name);
+	fprintf(st->out, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+			"\"ts\":%.3f,\"dur\":%.3f}", tid, event_us(st, from),
+			event_us(st, to) - event_us(st, from));
+}
+
+static void event_instant(struct event_state* st, const char* name,
+		unsigned int tid, unsigned long long time, unsigned int queue)
+{
+	event_begin(st);
+	fprintf(st->out, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\","
+			"\"pid\":1,\"tid\":%u,\"ts\":%.3f", name, tid,
+			event_us(st, time));
+	if (queue != 0) {
+		fprintf(st->out, ",\"args\":{\"queue\":\"0x%08x\"}", queue);
+	}
+	fprintf(st->out, "}");
+}
+
+static void event_name(struct event_state* st, const char* kind,
+		unsigned int tid, const char* name)
+{
+	event_begin(st);
+	fprintf(st->out, "{\"name\":\"%s\",\"ph\":\"M\",\"pid\":1,", kind);
+	if (tid != 0) {
+		fprintf(st->out, "\"tid\":%u,", tid);
+	}
+	fprintf(st->out, "\"args\":{\"name\":");
+	events_json_string(st->out, name);
+	fprintf(st->out, "}}");
+}
+
+/* Track the running task or, in an interrupt, the interrupt track */
+static unsigned int event_tid(struct event_state* st,
+		const struct trace_event* ev)
+{
+	if (st->in_irq || ev->info != 0 || st->running < 0) {
+		return EVENT_TID_IRQ;
+	}
+	return EVENT_TID_TASK + st->running;
+}
+
+static void event_convert(struct event_state* st, const struct trace_event* ev)
+{
+	struct event_task* task;
+	unsigned int offset;
+	char name[32];
+	int i;
+
+	switch (ev->type) {
+	case TRACE_EVENT_TASK_NAME:
+		task = &st->tasks[event_task(st, ev->arg)];
+		offset = ev->info * sizeof(ev->name);
+		if (offset == 0) {
+			memset(task->name, 0, sizeof(task->name));
+		}
+		if (offset + sizeof(ev->name) < sizeof(task->name)) {
+			memcpy(task->name + offset, ev->name, sizeof(ev->name));
+		}
+		break;
+	case TRACE_EVENT_SWITCH_IN:
+		i = event_task(st, ev->arg);
+		if (i == st->running) {
+			break;
+		}
+		if (st->running >= 0) {
+			event_slice(st, st->tasks[st->running].name,
+					EVENT_TID_TASK + st->running, st->since, ev->time);
+		}
+		st->running = i;
+		st->since = ev->time;
+		break;
+	case TRACE_EVENT_TASK_DELETE:
+		event_instant(st, "deleted", EVENT_TID_TASK + event_task(st, ev->arg),
+				ev->time, 0);
+		break;
+	case TRACE_EVENT_TASK_DELAY:
+		event_instant(st, "delay", event_tid(st, ev), ev->time, 0);
+		break;
+	case TRACE_EVENT_QUEUE_SEND:
+		event_instant(st, "queue send", event_tid(st, ev), ev->time, ev->arg);
+		break;
+	case TRACE_EVENT_QUEUE_RECEIVE:
+		event_instant(st, "queue receive", event_tid(st, ev), ev->time,
+				ev->arg);
+		break;
+	case TRACE_EVENT_BLOCK_SEND:
+		event_instant(st, "blocked on send", event_tid(st, ev), ev->time,
+				ev->arg);
+		break;
+	case TRACE_EVENT_BLOCK_RECEIVE:
+		event_instant(st, "blocked on receive", event_tid(st, ev), ev->time,
+				ev->arg);
+		break;
+	case TRACE_EVENT_IRQ_ENTER:
+		st->in_irq = 1;
+		st->irq = ev->arg;
+		st->irq_since = ev->time;
+		break;
+	case TRACE_EVENT_IRQ_EXIT:
+		/* The buffer may start in the middle of an interrupt */
+		if (st->in_irq) {
+			snprintf(name, sizeof(name), "IRQ %u", st->irq);
+			event_slice(st, name, EVENT_TID_IRQ, st->irq_since, ev->time);
+		}
+		st->in_irq = 0;
+		break;
+	default:
+		break;
+	}
+}
+
+unsigned int events_write_entries(const struct trace_event* events,
+		unsigned int count, unsigned int freq, double shift_us,
+		unsigned int written, FILE* out)
+{
+	struct event_state st;
+	unsigned long long last = 0;
+	unsigned int i;
+
+	memset(&st, 0, sizeof(st));
+	st.out = out;
+	st.freq = freq;
+	st.shift_us = shift_us;
+	st.written = written;
+	st.running = -1;
+
+	for (i = 0; i < count; i++) {
+		event_convert(&st, &events[i]);
+		if (events[i].type != TRACE_EVENT_TASK_NAME) {
+			last = events[i].time;
+		}
+	}
+	/* The task still running at the end of the buffer */
+	if (st.running >= 0) {
+		event_slice(&st, st.tasks[st.running].name,
+				EVENT_TID_TASK + st.running, st.since, last);
+	}
+
+	event_name(&st, "process_name", 0, "FreeRTOS");
+	event_name(&st, "thread_name", EVENT_TID_IRQ, "Interrupts");
+	for (i = 0; i < st.count; i++) {
+		event_name(&st, "thread_name", EVENT_TID_TASK + i, st.tasks[i].name);
+	}
+	return st.written;
+}
+
+void events_write_json(const struct trace_event* events, unsigned int count,
+		unsigned int freq, FILE* out)
+{
+	double shift_us = 0;
+	unsigned int i;
+
+	/* The trace starts at the first event */
+	for (i = 0; i < count; i++) {
+		if (events[i].type != TRACE_EVENT_TASK_NAME) {
+			shift_us = -(double)events[i].time * 1000000.0 / freq;
+			break;
+		}
+	}
+
+	fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+	events_write_entries(events, count, freq, shift_us, 0, out);
+	fprintf(out, "\n]}\n");
+}
+
+int events_read(struct trace_event** events, unsigned int* freq)
+{
+	struct trace_target trace;
+	unsigned int count;
+	unsigned int lost;
+	size_t len;
+
+	if (trace_open_symbol(&trace, EVENT_SYMBOL) < 0) {
+		return -1;
+	}
+	if (trace.ring->timestamp_freq == 0 ||
+			trace.ring->size < sizeof(struct trace_event)) {
+		fprintf(stderr, "%s: not a kernel event buffer\n", EVENT_SYMBOL);
+		trace_close(&trace);
+		return -1;
+	}
+
+	*events = malloc(trace.ring->size);
+	if (*events == NULL) {
+		perror(__FUNCTION__);
+		trace_close(&trace);
+		return -1;
+	}
+	len = trace_read(&trace, *events, trace.ring->size, &lost);
+	count = len / sizeof(**events);
+	*freq = trace.ring->timestamp_freq;
+
+	fprintf(stderr, "%u events", count);
+	if (lost != 0) {
+		fprintf(stderr, ", %u overwritten while reading",
+				lost / (unsigned int)sizeof(**events));
+	}
+	fprintf(stderr, "\n");
+
+	trace_close(&trace);
+	return count;
+}
+
+int events_export(FILE* out)
+{
+	struct trace_event* events;
+	unsigned int freq;
+	int count;
+
+	count = events_read(&events, &freq);
+	if (count < 0) {
+		return -1;
+	}
+	events_write_json(events, count, freq, out);
+	free(events);
+	return 0;
+}
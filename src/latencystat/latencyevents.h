@@ -0,0 +1,42 @@
+#ifndef LATENCYEVENTS_H
+#define LATENCYEVENTS_H
+
+#include <stdio.h>
+
+#include "trace_event.h"
+
+/* Symbol of the kernel event buffer header in the firmware image */
+#define EVENT_SYMBOL			"__event_ring_start"
+
+/* Tasks told apart in a trace, later ones share the last track */
+#define EVENT_TASKS_MAX			64
+/* Longest task name kept */
+#define EVENT_NAME_MAX			32
+
+/* Write the kernel events now in the event buffer to 'out' as a trace in
+ * the Chrome JSON trace format, which chrome://tracing and the Perfetto UI
+ * open. Each task gets a track showing when it ran and when it blocked,
+ * the interrupts get one more. */
+int events_export(FILE* out);
+
+/* Convert 'count' events with timestamps of 'freq' Hz, as events_export() */
+void events_write_json(const struct trace_event* events, unsigned int count,
+		unsigned int freq, FILE* out);
+
+/* Write the events as entries of a traceEvents array which already holds
+ * 'written' entries, for traces merged with other sources. Timestamps are
+ * event ticks in us plus 'shift_us'. Returns the number of entries then in
+ * the array. */
+unsigned int events_write_entries(const struct trace_event* events,
+		unsigned int count, unsigned int freq, double shift_us,
+		unsigned int written, FILE* out);
+
+/* Write 'str' as a JSON string, quoted and escaped */
+void events_json_string(FILE* out, const char* str);
+
+/* Read the kernel events now in the event buffer into a new array, which
+ * the caller frees. Returns the number of events, or -1. 'freq' is set to
+ * the frequency of their timestamps. */
+int events_read(struct trace_event** events, unsigned int* freq);
+
+#endif /* LATENCYEVENTS_H */
@@ -0,0 +1,82 @@
+/*
+ * Linux side of the control mailbox, see mailbox_slot.h.
+ *
+ * Like the bulk channel the mailbox is mapped uncached through /dev/mem. The
+ * doorbell is raised by writing the SGI register of the GIC distributor, an
+ * SGI targeted at the FreeRTOS CPU does not disturb Linux. This needs root
+ * and a kernel which allows access to that memory.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "latencymailbox.h"
+
+/* SGIR: target list in bits 23:16, interrupt ID in bits 3:0 */
+#define GIC_SGIR_TARGET(cpu)	(1 << (16 + (cpu)))
+
+static unsigned long long mailbox_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int mailbox_open(struct mailbox_target* target)
+{
+	unsigned int addr;
+
+	if (shmem_find_symbol(SHMEM_FIRMWARE, MAILBOX_SYMBOL, &addr) < 0 ||
+			shmem_map(&target->map, addr, sizeof(struct mailbox_slot)) < 0) {
+		return -1;
+	}
+	target->mb = target->map.ptr;
+
+	if (target->mb->magic != MAILBOX_MAGIC || target->mb->doorbell > 15) {
+		fprintf(stderr, "%s: mailbox not set up by FreeRTOS\n",
+				MAILBOX_SYMBOL);
+		shmem_unmap(&target->map);
+		return -1;
+	}
+	if (shmem_map(&target->gic, MAILBOX_GIC_SGIR, sizeof(uint32_t)) < 0) {
+		shmem_unmap(&target->map);
+		return -1;
+	}
+	return 0;
+}
+
+void mailbox_close(struct mailbox_target* target)
+{
+	shmem_unmap(&target->gic);
+	shmem_unmap(&target->map);
+}
+
+int mailbox_call(struct mailbox_target* target, unsigned int command,
+		unsigned int arg)
+{
+	struct mailbox_slot* mb = target->mb;
+	unsigned int seq = mb->seq + 1;
+	unsigned long long start;
+
+	mb->command = command;
+	mb->arg = arg;
+	/* The command must be complete before FreeRTOS sees the new seq */
+	__sync_synchronize();
+	mb->seq = seq;
+	__sync_synchronize();
+	*(volatile uint32_t *)target->gic.ptr =
+			GIC_SGIR_TARGET(MAILBOX_FREERTOS_CPU) | mb->doorbell;
+
+	start = mailbox_now_ns();
+	while (mb->done != seq) {
+		if (mailbox_now_ns() - start > MAILBOX_TIMEOUT_NS) {
+			fprintf(stderr, "mailbox: command %u timed out\n", command);
+			return -1;
+		}
+	}
+	/* Read the status only after done */
+	__sync_synchronize();
+	return mb->status;
+}
@@ -0,0 +1,35 @@
+#ifndef LATENCYMAILBOX_H
+#define LATENCYMAILBOX_H
+
+#include "mailbox_slot.h"
+#include "latencyshmem.h"
+
+/* Symbol of the mailbox in the firmware image */
+#define MAILBOX_SYMBOL			"__mailbox_start"
+
+/* SGI register of the GIC distributor of the Cortex-A9 MPCore, Linux
+ * raises the doorbell through it */
+#define MAILBOX_GIC_SGIR		0xF8F01F00
+/* CPU FreeRTOS runs on */
+#define MAILBOX_FREERTOS_CPU	1
+
+/* Give up on a command after this long */
+#define MAILBOX_TIMEOUT_NS		100000000ULL
+
+struct mailbox_target {
+	struct shmem_mapping map;
+	struct shmem_mapping gic;
+	struct mailbox_slot* mb;
+};
+
+/* Map the mailbox and the SGI register. Returns -1 if the firmware has no
+ * mailbox or the memory cannot be mapped. */
+int mailbox_open(struct mailbox_target* target);
+void mailbox_close(struct mailbox_target* target);
+
+/* Run 'command' with 'arg' on FreeRTOS and wait until it is done. Returns
+ * the mailbox_status, or -1 on timeout. */
+int mailbox_call(struct mailbox_target* target, unsigned int command,
+		unsigned int arg);
+
+#endif /* LATENCYMAILBOX_H */
@@ -1,23 +1,98 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <poll.h>
 
 #include "latencyrpmsg.h"
+#include "latencyclock.h"
+
+/* Wait until a message can be read, at most RPMSG_TIMEOUT_MS */
+static int rpmsg_wait_readable(struct rpmsg_target* target)
+{
+	struct pollfd pfd;
+	int ret;
+
+	pfd.fd = target->fd;
+	pfd.events = POLLIN;
+	ret = poll(&pfd, 1, RPMSG_TIMEOUT_MS);
+	if (ret < 0) {
+		perror(__FUNCTION__);
+		return -1;
+	}
+	if (ret == 0) {
+		fprintf(stderr, "%s: no answer from FreeRTOS in %d ms\n",
+				__FUNCTION__, RPMSG_TIMEOUT_MS);
+		return -1;
+	}
+	return 0;
+}
+
+/* Wait for the ACK of 'command'. In case extra data is passed on command,
+ * disregard until an ACK is found. The rest of the struct rpc_ack follows
+ * its first word. */
+static int rpmsg_wait_ack(struct rpmsg_target* target, unsigned int command)
+{
+	ssize_t ret;
+	unsigned int response_command = 0;
+
+	while (1)
+	{
+		if (rpmsg_wait_readable(target) < 0) {
+			return -1;
+		}
+		ret = read(target->fd, &response_command, sizeof(unsigned int));
+		if (ret < 0) {
+			perror(__FUNCTION__);
+			return -1;
+		}
+
+		/* Check if ACK from firmware was sent */
+		if ((command == (response_command & STATE_MASK)) &&
+				(response_command & REMOTEPROC_REQUEST_ACK_MASK))
+		{
+			target->acked_ns = clock_monotonic_ns();
+			target->ack.state = response_command;
+			if (rpmsg_read_response(target, (char *)&target->ack +
+					sizeof(response_command), sizeof(target->ack) -
+					sizeof(response_command)) < 0) {
+				return -1;
+			}
+			if (target->ack.status != RPC_OK) {
+				fprintf(stderr, "%4d: Command %d not handled (%s)\n",
+						target->command_no++, command,
+						target->ack.status == RPC_BUSY ? "busy" : "rejected");
+				return -1;
+			}
+			printf("%4d: Command %d ACKed\n", target->command_no++, command);
+			return 0;
+		}
+	}
+	return -1;
+}
 
 /* Not checking return state but it can be done */
 int rpmsg_send_message(struct rpmsg_target* target, latency_demo_msg_type command)
 {
-	ssize_t ret;
 	unsigned int current_command = (unsigned int)command;
-	unsigned int response_command = 0;
 
-	if (target == NULL) {
+	return rpmsg_send_request(target, &current_command,
+			sizeof(current_command));
+}
+
+int rpmsg_send_request(struct rpmsg_target* target, const void* data,
+		size_t len)
+{
+	ssize_t ret;
+
+	if (target == NULL || len < sizeof(unsigned int)) {
 		return -1;
 	}
 
 	/* Send commands to FreeRTOS */
-	ret = write(target->fd, &current_command, sizeof(unsigned int));
+	target->sent_ns = clock_monotonic_ns();
+	ret = write(target->fd, data, len);
 	if (ret < 0) {
 		perror(__FUNCTION__);
 		return -1;
@@ -27,26 +102,48 @@ int rpmsg_send_message(struct rpmsg_target* target, latency_demo_msg_type comman
 	 * This application expects the FreeRTOS application
 	 * sends back acknowlodgement message after it receives
 	 * requests.
-	 * 
-	 * In case extra data is passed on command, disregard until an ACK is found.
 	 */
-	while (1)
-	{
-		ret = read(target->fd, &response_command, sizeof(unsigned int));
-		if (ret < 0) {
+	return rpmsg_wait_ack(target, *(const unsigned int *)data);
+}
+
+int rpmsg_upload(struct rpmsg_target* target, latency_demo_msg_type command,
+		const void* data, size_t len, struct rpc_upload_result* result)
+{
+	char buf[RPMSG_MSG_MAX];
+	struct rpc_upload_chunk* chunk = (struct rpc_upload_chunk *)buf;
+	size_t sent = 0;
+	size_t part;
+
+	if (target == NULL || len > RPC_UPLOAD_MAX) {
+		return -1;
+	}
+
+	/* Every chunk is sent, even an empty upload takes one */
+	chunk->opcode = UPLOAD;
+	chunk->target = command;
+	chunk->total = len;
+	chunk->seq = 0;
+	do {
+		part = len - sent;
+		if (part > sizeof(buf) - sizeof(*chunk)) {
+			part = sizeof(buf) - sizeof(*chunk);
+		}
+		memcpy(buf + sizeof(*chunk), (const char *)data + sent, part);
+		target->sent_ns = clock_monotonic_ns();
+		if (write(target->fd, buf, sizeof(*chunk) + part) < 0) {
 			perror(__FUNCTION__);
 			return -1;
 		}
+		chunk->seq++;
+		sent += part;
+	} while (sent < len);
 
-		/* Check if ACK from firmware was sent */
-		if ((current_command == (response_command & STATE_MASK)) &&
-				(response_command & REMOTEPROC_REQUEST_ACK_MASK))
-		{
-			printf("%4d: Command %d ACKed\n", target->command_no++, command);
-			return 0;
-		}
+	/* One ACK for the whole upload */
+	if (rpmsg_wait_ack(target, UPLOAD) < 0 ||
+			rpmsg_read_response(target, (char *)result, sizeof(*result)) < 0) {
+		return -1;
 	}
-	return -1;
+	return 0;
 }
 
 int rpmsg_read_response(struct rpmsg_target* target, char* data, size_t len)
@@ -62,6 +159,9 @@ int rpmsg_read_response(struct rpmsg_target* target, char* data, size_t len)
 
 	if (len != 0) {
 		do {
+			if (rpmsg_wait_readable(target) < 0) {
+				return -1;
+			}
 			ret = read(target->fd, data_current, data_left); /* Read statistic */
 			if (ret < 0) {
 				perror(__FUNCTION__);
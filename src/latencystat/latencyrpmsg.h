@@ -6,14 +6,35 @@
 struct rpmsg_target {
 	int fd;
 	int command_no;
+	/* ACK of the last request, with the CLOCK_MONOTONIC times in ns the
+	 * request was sent and the ACK was read */
+	struct rpc_ack ack;
+	unsigned long long sent_ns;
+	unsigned long long acked_ns;
 };
 
 #define REMOTEPROC_REQUEST_ACK_MASK			0x80000000
 
+/* Longest wait for an ACK or a response, FreeRTOS may have dropped the
+ * request or its answer */
+#define RPMSG_TIMEOUT_MS					5000
+
 int rpmsg_open_device(struct rpmsg_target* target, char* dev);
 int rpmsg_close_device(struct rpmsg_target* target);
 
 int rpmsg_send_message(struct rpmsg_target* target, latency_demo_msg_type command);
 int rpmsg_read_response(struct rpmsg_target* target, char* data, size_t len);
+/* Send a request with a payload, the opcode is its first word, and wait
+ * for the ACK. Returns -1 on a NAK, see rpc_status. */
+int rpmsg_send_request(struct rpmsg_target* target, const void* data,
+		size_t len);
+
+/* Payload of the largest message of the rpmsg bus */
+#define RPMSG_MSG_MAX						496
+
+/* Upload 'len' bytes to the handler of 'command' in chunks. Fills in the
+ * result of the upload, the response of 'command' (if any) follows it. */
+int rpmsg_upload(struct rpmsg_target* target, latency_demo_msg_type command,
+		const void* data, size_t len, struct rpc_upload_result* result);
 
 #endif /* LATENCYRPMSG_H */
\ No newline at end of file
@@ -0,0 +1,289 @@
+/*
+ * Access to memory shared with FreeRTOS outside of rpmsg. The addresses come
+ * from the resource table or the symbol table of the firmware image, the
+ * memory is mapped through /dev/mem.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <elf.h>
+#include <sys/mman.h>
+
+#include "latencyshmem.h"
+
+/* Resource table of the firmware as far as needed here, see
+ * remoteproc_kernel.h of the FreeRTOS application */
+#define RSC_TYPE_DEVMEM			1
+
+struct rsc_table_header {
+	unsigned int version;
+	unsigned int num;
+	unsigned int reserved[2];
+	/* Followed by 'num' offsets of the entries from the table start */
+};
+
+struct rsc_devmem {
+	unsigned int type;
+	unsigned int da;
+	unsigned int pa;
+	unsigned int len;
+	unsigned int flags;
+	unsigned int reserved;
+	char name[32];
+};
+
+static int read_at(int fd, void* buf, size_t len, off_t offset)
+{
+	if (pread(fd, buf, len, offset) != (ssize_t)len) {
+		return -1;
+	}
+	return 0;
+}
+
+int shmem_find_symbol(const char* file, const char* name, unsigned int* addr)
+{
+	Elf32_Ehdr ehdr;
+	Elf32_Shdr symtab;
+	Elf32_Shdr strtab;
+	Elf32_Sym sym;
+	char sym_name[64];
+	size_t name_len = strlen(name) + 1;
+	unsigned int i;
+	int ret = -1;
+	int fd;
+
+	if (name_len > sizeof(sym_name)) {
+		return -1;
+	}
+
+	fd = open(file, O_RDONLY);
+	if (fd < 0) {
+		perror(file);
+		return -1;
+	}
+
+	if (read_at(fd, &ehdr, sizeof(ehdr), 0) < 0 ||
+			memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0 ||
+			ehdr.e_ident[EI_CLASS] != ELFCLASS32 ||
+			ehdr.e_shentsize != sizeof(Elf32_Shdr)) {
+		fprintf(stderr, "%s: not a 32 bit ELF file\n", file);
+		goto out;
+	}
+
+	/* Find the symbol table, its string table is the section it links to */
+	for (i = 0; i < ehdr.e_shnum; i++) {
+		if (read_at(fd, &symtab, sizeof(symtab),
+				ehdr.e_shoff + i * sizeof(symtab)) < 0) {
+			goto out;
+		}
+		if (symtab.sh_type == SHT_SYMTAB) {
+			break;
+		}
+	}
+	if (i == ehdr.e_shnum || symtab.sh_link >= ehdr.e_shnum ||
+			read_at(fd, &strtab, sizeof(strtab),
+				ehdr.e_shoff + symtab.sh_link * sizeof(strtab)) < 0) {
+		fprintf(stderr, "%s: no symbol table\n", file);
+		goto out;
+	}
+
+	for (i = 0; i < symtab.sh_size / sizeof(sym); i++) {
+		if (read_at(fd, &sym, sizeof(sym),
+				symtab.sh_offset + i * sizeof(sym)) < 0) {
+			goto out;
+		}
+		if (sym.st_name + name_len > strtab.sh_size) {
+			continue;
+		}
+		if (read_at(fd, sym_name, name_len, strtab.sh_offset + sym.st_name) < 0) {
+			goto out;
+		}
+		if (memcmp(sym_name, name, name_len) == 0) {
+			*addr = sym.st_value;
+			ret = 0;
+			goto out;
+		}
+	}
+	fprintf(stderr, "%s: symbol %s not found\n", file, name);
+
+out:
+	close(fd);
+	return ret;
+}
+
+int shmem_load_image(const char* file, struct shmem_image* image)
+{
+	struct shmem_section* section;
+	Elf32_Ehdr ehdr;
+	Elf32_Shdr shdr;
+	unsigned int i;
+	int fd;
+
+	image->sections = NULL;
+	image->count = 0;
+
+	fd = open(file, O_RDONLY);
+	if (fd < 0) {
+		perror(file);
+		return -1;
+	}
+
+	if (read_at(fd, &ehdr, sizeof(ehdr), 0) < 0 ||
+			memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0 ||
+			ehdr.e_ident[EI_CLASS] != ELFCLASS32 ||
+			ehdr.e_shentsize != sizeof(Elf32_Shdr)) {
+		fprintf(stderr, "%s: not a 32 bit ELF file\n", file);
+		goto fail;
+	}
+
+	image->sections = calloc(ehdr.e_shnum, sizeof(*image->sections));
+	if (image->sections == NULL) {
+		perror(__FUNCTION__);
+		goto fail;
+	}
+
+	for (i = 0; i < ehdr.e_shnum; i++) {
+		if (read_at(fd, &shdr, sizeof(shdr),
+				ehdr.e_shoff + i * sizeof(shdr)) < 0) {
+			fprintf(stderr, "%s: truncated section headers\n", file);
+			goto fail;
+		}
+		/* Only what is loaded with contents, not .bss and the stacks */
+		if (!(shdr.sh_flags & SHF_ALLOC) || shdr.sh_type != SHT_PROGBITS ||
+				shdr.sh_size == 0) {
+			continue;
+		}
+
+		section = &image->sections[image->count];
+		section->data = malloc(shdr.sh_size + 1);
+		if (section->data == NULL) {
+			perror(__FUNCTION__);
+			goto fail;
+		}
+		image->count++;
+		if (read_at(fd, section->data, shdr.sh_size, shdr.sh_offset) < 0) {
+			fprintf(stderr, "%s: truncated section\n", file);
+			goto fail;
+		}
+		section->data[shdr.sh_size] = '\0';
+		section->addr = shdr.sh_addr;
+		section->len = shdr.sh_size;
+	}
+
+	close(fd);
+	return 0;
+
+fail:
+	shmem_free_image(image);
+	close(fd);
+	return -1;
+}
+
+void shmem_free_image(struct shmem_image* image)
+{
+	unsigned int i;
+
+	for (i = 0; i < image->count; i++) {
+		free(image->sections[i].data);
+	}
+	free(image->sections);
+	image->sections = NULL;
+	image->count = 0;
+}
+
+const void* shmem_image_data(const struct shmem_image* image,
+		unsigned int addr, unsigned int len)
+{
+	const struct shmem_section* section;
+	unsigned int i;
+
+	for (i = 0; i < image->count; i++) {
+		section = &image->sections[i];
+		if (addr - section->addr < section->len &&
+				len <= section->len - (addr - section->addr)) {
+			return section->data + (addr - section->addr);
+		}
+	}
+	return NULL;
+}
+
+const char* shmem_image_string(const struct shmem_image* image,
+		unsigned int addr)
+{
+	return shmem_image_data(image, addr, 1);
+}
+
+int shmem_find_resource(const char* file, const char* name,
+		unsigned int* addr, unsigned int* len)
+{
+	const struct rsc_table_header* table;
+	const struct rsc_devmem* devmem;
+	const unsigned int* offsets = NULL;
+	struct shmem_image image;
+	unsigned int base;
+	unsigned int i;
+	int ret = -1;
+
+	if (shmem_find_symbol(file, SHMEM_RESOURCE_SYMBOL, &base) < 0 ||
+			shmem_load_image(file, &image) < 0) {
+		return -1;
+	}
+
+	table = shmem_image_data(&image, base, sizeof(*table));
+	if (table != NULL) {
+		offsets = shmem_image_data(&image, base + sizeof(*table),
+				table->num * sizeof(*offsets));
+	}
+	if (offsets == NULL) {
+		fprintf(stderr, "%s: no resource table\n", file);
+		goto out;
+	}
+
+	for (i = 0; i < table->num; i++) {
+		devmem = shmem_image_data(&image, base + offsets[i], sizeof(*devmem));
+		if (devmem != NULL && devmem->type == RSC_TYPE_DEVMEM &&
+				strncmp(devmem->name, name, sizeof(devmem->name)) == 0) {
+			*addr = devmem->pa;
+			*len = devmem->len;
+			ret = 0;
+			goto out;
+		}
+	}
+	fprintf(stderr, "%s: no %s entry in the resource table\n", file, name);
+
+out:
+	shmem_free_image(&image);
+	return ret;
+}
+
+int shmem_map(struct shmem_mapping* map, unsigned int addr, size_t len)
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+	off_t offset = addr & ~(page - 1);
+	int fd;
+
+	fd = open("/dev/mem", O_RDWR | O_SYNC);
+	if (fd < 0) {
+		perror("/dev/mem");
+		return -1;
+	}
+
+	map->len = (addr - offset + len + page - 1) & ~(page - 1);
+	map->base = mmap(NULL, map->len, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+			offset);
+	close(fd);
+	if (map->base == MAP_FAILED) {
+		perror(__FUNCTION__);
+		return -1;
+	}
+	map->ptr = (char *)map->base + (addr - offset);
+	return 0;
+}
+
+void shmem_unmap(struct shmem_mapping* map)
+{
+	munmap(map->base, map->len);
+}
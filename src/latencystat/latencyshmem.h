@@ -0,0 +1,67 @@
+#ifndef LATENCYSHMEM_H
+#define LATENCYSHMEM_H
+
+#include <stddef.h>
+
+/* Firmware image loaded by zynq_remoteproc, the shared memory symbols are
+ * looked up in it */
+#define SHMEM_FIRMWARE			"/lib/firmware/freertos"
+
+struct shmem_mapping {
+	/* Page aligned mapping */
+	void* base;
+	size_t len;
+	/* The requested address within it */
+	void* ptr;
+};
+
+/* Look up the address of 'name' in the symbol table of the ELF 'file' */
+int shmem_find_symbol(const char* file, const char* name, unsigned int* addr);
+
+/* One allocated section of the firmware image with its contents */
+struct shmem_section {
+	unsigned int addr;
+	unsigned int len;
+	/* 'len' bytes and a terminating NUL */
+	char* data;
+};
+
+/* Contents of a firmware image, to look up constant data by address */
+struct shmem_image {
+	struct shmem_section* sections;
+	unsigned int count;
+};
+
+/* Load the allocated sections with contents (code, .rodata, .data, ...) of
+ * the ELF 'file' */
+int shmem_load_image(const char* file, struct shmem_image* image);
+void shmem_free_image(struct shmem_image* image);
+
+/* The 'len' bytes at 'addr' in the image, NULL unless they are all in one
+ * section */
+const void* shmem_image_data(const struct shmem_image* image,
+		unsigned int addr, unsigned int len);
+
+/* The string at 'addr' in the image, NULL if 'addr' is not in a section. The
+ * data of a section is NUL terminated, so the string ends at the latest with
+ * the section. */
+const char* shmem_image_string(const struct shmem_image* image,
+		unsigned int addr);
+
+/* Symbol of the resource table in the firmware image */
+#define SHMEM_RESOURCE_SYMBOL	"resources"
+
+/* Look up the TYPE_DEVMEM entry named 'name' in the resource table of the
+ * ELF 'file', usually SHMEM_FIRMWARE. The memory FreeRTOS shares outside of
+ * rpmsg is described there, 'addr' and 'len' are its physical address and
+ * size. */
+int shmem_find_resource(const char* file, const char* name,
+		unsigned int* addr, unsigned int* len);
+
+/* Map 'len' bytes of physical memory at 'addr' uncached through /dev/mem.
+ * The firmware runs from the carveout at its link addresses, so the address
+ * of a firmware symbol is its physical address. */
+int shmem_map(struct shmem_mapping* map, unsigned int addr, size_t len);
+void shmem_unmap(struct shmem_mapping* map);
+
+#endif /* LATENCYSHMEM_H */
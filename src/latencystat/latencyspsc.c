@@ -0,0 +1,137 @@
+/*
+ * Linux side of the bulk channel, see spsc_channel.h.
+ *
+ * The channel is mapped uncached (strongly ordered on ARM), so FreeRTOS
+ * writes straight to memory and no cache maintenance is needed here. Such
+ * mappings do not allow unaligned accesses, which memcpy may use, the data
+ * is copied word by word instead.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "latencyspsc.h"
+
+/* Largest channel accepted, guards against a corrupt header */
+#define SPSC_SIZE_MAX			(16 * 1024 * 1024)
+
+static void spsc_copy(volatile unsigned char* dst,
+		const volatile unsigned char* src, size_t len)
+{
+	/* Whole words where both sides are aligned alike */
+	while (len > 0 && ((uintptr_t)dst & 3) != 0) {
+		*dst++ = *src++;
+		len--;
+	}
+	if (((uintptr_t)src & 3) == 0) {
+		for (; len >= 4; len -= 4, dst += 4, src += 4) {
+			*(volatile uint32_t *)dst = *(const volatile uint32_t *)src;
+		}
+	}
+	while (len > 0) {
+		*dst++ = *src++;
+		len--;
+	}
+}
+
+int spsc_open(struct spsc_target* target, const char* name)
+{
+	struct spsc_channel header;
+	unsigned int addr;
+	unsigned int len;
+
+	if (shmem_find_resource(SHMEM_FIRMWARE, name, &addr, &len) < 0) {
+		return -1;
+	}
+	if (len < sizeof(header)) {
+		fprintf(stderr, "%s: channel of %u bytes too small\n", name, len);
+		return -1;
+	}
+	if (shmem_map(&target->map, addr, sizeof(header)) < 0) {
+		return -1;
+	}
+	spsc_copy((unsigned char *)&header, target->map.ptr, sizeof(header));
+	shmem_unmap(&target->map);
+
+	if (header.magic != SPSC_MAGIC) {
+		fprintf(stderr, "%s: channel not set up by FreeRTOS\n", name);
+		return -1;
+	}
+	if (header.size == 0 || header.size > SPSC_SIZE_MAX ||
+			(header.size & (header.size - 1)) != 0 ||
+			header.size > len - sizeof(header)) {
+		fprintf(stderr, "%s: invalid channel size %u\n", name, header.size);
+		return -1;
+	}
+
+	if (shmem_map(&target->map, addr, sizeof(header) + header.size) < 0) {
+		return -1;
+	}
+	target->ch = target->map.ptr;
+	return 0;
+}
+
+void spsc_close(struct spsc_target* target)
+{
+	shmem_unmap(&target->map);
+}
+
+size_t spsc_write(struct spsc_target* target, const void* data, size_t len)
+{
+	struct spsc_channel* ch = target->ch;
+	unsigned int head = ch->head;
+	unsigned int tail = ch->tail;
+	unsigned int offset = head & (ch->size - 1);
+	size_t first;
+
+	__sync_synchronize();
+	if (len > ch->size - (head - tail)) {
+		len = ch->size - (head - tail);
+	}
+
+	first = ch->size - offset;
+	if (first > len) {
+		first = len;
+	}
+	spsc_copy(&ch->data[offset], data, first);
+	spsc_copy(&ch->data[0], (const unsigned char *)data + first, len - first);
+
+	/* The data must be complete before the consumer sees the new head */
+	__sync_synchronize();
+	ch->head = head + len;
+	return len;
+}
+
+size_t spsc_read(struct spsc_target* target, void* data, size_t len)
+{
+	struct spsc_channel* ch = target->ch;
+	unsigned int tail = ch->tail;
+	unsigned int head = ch->head;
+	unsigned int offset = tail & (ch->size - 1);
+	size_t first;
+
+	/* Read the data only after the head that covers it */
+	__sync_synchronize();
+	if (len > head - tail) {
+		len = head - tail;
+	}
+
+	first = ch->size - offset;
+	if (first > len) {
+		first = len;
+	}
+	spsc_copy(data, &ch->data[offset], first);
+	spsc_copy((unsigned char *)data + first, &ch->data[0], len - first);
+
+	/* The data must be read before the producer may overwrite it */
+	__sync_synchronize();
+	ch->tail = tail + len;
+	return len;
+}
+
+void spsc_discard(struct spsc_target* target)
+{
+	target->ch->tail = target->ch->head;
+	__sync_synchronize();
+}
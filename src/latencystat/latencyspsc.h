@@ -0,0 +1,26 @@
+#ifndef LATENCYSPSC_H
+#define LATENCYSPSC_H
+
+#include "spsc_channel.h"
+#include "latencyshmem.h"
+
+struct spsc_target {
+	struct shmem_mapping map;
+	struct spsc_channel* ch;
+};
+
+/* Map the channel described by the TYPE_DEVMEM entry 'name' in the
+ * resource table of the firmware, SPSC_BULK_RESOURCE_NAME for the bulk
+ * channel */
+int spsc_open(struct spsc_target* target, const char* name);
+void spsc_close(struct spsc_target* target);
+
+/* Copy up to 'len' bytes into or out of the channel, return the number of
+ * bytes copied */
+size_t spsc_write(struct spsc_target* target, const void* data, size_t len);
+size_t spsc_read(struct spsc_target* target, void* data, size_t len);
+
+/* Drop everything in the channel, as the consumer */
+void spsc_discard(struct spsc_target* target);
+
+#endif /* LATENCYSPSC_H */
@@ -1,18 +1,31 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "latencydemo.h"
+#include "log_category.h"
 #include "latencygraph.h"
 #include "latencyrpmsg.h"
+#include "latencybench.h"
+#include "latencytop.h"
+#include "latencymailbox.h"
+#include "latencytrace.h"
+#include "latencybinlog.h"
+#include "latencyevents.h"
+#include "latencytimeline.h"
+#include "latencyclock.h"
+#include "latencycounters.h"
 
 void print_graph_formatted(struct histogram* hist);
+int print_rpc_stats(struct rpmsg_target* target);
+int upload_file(struct rpmsg_target* target, const char* path);
+int configure_logging(struct rpmsg_target* target, const char* spec);
+int print_time_sync(struct rpmsg_target* target);
 
-/* Clock frequency and time macros */
-#define CLK_FREQ			111111115UL
-#define CLK_SCALAR			1UL
-#define CLK_FREQ_CURRENT	((unsigned long long)CLK_FREQ / CLK_SCALAR)
-#define CLK_TIME_NSEC(x)	(((unsigned long long)x)*1000*1000*1000 / (CLK_FREQ_CURRENT))
-#define CLK_TIME_USEC(x)	(((unsigned long long)x)*1000*1000 / (CLK_FREQ_CURRENT))
+/* Frequency of the TTC the latency samples are counted with, reported by
+ * FreeRTOS in the response to TIME */
+static unsigned int sample_freq;
+#define CLK_TIME_NSEC(x)	(((unsigned long long)x)*1000*1000*1000 / sample_freq)
 
 /* Dump the binary data in word groupings, display in hex */
 static void dump_buffer(char *buf, int size)
@@ -31,6 +44,26 @@ static void dump_buffer(char *buf, int size)
 	printf("\n");
 }
 
+/* Send a sampling command, through the mailbox if it is open. A command the
+ * mailbox does not know goes through rpmsg. */
+static int send_command(struct rpmsg_target* target,
+		struct mailbox_target* mailbox, latency_demo_msg_type command)
+{
+	int status;
+
+	if (mailbox != NULL) {
+		status = mailbox_call(mailbox, command, 0);
+		if (status == MAILBOX_OK) {
+			printf("%4d: Command %d done through the mailbox\n",
+					target->command_no++, command);
+			return 0;
+		} else if (status < 0) {
+			return -1;
+		}
+	}
+	return rpmsg_send_message(target, command);
+}
+
 void print_help(void)
 {
 	printf("latencystat - Zynq FreeRTOS AMP Latency Demo\n");
@@ -39,17 +72,72 @@ void print_help(void)
 	printf("\t        (requires a UTF8 terminal)\n");
 	printf("\t -b     Displays a listing of buckets and values\n");
 	printf("\t -d     Displays a binary data dump\n");
+	printf("\t -s     Displays how long FreeRTOS takes for each request\n");
+	printf("\t -u <file>\n");
+	printf("\t        Uploads a file (up to %u bytes) to FreeRTOS and\n",
+			RPC_UPLOAD_MAX);
+	printf("\t        checks the checksum FreeRTOS computes of it\n");
+	printf("\t -m     Sends start, stop and clear through the control\n");
+	printf("\t        mailbox instead of rpmsg (needs root)\n");
+	printf("\t -t     Follows the FreeRTOS trace buffer, like tail -f\n");
+	printf("\t        (needs root)\n");
+	printf("\t -l     Follows the FreeRTOS binary log, formatted with the\n");
+	printf("\t        strings of %s (needs root)\n", SHMEM_FIRMWARE);
+	printf("\t -e <file>\n");
+	printf("\t        Writes the FreeRTOS kernel events (context switches,\n");
+	printf("\t        blocking, interrupts) to a Chrome/Perfetto JSON trace\n");
+	printf("\t        (needs root)\n");
 	printf("\t -h     Displays this help message\n");
+	printf("\n");
+	printf("\t --top  Displays the FreeRTOS tasks with their CPU load,\n");
+	printf("\t        state and free stack, refreshed every second\n");
+	printf("\t --log <level>[,<mask>]\n");
+	printf("\t        Sets the FreeRTOS log level (error, warning, info,\n");
+	printf("\t        debug or - to keep it) and category mask\n");
+	printf("\t --time Measures the offset of the FreeRTOS time base to\n");
+	printf("\t        CLOCK_MONOTONIC and the one way request latencies\n");
+	printf("\t --timeline <file> [linux trace]\n");
+	printf("\t        Writes the FreeRTOS kernel events and binary log\n");
+	printf("\t        together with an ftrace or perf script text trace\n");
+	printf("\t        taken with the mono clock to one JSON trace on a\n");
+	printf("\t        common time axis (needs root)\n");
+	printf("\t --counters\n");
+	printf("\t        Displays the counters of the FreeRTOS statistics\n");
+	printf("\t        page without sending a message (needs root)\n");
+	printf("\n");
+	printf("\t --bench [device]\n");
+	printf("\t        Runs the rpmsg transport benchmark against the\n");
+	printf("\t        FreeRTOS benchmark service (default %s)\n",
+			BENCH_DEVICE);
+	printf("\t -n <n> Number of messages per benchmark run (default %u)\n",
+			BENCH_COUNT);
 }
 
 int main(int argc, char** argv)
 {
 	struct histogram hist;
+	struct rpc_time time;
 	struct rpmsg_target rpmsg0;
+	struct mailbox_target mailbox;
+	struct mailbox_target* control = NULL;
 
 	unsigned int display_graph = 0;
 	unsigned int display_buckets = 0;
 	unsigned int display_binary = 0;
+	unsigned int display_stats = 0;
+	unsigned int display_top = 0;
+	unsigned int display_time = 0;
+	unsigned int use_mailbox = 0;
+	unsigned int follow_trace = 0;
+	unsigned int follow_binlog = 0;
+	unsigned int display_counters = 0;
+	char* bench_device = NULL;
+	char* upload_path = NULL;
+	char* events_path = NULL;
+	char* timeline_path = NULL;
+	char* timeline_linux = NULL;
+	char* log_spec = NULL;
+	unsigned int bench_count = BENCH_COUNT;
 	int i;
 
 	/* argument parsing */
@@ -62,14 +150,102 @@ int main(int argc, char** argv)
 			display_buckets = 1;
 		} else if (strcmp(argv[i], "-d") == 0) {
 			display_binary = 1;
+		} else if (strcmp(argv[i], "-s") == 0) {
+			display_stats = 1;
+		} else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc) {
+			upload_path = argv[++i];
+		} else if (strcmp(argv[i], "-m") == 0) {
+			use_mailbox = 1;
+		} else if (strcmp(argv[i], "-t") == 0) {
+			follow_trace = 1;
+		} else if (strcmp(argv[i], "-l") == 0) {
+			follow_binlog = 1;
+		} else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+			events_path = argv[++i];
 		} else if (strcmp(argv[i], "-h") == 0) {
 			print_help();
 			return 0;
+		} else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+			log_spec = argv[++i];
+		} else if (strcmp(argv[i], "--timeline") == 0 && i + 1 < argc) {
+			timeline_path = argv[++i];
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				timeline_linux = argv[++i];
+			}
+		} else if (strcmp(argv[i], "--counters") == 0) {
+			display_counters = 1;
+		} else if (strcmp(argv[i], "--time") == 0) {
+			display_time = 1;
+		} else if (strcmp(argv[i], "--top") == 0) {
+			display_top = 1;
+		} else if (strcmp(argv[i], "--bench") == 0) {
+			bench_device = BENCH_DEVICE;
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				bench_device = argv[++i];
+			}
+		} else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			bench_count = strtoul(argv[++i], NULL, 0);
+		}
+	}
+
+	/* The benchmark uses its own channel */
+	if (bench_device != NULL) {
+		return run_bench(bench_device, bench_count) < 0 ? -1 : 0;
+	}
+
+	/* Stream the trace until interrupted, needs no rpmsg */
+	if (follow_trace) {
+		struct trace_target trace;
+
+		if (trace_open(&trace) < 0) {
+			return -1;
 		}
+		trace_follow(&trace, stdout);
+		trace_close(&trace);
+		return -1;
+	}
+	if (follow_binlog) {
+		struct binlog_target binlog;
+
+		if (binlog_open(&binlog, SHMEM_FIRMWARE) < 0) {
+			return -1;
+		}
+		binlog_follow(&binlog, stdout);
+		binlog_close(&binlog);
+		return -1;
+	}
+	if (display_counters) {
+		return counters_print(stdout) < 0 ? -1 : 0;
+	}
+	if (events_path != NULL) {
+		FILE* out = fopen(events_path, "w");
+		int ret;
+
+		if (out == NULL) {
+			perror(events_path);
+			return -1;
+		}
+		ret = events_export(out);
+		fclose(out);
+		return ret < 0 ? -1 : 0;
+	}
+	if (timeline_path != NULL) {
+		FILE* out = fopen(timeline_path, "w");
+		int ret;
+
+		if (out == NULL) {
+			perror(timeline_path);
+			return -1;
+		}
+		ret = timeline_export(timeline_linux, out);
+		fclose(out);
+		return ret < 0 ? -1 : 0;
 	}
 
 	/* Check if anything to display */
-	if (display_binary == 0 && display_buckets == 0 && display_graph == 0) {
+	if (display_binary == 0 && display_buckets == 0 && display_graph == 0 &&
+			display_stats == 0 && display_top == 0 && display_time == 0 &&
+			upload_path == NULL && log_spec == NULL) {
 		print_help();
 		return 0;
 	}
@@ -79,17 +255,63 @@ int main(int argc, char** argv)
 		return -1;
 	}
 
+	if (upload_path != NULL && upload_file(&rpmsg0, upload_path) < 0) {
+		rpmsg_close_device(&rpmsg0);
+		return -1;
+	}
+
+	if (log_spec != NULL && configure_logging(&rpmsg0, log_spec) < 0) {
+		rpmsg_close_device(&rpmsg0);
+		return -1;
+	}
+
+	if (display_time && print_time_sync(&rpmsg0) < 0) {
+		rpmsg_close_device(&rpmsg0);
+		return -1;
+	}
+
+	if (display_top) {
+		run_top(&rpmsg0);
+		rpmsg_close_device(&rpmsg0);
+		return -1;
+	}
+
+	/* Only the request statistics, no sampling */
+	if (display_binary == 0 && display_buckets == 0 && display_graph == 0) {
+		if (display_stats) {
+			print_rpc_stats(&rpmsg0);
+		}
+		rpmsg_close_device(&rpmsg0);
+		return 0;
+	}
+
 	printf("Linux FreeRTOS AMP Demo.\n");
 
+	/* Clock of the samples */
+	if (rpmsg_send_message(&rpmsg0, TIME) < 0 ||
+			rpmsg_read_response(&rpmsg0, (char *)&time, sizeof(time)) < 0) {
+		rpmsg_close_device(&rpmsg0);
+		return -1;
+	}
+	sample_freq = time.sample_freq;
+
+	if (use_mailbox) {
+		if (mailbox_open(&mailbox) < 0) {
+			printf("Control mailbox not available, using rpmsg\n");
+		} else {
+			control = &mailbox;
+		}
+	}
+
 	/* Clear the FreeRTOS state */
-	rpmsg_send_message(&rpmsg0, CLEAR); /* Clear statistic buffer */
-	rpmsg_send_message(&rpmsg0, START); /* Start statistic task */
+	send_command(&rpmsg0, control, CLEAR); /* Clear statistic buffer */
+	send_command(&rpmsg0, control, START); /* Start statistic task */
 
 	printf("Waiting for samples...\n");
 	sleep(10); /* wait a bit */
 
 	/* No more samples, stop the FreeRTOS task */
-	rpmsg_send_message(&rpmsg0, STOP);
+	send_command(&rpmsg0, control, STOP);
 
 	/* Copy the data across */
 	rpmsg_send_message(&rpmsg0, CLONE); /* Create snapshot */
@@ -132,7 +354,15 @@ int main(int argc, char** argv)
 	printf("\ttotal samples: %llu\n", hist.sample_count);
 	printf("-----------------------------------------------------------\n");
 
+	/* Display the request statistics */
+	if (display_stats) {
+		print_rpc_stats(&rpmsg0);
+	}
+
 	/* All done, close and clean up */
+	if (control != NULL) {
+		mailbox_close(control);
+	}
 	rpmsg_close_device(&rpmsg0);
 	return 0;
 }
@@ -179,4 +409,233 @@ void print_graph_formatted(struct histogram* hist)
 	}
 
 	print_graph(&data);
-}
\ No newline at end of file
+}
+
+/*
+ * Fetch and print the call counts and service times of the FreeRTOS requests
+ */
+int print_rpc_stats(struct rpmsg_target* target)
+{
+	static const char* names[RPC_OPCODES_MAX] = {
+		[CLEAR] = "CLEAR", [START] = "START", [STOP] = "STOP",
+		[CLONE] = "CLONE", [GET] = "GET", [QUIT] = "QUIT", [STATS] = "STATS",
+		[CHECKSUM] = "CHECKSUM", [TASKS] = "TASKS", [LOGGING] = "LOGGING",
+		[TIME] = "TIME",
+	};
+	struct rpc_stats stats;
+	struct rpc_opcode_stats* op;
+	double tick_us;
+	int i;
+	int j;
+
+	if (rpmsg_send_message(target, STATS) < 0 ||
+			rpmsg_read_response(target, (char *)&stats, sizeof(stats)) < 0) {
+		return -1;
+	}
+	tick_us = 1e6 / stats.timestamp_freq;
+
+	printf("-----------------------------------------------------------\n");
+	printf("Request Statistics (service times in us):\n");
+	printf("\t%-8s %8s %10s %10s %10s %12s\n", "request", "calls", "min",
+			"avg", "max", "total");
+	for (i = 0; i < RPC_OPCODES_MAX; i++) {
+		op = &stats.opcode[i];
+		if (op->calls == 0) {
+			continue;
+		}
+		printf("\t%-8s %8u %10.2f %10.2f %10.2f %12.2f\n",
+				names[i] ? names[i] : "?", op->calls, op->min * tick_us,
+				op->total * tick_us / op->calls, op->max * tick_us,
+				op->total * tick_us);
+	}
+	printf("\trejected requests: %u\n", stats.rejected);
+
+	printf("Service Time Histograms:\n");
+	for (i = 0; i < RPC_OPCODES_MAX; i++) {
+		op = &stats.opcode[i];
+		if (op->calls == 0) {
+			continue;
+		}
+		printf("\t%s:\n", names[i] ? names[i] : "?");
+		for (j = 0; j < RPC_HISTOGRAM_SIZE; j++) {
+			if (op->data[j] == 0) {
+				continue;
+			}
+			if (j == RPC_HISTOGRAM_SIZE - 1) {
+				printf("\t\t>= %9.2f us: %u\n",
+						(1U << (j - 1 + RPC_HISTOGRAM_SHIFT)) * tick_us,
+						op->data[j]);
+			} else {
+				printf("\t\t< %10.2f us: %u\n",
+						(1U << (j + RPC_HISTOGRAM_SHIFT)) * tick_us,
+						op->data[j]);
+			}
+		}
+	}
+	printf("-----------------------------------------------------------\n");
+	return 0;
+}
+
+/*
+ * Set the FreeRTOS log level and mask from "<level>[,<mask>]" and print the
+ * settings now in effect. A level of "-" leaves it as it is.
+ */
+int configure_logging(struct rpmsg_target* target, const char* spec)
+{
+	static const char* levels[LOG_LEVELS] = {
+		[LOG_ERROR] = "error", [LOG_WARNING] = "warning",
+		[LOG_INFO] = "info", [LOG_DEBUG] = "debug",
+	};
+	struct rpc_log_config config = { LOGGING, LOG_KEEP, LOG_KEEP };
+	struct rpc_log_state state;
+	const char* mask = strchr(spec, ',');
+	size_t len = mask != NULL ? (size_t)(mask - spec) : strlen(spec);
+	char* end;
+	int i;
+
+	for (i = 0; i < LOG_LEVELS; i++) {
+		if (strlen(levels[i]) == len && strncmp(spec, levels[i], len) == 0) {
+			config.level = i;
+		}
+	}
+	if (config.level == LOG_KEEP && !(len == 1 && spec[0] == '-')) {
+		config.level = strtoul(spec, &end, 0);
+		if (end != spec + len || config.level >= LOG_LEVELS) {
+			fprintf(stderr, "Unknown log level '%.*s'\n", (int)len, spec);
+			return -1;
+		}
+	}
+	if (mask != NULL) {
+		config.mask = strtoul(mask + 1, &end, 0);
+		if (*end != '\0' || end == mask + 1) {
+			fprintf(stderr, "Bad log mask '%s'\n", mask + 1);
+			return -1;
+		}
+	}
+
+	if (rpmsg_send_request(target, &config, sizeof(config)) < 0 ||
+			rpmsg_read_response(target, (char *)&state, sizeof(state)) < 0) {
+		return -1;
+	}
+	printf("FreeRTOS log level %s, mask 0x%x, compiled in up to %s\n",
+			state.level < LOG_LEVELS ? levels[state.level] : "?", state.mask,
+			state.max_level < LOG_LEVELS ? levels[state.max_level] : "?");
+	return 0;
+}
+
+/*
+ * Map the FreeRTOS time base to CLOCK_MONOTONIC and print how long requests
+ * take to reach FreeRTOS and their ACKs to come back
+ */
+int print_time_sync(struct rpmsg_target* target)
+{
+	struct clock_sync sync;
+	struct clock_sync direct;
+	struct rpc_time time;
+	long long way[2];
+	long long min[2];
+	long long max[2];
+	long long sum[2] = { 0, 0 };
+	int have_direct;
+	int i;
+	int j;
+
+	if (clock_calibrate_rpmsg(&sync, target, &time) < 0) {
+		return -1;
+	}
+	/* Reading the global timer directly does not assume the messages take
+	 * as long each way */
+	have_direct = clock_calibrate(&direct, time.timestamp_freq) == 0;
+
+	/* [0] Linux to FreeRTOS, [1] FreeRTOS to Linux */
+	for (i = 0; i < CLOCK_RPMSG_SAMPLES; i++) {
+		if (rpmsg_send_message(target, TIME) < 0 ||
+				rpmsg_read_response(target, (char *)&time, sizeof(time)) < 0) {
+			return -1;
+		}
+		clock_one_way(have_direct ? &direct : &sync, target, &way[0], &way[1]);
+		for (j = 0; j < 2; j++) {
+			if (i == 0 || way[j] < min[j]) {
+				min[j] = way[j];
+			}
+			if (i == 0 || way[j] > max[j]) {
+				max[j] = way[j];
+			}
+			sum[j] += way[j];
+		}
+	}
+
+	printf("-----------------------------------------------------------\n");
+	printf("Time Base:\n");
+	printf("\tglobal timer: %u Hz, samples: %u Hz\n", time.timestamp_freq,
+			time.sample_freq);
+	printf("\toffset to CLOCK_MONOTONIC through rpmsg: %lld ns "
+			"(+/- %llu ns)\n", sync.offset_ns, sync.window_ns / 2);
+	if (have_direct) {
+		printf("\toffset read through /dev/mem: %lld ns (+/- %llu ns)\n",
+				direct.offset_ns, direct.window_ns / 2);
+	}
+	printf("One Way Request Latency (ns, %s):\n", have_direct ?
+			"global timer read directly" : "assuming equal times each way");
+	printf("\t%-18s %10s %10s %10s\n", "", "min", "avg", "max");
+	printf("\t%-18s %10lld %10lld %10lld\n", "Linux to FreeRTOS", min[0],
+			sum[0] / CLOCK_RPMSG_SAMPLES, max[0]);
+	printf("\t%-18s %10lld %10lld %10lld\n", "FreeRTOS to Linux", min[1],
+			sum[1] / CLOCK_RPMSG_SAMPLES, max[1]);
+	printf("-----------------------------------------------------------\n");
+	return 0;
+}
+
+/*
+ * Upload a file to the FreeRTOS CHECKSUM request and compare its checksum
+ */
+int upload_file(struct rpmsg_target* target, const char* path)
+{
+	static const char* status_names[] = {
+		[RPC_UPLOAD_OK] = "ok", [RPC_UPLOAD_BUSY] = "busy",
+		[RPC_UPLOAD_SEQUENCE] = "chunk sequence broken",
+		[RPC_UPLOAD_SIZE] = "size rejected", [RPC_UPLOAD_TARGET] = "no target",
+	};
+	static unsigned char data[RPC_UPLOAD_MAX + 1];
+	struct rpc_upload_result result;
+	struct upload_checksum checksum;
+	unsigned int hash = 2166136261U;
+	size_t len;
+	size_t i;
+	FILE* file;
+
+	file = fopen(path, "rb");
+	if (file == NULL) {
+		perror(path);
+		return -1;
+	}
+	len = fread(data, 1, sizeof(data), file);
+	fclose(file);
+	if (len > RPC_UPLOAD_MAX) {
+		fprintf(stderr, "%s: larger than %u bytes\n", path, RPC_UPLOAD_MAX);
+		return -1;
+	}
+	for (i = 0; i < len; i++) {
+		hash = (hash ^ data[i]) * 16777619U;
+	}
+
+	if (rpmsg_upload(target, CHECKSUM, data, len, &result) < 0) {
+		return -1;
+	}
+	printf("-----------------------------------------------------------\n");
+	printf("Upload of %s:\n", path);
+	printf("\tstatus: %s\n", result.status < sizeof(status_names) /
+			sizeof(status_names[0]) ? status_names[result.status] : "?");
+	printf("\tbytes received: %u of %zu\n", result.len, len);
+	if (result.status != RPC_UPLOAD_OK) {
+		return -1;
+	}
+
+	if (rpmsg_read_response(target, (char *)&checksum, sizeof(checksum)) < 0) {
+		return -1;
+	}
+	printf("\tchecksum: %08x (%s)\n", checksum.hash,
+			checksum.hash == hash && checksum.len == len ? "match" : "MISMATCH");
+	printf("-----------------------------------------------------------\n");
+	return checksum.hash == hash && checksum.len == len ? 0 : -1;
+}
@@ -0,0 +1,479 @@
+/*
+ * One timeline of FreeRTOS and Linux, to see what Linux did while FreeRTOS
+ * was late.
+ *
+ * The FreeRTOS kernel events and binary log records carry global timer
+ * timestamps. The global timer is mapped to CLOCK_MONOTONIC (latencyclock.c)
+ * and the Linux trace has to be taken with the same clock:
+ *
+ *   echo mono > /sys/kernel/debug/tracing/trace_clock
+ *   perf record -k mono ...
+ *
+ * Linux traces are read as the text ftrace writes to 'trace' and which
+ * 'perf script' prints, one event per line:
+ *
+ *   <comm>-<pid> [<cpu>] <flags> <seconds>: <event>: <args>     (ftrace)
+ *   <comm> <pid> [<cpu>] <seconds>: <event>: <args>             (perf)
+ *
+ * Every Linux CPU gets a track. sched_switch events become slices of the
+ * task running on it (idle is left empty), irq_handler_entry/exit slices of
+ * the interrupt handler; the other events are marked as instants.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "latencyclock.h"
+#include "latencyevents.h"
+#include "latencybinlog.h"
+#include "latencytimeline.h"
+
+/* Tracks of the trace, FreeRTOS uses pid 1 (latencyevents.c) */
+#define TIMELINE_PID_FREERTOS	1
+#define TIMELINE_PID_LINUX		2
+/* Track of the binary log, after the task tracks of FreeRTOS */
+#define TIMELINE_TID_LOG		1000
+
+struct timeline_line {
+	long long time_ns;
+	unsigned int cpu;
+	int pid;
+	char comm[TIMELINE_NAME_MAX];
+	char event[TIMELINE_NAME_MAX];
+	const char* args;
+};
+
+struct timeline_cpu {
+	/* Task running since 'since', 0 while idle, -1 before the first
+	 * switch */
+	int pid;
+	char comm[TIMELINE_NAME_MAX];
+	long long since;
+
+	/* Interrupt handler running since 'irq_since' */
+	int in_irq;
+	char irq[TIMELINE_NAME_MAX];
+	long long irq_since;
+
+	int seen;
+};
+
+struct timeline_state {
+	FILE* out;
+	long long origin_ns;
+	unsigned int written;
+	struct timeline_cpu cpus[TIMELINE_CPUS_MAX];
+};
+
+static double timeline_us(struct timeline_state* st, long long ns)
+{
+	return (double)(ns - st->origin_ns) / 1000.0;
+}
+
+static void timeline_begin(struct timeline_state* st)
+{
+	fprintf(st->out, "%s\n", st->written++ ? "," : "");
+}
+
+/* "<seconds>.<fraction>" at 'p' in ns, returns the end or NULL */
+static char* timeline_parse_time(char* p, long long* ns)
+{
+	unsigned long long scale = 100000000ULL;
+	char* end;
+
+	if (!isdigit((unsigned char)*p)) {
+		return NULL;
+	}
+	*ns = (long long)strtoull(p, &end, 10) * 1000000000LL;
+	if (*end == '.') {
+		for (end++; isdigit((unsigned char)*end); end++) {
+			*ns += (*end - '0') * scale;
+			scale /= 10;
+		}
+	}
+	return end;
+}
+
+static void timeline_copy(char* dst, const char* src, size_t len)
+{
+	if (len >= TIMELINE_NAME_MAX) {
+		len = TIMELINE_NAME_MAX - 1;
+	}
+	memcpy(dst, src, len);
+	dst[len] = '\0';
+}
+
+/* Split "<comm>-<pid>" (ftrace) or "<comm> <pid>" (perf), 'task' ends at
+ * 'end' */
+static void timeline_parse_task(const char* task, const char* end,
+		struct timeline_line* ev)
+{
+	const char* pid;
+
+	task += strspn(task, " ");
+	while (end > task && end[-1] == ' ') {
+		end--;
+	}
+	for (pid = end; pid > task && isdigit((unsigned char)pid[-1]); pid--) {
+	}
+	if (pid == end || pid == task || (pid[-1] != '-' && pid[-1] != ' ')) {
+		timeline_copy(ev->comm, task, end - task);
+		ev->pid = -1;
+		return;
+	}
+	ev->pid = atoi(pid);
+	for (end = pid - 1; end > task && end[-1] == ' '; end--) {
+	}
+	timeline_copy(ev->comm, task, end - task);
+}
+
+/* Parse one line of a Linux trace, returns -1 if it is no event */
+static int timeline_parse(char* line, struct timeline_line* ev)
+{
+	char* open;
+	char* end;
+	char* p;
+	size_t len;
+
+	line[strcspn(line, "\r\n")] = '\0';
+	if (line[strspn(line, " ")] == '#') {
+		return -1;
+	}
+
+	/* "[<cpu>]" follows the task in both formats */
+	for (open = strchr(line, '['); open != NULL; open = strchr(open + 1, '[')) {
+		ev->cpu = strtoul(open + 1, &end, 10);
+		if (end != open + 1 && *end == ']') {
+			break;
+		}
+	}
+	if (open == NULL) {
+		return -1;
+	}
+	timeline_parse_task(line, open, ev);
+
+	/* The first "<seconds>:" after it, ftrace has the flags in between */
+	for (p = end + 1;;) {
+		p += strspn(p, " ");
+		if (*p == '\0') {
+			return -1;
+		}
+		end = timeline_parse_time(p, &ev->time_ns);
+		if (end != NULL && *end == ':') {
+			break;
+		}
+		p += strcspn(p, " ");
+	}
+
+	/* "<event>:", perf writes "<subsystem>:<event>:" */
+	p = end + 1;
+	p += strspn(p, " ");
+	len = strcspn(p, " ");
+	if (len == 0) {
+		return -1;
+	}
+	ev->args = p + len + strspn(p + len, " ");
+	if (p[len - 1] == ':') {
+		len--;
+	}
+	for (end = p + len; end > p && end[-1] != ':'; end--) {
+	}
+	timeline_copy(ev->event, end, p + len - end);
+	return 0;
+}
+
+static void timeline_slice(struct timeline_state* st, const char* name,
+		unsigned int cpu, int pid, long long from, long long to)
+{
+	timeline_begin(st);
+	fprintf(st->out, "{\"name\":");
+	events_json_string(st->out, name);
+	fprintf(st->out, ",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,"
+			"\"ts\":%.3f,\"dur\":%.3f", TIMELINE_PID_LINUX, cpu + 1,
+			timeline_us(st, from), timeline_us(st, to) - timeline_us(st, from));
+	if (pid >= 0) {
+		fprintf(st->out, ",\"args\":{\"pid\":%d}", pid);
+	}
+	fprintf(st->out, "}");
+}
+
+static void timeline_instant(struct timeline_state* st, unsigned int pid,
+		unsigned int tid, const char* name, long long time,
+		const char* detail)
+{
+	timeline_begin(st);
+	fprintf(st->out, "{\"name\":");
+	events_json_string(st->out, name);
+	fprintf(st->out, ",\"ph\":\"i\",\"s\":\"t\",\"pid\":%u,\"tid\":%u,"
+			"\"ts\":%.3f", pid, tid, timeline_us(st, time));
+	if (detail != NULL && *detail != '\0') {
+		fprintf(st->out, ",\"args\":{\"detail\":");
+		events_json_string(st->out, detail);
+		fprintf(st->out, "}");
+	}
+	fprintf(st->out, "}");
+}
+
+static void timeline_name(struct timeline_state* st, const char* kind,
+		unsigned int pid, unsigned int tid, const char* name)
+{
+	timeline_begin(st);
+	fprintf(st->out, "{\"name\":\"%s\",\"ph\":\"M\",\"pid\":%u,", kind, pid);
+	if (tid != 0) {
+		fprintf(st->out, "\"tid\":%u,", tid);
+	}
+	fprintf(st->out, "\"args\":{\"name\":");
+	events_json_string(st->out, name);
+	fprintf(st->out, "}}");
+}
+
+static void timeline_switch(struct timeline_state* st, struct timeline_cpu* cpu,
+		const struct timeline_line* ev)
+{
+	const char* comm = strstr(ev->args, "next_comm=");
+	const char* pid = strstr(ev->args, " next_pid=");
+
+	if (comm == NULL || pid == NULL || pid < comm) {
+		return;
+	}
+	if (cpu->pid > 0) {
+		timeline_slice(st, cpu->comm, ev->cpu, cpu->pid, cpu->since,
+				ev->time_ns);
+	}
+	comm += strlen("next_comm=");
+	timeline_copy(cpu->comm, comm, pid - comm);
+	cpu->pid = atoi(pid + strlen(" next_pid="));
+	cpu->since = ev->time_ns;
+}
+
+static void timeline_linux_event(struct timeline_state* st,
+		const struct timeline_line* ev)
+{
+	struct timeline_cpu* cpu = &st->cpus[ev->cpu];
+	char task[TIMELINE_NAME_MAX + TIMELINE_LINE_MAX];
+
+	cpu->seen = 1;
+	if (strcmp(ev->event, "sched_switch") == 0) {
+		timeline_switch(st, cpu, ev);
+	} else if (strcmp(ev->event, "irq_handler_entry") == 0) {
+		snprintf(cpu->irq, sizeof(cpu->irq), "IRQ %s",
+				strncmp(ev->args, "irq=", 4) == 0 ? ev->args + 4 : ev->args);
+		cpu->in_irq = 1;
+		cpu->irq_since = ev->time_ns;
+	} else if (strcmp(ev->event, "irq_handler_exit") == 0) {
+		/* The trace may start in the middle of a handler */
+		if (cpu->in_irq) {
+			timeline_slice(st, cpu->irq, ev->cpu, -1, cpu->irq_since,
+					ev->time_ns);
+		}
+		cpu->in_irq = 0;
+	} else {
+		snprintf(task, sizeof(task), "%s-%d: %s", ev->comm, ev->pid,
+				ev->args);
+		timeline_instant(st, TIMELINE_PID_LINUX, ev->cpu + 1, ev->event,
+				ev->time_ns, task);
+	}
+}
+
+struct timeline_span {
+	unsigned int count;
+	long long first;
+	long long last;
+};
+
+static void timeline_extend(struct timeline_span* span, long long time)
+{
+	if (span->count == 0 || time < span->first) {
+		span->first = time;
+	}
+	if (span->count == 0 || time > span->last) {
+		span->last = time;
+	}
+	span->count++;
+}
+
+/* Time span of the Linux trace, returns the number of events in it */
+static unsigned int timeline_linux_span(FILE* in, long long* first,
+		long long* last)
+{
+	struct timeline_line ev;
+	char line[TIMELINE_LINE_MAX];
+	unsigned int count = 0;
+
+	while (fgets(line, sizeof(line), in) != NULL) {
+		if (timeline_parse(line, &ev) < 0 || ev.cpu >= TIMELINE_CPUS_MAX) {
+			continue;
+		}
+		if (count == 0 || ev.time_ns < *first) {
+			*first = ev.time_ns;
+		}
+		if (count == 0 || ev.time_ns > *last) {
+			*last = ev.time_ns;
+		}
+		count++;
+	}
+	return count;
+}
+
+static void timeline_linux(struct timeline_state* st, FILE* in, long long last)
+{
+	struct timeline_line ev;
+	char line[TIMELINE_LINE_MAX];
+	char name[16];
+	unsigned int i;
+
+	for (i = 0; i < TIMELINE_CPUS_MAX; i++) {
+		st->cpus[i].pid = -1;
+	}
+	while (fgets(line, sizeof(line), in) != NULL) {
+		if (timeline_parse(line, &ev) == 0 && ev.cpu < TIMELINE_CPUS_MAX) {
+			timeline_linux_event(st, &ev);
+		}
+	}
+
+	timeline_name(st, "process_name", TIMELINE_PID_LINUX, 0, "Linux");
+	for (i = 0; i < TIMELINE_CPUS_MAX; i++) {
+		/* The task still running at the end of the trace */
+		if (st->cpus[i].pid > 0) {
+			timeline_slice(st, st->cpus[i].comm, i, st->cpus[i].pid,
+					st->cpus[i].since, last);
+		}
+		if (st->cpus[i].seen) {
+			snprintf(name, sizeof(name), "CPU %u", i);
+			timeline_name(st, "thread_name", TIMELINE_PID_LINUX, i + 1, name);
+		}
+	}
+}
+
+static void timeline_log(struct timeline_state* st,
+		struct binlog_target* binlog, const struct binlog_record* recs,
+		unsigned int count, const struct clock_sync* sync)
+{
+	char line[BINLOG_LINE_MAX];
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		binlog_format(&binlog->image, &recs[i], line, sizeof(line));
+		line[strcspn(line, "\r\n")] = '\0';
+		timeline_instant(st, TIMELINE_PID_FREERTOS, TIMELINE_TID_LOG, line,
+				clock_to_monotonic(sync, recs[i].time), NULL);
+	}
+	timeline_name(st, "thread_name", TIMELINE_PID_FREERTOS, TIMELINE_TID_LOG,
+			"Log");
+}
+
+/* Read the records now in the binary log into a new array, returns their
+ * number or -1 if there is no binary log */
+static int timeline_read_log(struct binlog_target* binlog,
+		struct binlog_record** recs)
+{
+	unsigned int lost;
+	size_t len;
+
+	if (binlog_open(binlog, SHMEM_FIRMWARE) < 0) {
+		return -1;
+	}
+	*recs = malloc(binlog->trace.ring->size);
+	if (*recs == NULL) {
+		perror(__FUNCTION__);
+		binlog_close(binlog);
+		return -1;
+	}
+	len = trace_read(&binlog->trace, *recs, binlog->trace.ring->size, &lost);
+	return len / sizeof(**recs);
+}
+
+int timeline_export(const char* linux_trace, FILE* out)
+{
+	struct timeline_state st;
+	struct clock_sync sync;
+	struct trace_event* events;
+	struct binlog_target binlog;
+	struct binlog_record* recs = NULL;
+	FILE* in = NULL;
+	struct timeline_span span = { 0, 0, 0 };
+	long long linux_first = 0;
+	long long linux_last = 0;
+	unsigned int linux_count = 0;
+	unsigned int freq;
+	int log_count;
+	int count;
+	int i;
+
+	count = events_read(&events, &freq);
+	if (count < 0) {
+		return -1;
+	}
+	if (clock_calibrate(&sync, freq) < 0) {
+		free(events);
+		return -1;
+	}
+	fprintf(stderr, "global timer at CLOCK_MONOTONIC %+lld ns (+/- %llu ns)\n",
+			sync.offset_ns, sync.window_ns / 2);
+
+	log_count = timeline_read_log(&binlog, &recs);
+	if (log_count < 0) {
+		fprintf(stderr, "no binary log, only kernel events\n");
+	}
+
+	if (linux_trace != NULL) {
+		in = fopen(linux_trace, "r");
+		if (in == NULL) {
+			perror(linux_trace);
+			goto out;
+		}
+		linux_count = timeline_linux_span(in, &linux_first, &linux_last);
+		fprintf(stderr, "%u Linux events\n", linux_count);
+		rewind(in);
+	}
+
+	/* Time span of the FreeRTOS side */
+	for (i = 0; i < count; i++) {
+		if (events[i].type != TRACE_EVENT_TASK_NAME) {
+			timeline_extend(&span, clock_to_monotonic(&sync, events[i].time));
+		}
+	}
+	if (log_count > 0) {
+		timeline_extend(&span, clock_to_monotonic(&sync, recs[0].time));
+		timeline_extend(&span,
+				clock_to_monotonic(&sync, recs[log_count - 1].time));
+	}
+	if (linux_count != 0 && span.count != 0 &&
+			(linux_last < span.first || linux_first > span.last)) {
+		fprintf(stderr, "%s does not overlap with the FreeRTOS events, was it "
+				"taken with the mono trace clock?\n", linux_trace);
+	}
+	if (linux_count != 0) {
+		timeline_extend(&span, linux_first);
+		timeline_extend(&span, linux_last);
+	}
+
+	memset(&st, 0, sizeof(st));
+	st.out = out;
+	/* The trace starts with the earliest event of either side */
+	st.origin_ns = span.first;
+
+	fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+	st.written = events_write_entries(events, count, freq,
+			(double)(sync.offset_ns - st.origin_ns) / 1000.0, 0, out);
+	if (log_count > 0) {
+		timeline_log(&st, &binlog, recs, log_count, &sync);
+	}
+	if (in != NULL) {
+		timeline_linux(&st, in, linux_last);
+	}
+	fprintf(out, "\n]}\n");
+
+out:
+	if (in != NULL) {
+		fclose(in);
+	}
+	if (log_count >= 0) {
+		free(recs);
+		binlog_close(&binlog);
+	}
+	free(events);
+	return in != NULL || linux_trace == NULL ? 0 : -1;
+}
@@ -0,0 +1,20 @@
+#ifndef LATENCYTIMELINE_H
+#define LATENCYTIMELINE_H
+
+#include <stdio.h>
+
+/* Linux CPUs given a track, events of others are dropped */
+#define TIMELINE_CPUS_MAX		8
+/* Longest line of a Linux trace kept, longer ones are cut */
+#define TIMELINE_LINE_MAX		512
+/* Longest task or event name kept */
+#define TIMELINE_NAME_MAX		64
+
+/* Write one Chrome/Perfetto JSON trace to 'out' with the FreeRTOS kernel
+ * events, the records of the binary log (if there is one) and the events
+ * of 'linux_trace' on a common time axis. 'linux_trace' is the text output
+ * of ftrace or 'perf script' taken with CLOCK_MONOTONIC timestamps, or NULL
+ * for the FreeRTOS side alone. */
+int timeline_export(const char* linux_trace, FILE* out);
+
+#endif /* LATENCYTIMELINE_H */
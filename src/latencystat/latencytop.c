@@ -0,0 +1,119 @@
+/*
+ * Live task table of FreeRTOS, like top.
+ *
+ * FreeRTOS answers TASKS with a snapshot of its tasks (struct rpc_tasks).
+ * The run time counters only ever grow (modulo 2^32), so the CPU load of a
+ * task is the growth of its counter between two snapshots over the growth
+ * of the total. Tasks are matched by their number, which FreeRTOS does not
+ * reuse. The load of the idle task is the idle time of the CPU.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "latencytop.h"
+
+/* Name of the FreeRTOS idle task */
+#define TOP_IDLE_NAME			"IDLE"
+
+/* Clear the terminal and move to the top left corner */
+#define TOP_CLEAR				"\033[H\033[2J"
+
+static int top_read(struct rpmsg_target* target, struct rpc_tasks* tasks)
+{
+	if (rpmsg_send_message(target, TASKS) < 0 ||
+			rpmsg_read_response(target, (char *)tasks, sizeof(*tasks)) < 0) {
+		return -1;
+	}
+	if (tasks->count > RPC_TASKS_MAX) {
+		tasks->count = RPC_TASKS_MAX;
+	}
+	return 0;
+}
+
+/* Run time of task 'number' at the previous snapshot, or -1 if it is new */
+static long long top_previous(const struct rpc_tasks* prev,
+		unsigned int number)
+{
+	unsigned int i;
+
+	for (i = 0; i < prev->count; i++) {
+		if (prev->task[i].number == number) {
+			return prev->task[i].runtime;
+		}
+	}
+	return -1;
+}
+
+static void top_print(const struct rpc_tasks* tasks,
+		const struct rpc_tasks* prev)
+{
+	const struct rpc_task_info* task;
+	unsigned int elapsed = tasks->total_runtime - prev->total_runtime;
+	double load[RPC_TASKS_MAX];
+	double idle = -1;
+	long long before;
+	unsigned int i;
+
+	for (i = 0; i < tasks->count; i++) {
+		task = &tasks->task[i];
+		before = top_previous(prev, task->number);
+		if (elapsed == 0 || before < 0) {
+			load[i] = -1;
+		} else {
+			load[i] = 100.0 * (unsigned int)(task->runtime - before) / elapsed;
+		}
+		if (strncmp(task->name, TOP_IDLE_NAME, RPC_TASK_NAME_MAX) == 0) {
+			idle = load[i];
+		}
+	}
+
+	printf(TOP_CLEAR);
+	printf("FreeRTOS: %u tasks", tasks->total);
+	if (tasks->runtime_freq == 0) {
+		printf(", no run time stats\n");
+	} else if (idle < 0) {
+		printf(", idle -\n");
+	} else {
+		printf(", CPU %5.1f%% busy, %5.1f%% idle\n", 100.0 - idle, idle);
+	}
+	printf("\n");
+	printf("%4s  %-16s %5s %4s %8s %10s\n",
+			"NUM", "NAME", "STATE", "PRIO", "%CPU", "STACKFREE");
+
+	for (i = 0; i < tasks->count; i++) {
+		task = &tasks->task[i];
+		printf("%4u  %-16.16s %5c %4u ", task->number, task->name,
+				task->state, task->priority);
+		if (load[i] < 0) {
+			printf("%8s", "-");
+		} else {
+			printf("%7.1f%%", load[i]);
+		}
+		printf(" %10u\n", task->stack_free);
+	}
+	if (tasks->total > tasks->count) {
+		printf("(%u more not shown)\n", tasks->total - tasks->count);
+	}
+	fflush(stdout);
+}
+
+int run_top(struct rpmsg_target* target)
+{
+	struct rpc_tasks tasks;
+	struct rpc_tasks prev;
+
+	if (top_read(target, &prev) < 0) {
+		return -1;
+	}
+	while (1) {
+		usleep(TOP_INTERVAL_MS * 1000);
+		if (top_read(target, &tasks) < 0) {
+			return -1;
+		}
+		top_print(&tasks, &prev);
+		prev = tasks;
+	}
+	return 0;
+}
@@ -0,0 +1,13 @@
+#ifndef LATENCYTOP_H
+#define LATENCYTOP_H
+
+#include "latencyrpmsg.h"
+
+/* Refresh interval of the task table, in ms */
+#define TOP_INTERVAL_MS			1000
+
+/* Display the FreeRTOS tasks with their CPU load like top, refreshed every
+ * TOP_INTERVAL_MS until interrupted. Returns -1 if a request fails. */
+int run_top(struct rpmsg_target* target);
+
+#endif /* LATENCYTOP_H */
@@ -0,0 +1,145 @@
+/*
+ * Linux side of the trace buffer header, see trace_ring.h.
+ *
+ * The header and the text are mapped uncached through /dev/mem like the bulk
+ * channel, the text is copied byte by byte. FreeRTOS never waits for the
+ * reader, so the text read may be overwritten while it is copied: the head
+ * is read again afterwards and whatever it has passed over is dropped.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "latencytrace.h"
+
+static void trace_copy(unsigned char* dst, const volatile unsigned char* src,
+		size_t len)
+{
+	while (len-- > 0) {
+		*dst++ = *src++;
+	}
+}
+
+int trace_open(struct trace_target* target)
+{
+	return trace_open_symbol(target, TRACE_RING_SYMBOL);
+}
+
+int trace_open_symbol(struct trace_target* target, const char* symbol)
+{
+	struct trace_ring* ring;
+	unsigned int addr;
+	unsigned int head;
+
+	if (shmem_find_symbol(SHMEM_FIRMWARE, symbol, &addr) < 0 ||
+			shmem_map(&target->header, addr, sizeof(struct trace_ring)) < 0) {
+		return -1;
+	}
+	ring = target->header.ptr;
+
+	if (ring->magic != TRACE_RING_MAGIC) {
+		fprintf(stderr, "%s: trace buffer header not set up by FreeRTOS\n",
+				symbol);
+		shmem_unmap(&target->header);
+		return -1;
+	}
+	if (ring->size == 0 || ring->size > TRACE_SIZE_MAX ||
+			(ring->size & (ring->size - 1)) != 0) {
+		fprintf(stderr, "%s: invalid trace buffer size %u\n",
+				symbol, ring->size);
+		shmem_unmap(&target->header);
+		return -1;
+	}
+	if (shmem_map(&target->text, ring->buffer, ring->size) < 0) {
+		shmem_unmap(&target->header);
+		return -1;
+	}
+	target->ring = ring;
+
+	/* Start at the oldest text still there */
+	head = ring->head;
+	target->tail = ring->wraps == 0 && head < ring->size ? 0 :
+			head - ring->size;
+	ring->tail = target->tail;
+	return 0;
+}
+
+void trace_close(struct trace_target* target)
+{
+	shmem_unmap(&target->text);
+	shmem_unmap(&target->header);
+}
+
+size_t trace_read(struct trace_target* target, void* data, size_t len,
+		unsigned int* lost)
+{
+	struct trace_ring* ring = target->ring;
+	const volatile unsigned char* text = target->text.ptr;
+	unsigned int size = ring->size;
+	unsigned int head = ring->head;
+	unsigned int tail = target->tail;
+	unsigned int offset;
+	unsigned int skip;
+	size_t first;
+
+	*lost = 0;
+	/* Read the text only after the head that covers it */
+	__sync_synchronize();
+	if (head - tail > size) {
+		*lost = head - tail - size;
+		tail = head - size;
+	}
+	if (len > head - tail) {
+		len = head - tail;
+	}
+
+	offset = tail & (size - 1);
+	first = size - offset;
+	if (first > len) {
+		first = len;
+	}
+	trace_copy(data, &text[offset], first);
+	trace_copy((unsigned char *)data + first, &text[0], len - first);
+
+	/* Drop what FreeRTOS has overwritten while it was copied */
+	__sync_synchronize();
+	head = ring->head;
+	if (head - tail > size) {
+		skip = head - tail - size;
+		if (skip > len) {
+			skip = len;
+		}
+		memmove(data, (unsigned char *)data + skip, len - skip);
+		*lost += skip;
+		tail += skip;
+		len -= skip;
+	}
+
+	target->tail = tail + len;
+	ring->tail = target->tail;
+	return len;
+}
+
+int trace_follow(struct trace_target* target, FILE* out)
+{
+	char buf[4096];
+	unsigned int lost;
+	size_t len;
+
+	for (;;) {
+		len = trace_read(target, buf, sizeof(buf), &lost);
+		if (lost != 0) {
+			fprintf(out, "\n[trace: %u bytes lost]\n", lost);
+		}
+		if (len == 0) {
+			fflush(out);
+			usleep(TRACE_POLL_US);
+			continue;
+		}
+		if (fwrite(buf, 1, len, out) != len) {
+			perror(__FUNCTION__);
+			return -1;
+		}
+	}
+}
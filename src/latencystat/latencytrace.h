@@ -0,0 +1,43 @@
+#ifndef LATENCYTRACE_H
+#define LATENCYTRACE_H
+
+#include <stdio.h>
+
+#include "trace_ring.h"
+#include "latencyshmem.h"
+
+/* Symbol of the trace buffer header in the firmware image */
+#define TRACE_RING_SYMBOL		"__trace_ring_start"
+
+/* Time between two looks at the trace buffer when following it */
+#define TRACE_POLL_US			20000
+
+/* Largest trace buffer accepted, guards against a corrupt header */
+#define TRACE_SIZE_MAX			(16 * 1024 * 1024)
+
+struct trace_target {
+	struct shmem_mapping header;
+	struct shmem_mapping text;
+	struct trace_ring* ring;
+	/* Bytes read so far, mirrored to ring->tail */
+	unsigned int tail;
+};
+
+/* Map the trace buffer and its header. Reading starts at the oldest text
+ * still in the buffer. */
+int trace_open(struct trace_target* target);
+
+/* Same for the buffer whose header is at 'symbol', e.g. the binary log */
+int trace_open_symbol(struct trace_target* target, const char* symbol);
+void trace_close(struct trace_target* target);
+
+/* Copy up to 'len' bytes of new text to 'data', returns the number copied.
+ * 'lost' is set to the number of bytes overwritten by FreeRTOS before they
+ * could be read. */
+size_t trace_read(struct trace_target* target, void* data, size_t len,
+		unsigned int* lost);
+
+/* Write new text to 'out' as it arrives, until an error occurs */
+int trace_follow(struct trace_target* target, FILE* out);
+
+#endif /* LATENCYTRACE_H */
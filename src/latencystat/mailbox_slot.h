@@ -0,0 +1,57 @@
+/*
+ * Layout of the control mailbox in memory shared between FreeRTOS and Linux.
+ * This header is common for the FreeRTOS application and the latencystat
+ * application, keep both copies the same.
+ *
+ * The mailbox carries one short command at a time without rpmsg. Linux
+ * writes the command and its argument, then increments 'seq' and raises the
+ * doorbell SGI on the FreeRTOS CPU. FreeRTOS runs the command in the
+ * interrupt handler and copies 'seq' to 'done' once it is through. Linux
+ * waits for 'done' before sending the next command, so there is only ever
+ * one command in the mailbox.
+ *
+ * The request and the response are each alone in a cache line so the two
+ * sides never write to the same line.
+ */
+
+#ifndef MAILBOX_SLOT_H
+#define MAILBOX_SLOT_H
+
+/* "MBOX", written last when the mailbox is set up */
+#define MAILBOX_MAGIC			0x584f424d
+
+/* Cache line size of the Cortex-A9 L1 and of the PL310 */
+#define MAILBOX_CACHE_LINE		32
+
+/* Commands are the opcodes of latencydemo.h which have a mailbox handler,
+ * and PING, which does nothing */
+#define MAILBOX_COMMANDS		16
+#define MAILBOX_PING			0xff
+
+typedef enum {
+	MAILBOX_OK = 0,
+	/* The command has no mailbox handler */
+	MAILBOX_UNKNOWN,
+} mailbox_status;
+
+struct mailbox_slot
+{
+	/* Set up once by FreeRTOS */
+	unsigned int magic;
+	/* SGI Linux raises on the FreeRTOS CPU after writing a command */
+	unsigned int doorbell;
+	unsigned int reserved[MAILBOX_CACHE_LINE / 4 - 2];
+
+	/* Written by Linux only */
+	volatile unsigned int seq;
+	volatile unsigned int command;
+	volatile unsigned int arg;
+	unsigned int request_pad[MAILBOX_CACHE_LINE / 4 - 3];
+
+	/* Written by FreeRTOS only */
+	volatile unsigned int done;
+	volatile unsigned int status;
+	unsigned int response_pad[MAILBOX_CACHE_LINE / 4 - 2];
+};
+
+#endif /* MAILBOX_SLOT_H */
@@ -0,0 +1,51 @@
+/*
+ * Layout of a single-producer/single-consumer byte channel in memory shared
+ * between FreeRTOS and Linux. This header is common for the FreeRTOS
+ * application and the latencystat application, keep both copies the same.
+ *
+ * head and tail are free running byte counters, the data area is a power of
+ * two in size. Only the producer writes head, only the consumer writes tail.
+ * Each of them is alone in its cache line so the two sides never write to
+ * the same line.
+ *
+ * Producer: write the data, barrier, advance head.
+ * Consumer: read head, barrier, read the data, barrier, advance tail.
+ */
+
+#ifndef SPSC_CHANNEL_H
+#define SPSC_CHANNEL_H
+
+/* "SPSC", written last when the channel is set up */
+#define SPSC_MAGIC				0x43535053
+
+/* Cache line size of the Cortex-A9 L1 and of the PL310 */
+#define SPSC_CACHE_LINE			32
+
+/* Name of the resource table entry of the bulk channel */
+#define SPSC_BULK_RESOURCE_NAME	"bulk"
+
+/* No doorbell interrupt */
+#define SPSC_NO_DOORBELL		0xffffffff
+
+struct spsc_channel
+{
+	/* Set up once by FreeRTOS */
+	unsigned int magic;
+	/* Size of the data area in bytes */
+	unsigned int size;
+	/* SGI the producer raises when data arrives in an empty channel */
+	unsigned int doorbell;
+	unsigned int reserved[SPSC_CACHE_LINE / 4 - 3];
+
+	/* Written by the producer only */
+	volatile unsigned int head;
+	unsigned int head_pad[SPSC_CACHE_LINE / 4 - 1];
+
+	/* Written by the consumer only */
+	volatile unsigned int tail;
+	unsigned int tail_pad[SPSC_CACHE_LINE / 4 - 1];
+
+	unsigned char data[];
+};
+
+#endif /* SPSC_CHANNEL_H */
@@ -0,0 +1,71 @@
+/*
+ * Layout of the statistics page in memory shared between FreeRTOS and Linux.
+ * This header is common for the FreeRTOS application and the latencystat
+ * application, keep both copies the same.
+ *
+ * The page holds named 64-bit counters and gauges which FreeRTOS keeps up to
+ * date as it runs, Linux reads them without sending a message. The page is
+ * described by a TYPE_DEVMEM entry named STATS_RESOURCE_NAME in the resource
+ * table of the firmware.
+ *
+ * The writers are tasks and interrupt handlers, which do not lock each other
+ * out. Every update increments 'begin' before it touches a value and 'end'
+ * once it is done, so begin == end when no update is in progress. Like a
+ * seqlock which allows several writers, a reader takes a snapshot by
+ *
+ *   read end, barrier, copy the values, barrier, read begin
+ *
+ * and retries unless both are equal: no update was in progress when it
+ * started and none has started since.
+ */
+
+#ifndef STATS_PAGE_H
+#define STATS_PAGE_H
+
+/* "STAT", written last when the page is set up */
+#define STATS_MAGIC				0x54415453
+
+/* Cache line size of the Cortex-A9 L1 and of the PL310 */
+#define STATS_CACHE_LINE		32
+
+/* Size of the page, the header line followed by the entries */
+#define STATS_PAGE_SIZE			0x1000
+#define STATS_ENTRIES_MAX		((STATS_PAGE_SIZE / STATS_CACHE_LINE) - 1)
+
+/* Name of the resource table entry */
+#define STATS_RESOURCE_NAME		"stats"
+
+/* Longest name of an entry, including the terminating NUL */
+#define STATS_NAME_MAX			20
+
+typedef enum {
+	/* Counts events since FreeRTOS started */
+	STATS_COUNTER = 0,
+	/* Current value of something that goes up and down */
+	STATS_GAUGE,
+} stats_kind;
+
+/* One entry, a cache line */
+struct stats_entry
+{
+	char name[STATS_NAME_MAX];
+	unsigned int kind;
+	volatile unsigned long long value;
+};
+
+struct stats_page
+{
+	/* Set up once by FreeRTOS */
+	unsigned int magic;
+	unsigned int size;
+	/* Entries in use, they are only added */
+	volatile unsigned int count;
+	/* Updates started and finished */
+	volatile unsigned int begin;
+	volatile unsigned int end;
+	unsigned int reserved[STATS_CACHE_LINE / 4 - 5];
+
+	struct stats_entry entries[STATS_ENTRIES_MAX];
+};
+
+#endif /* STATS_PAGE_H */
@@ -0,0 +1,64 @@
+/*
+ * Host shim of the FreeRTOS kernel API used by the firmware, implemented on
+ * top of POSIX threads in sim_freertos.c. Only the subset used by the AMP
+ * firmware is provided.
+ */
+
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "xil_types.h"
+
+#define portCHAR		char
+#define portLONG		long
+#define portSHORT		short
+#define portSTACK_TYPE	unsigned portLONG
+#define portBASE_TYPE	portLONG
+
+typedef unsigned portLONG portTickType;
+#define portMAX_DELAY	( portTickType ) 0xffffffff
+
+#define configTICK_RATE_HZ			( ( portTickType ) 1000 )
+#define configMAX_PRIORITIES		( ( unsigned portBASE_TYPE ) 4 )
+#define configMINIMAL_STACK_SIZE	( ( unsigned short ) 120 )
+#define configMAX_TASK_NAME_LEN		8
+
+#define portTICK_RATE_MS			( ( portTickType ) 1000 / configTICK_RATE_HZ )
+#define portBYTE_ALIGNMENT			8
+
+#define pdTRUE		( 1 )
+#define pdFALSE		( 0 )
+#define pdPASS		( 1 )
+#define pdFAIL		( 0 )
+
+#define tskIDLE_PRIORITY			( ( unsigned portBASE_TYPE ) 0U )
+
+/* Interrupts are emulated by a thread, a critical section holds the lock
+ * that thread takes around each handler */
+extern void vPortEnterCritical( void );
+extern void vPortExitCritical( void );
+#define portENTER_CRITICAL()		vPortEnterCritical();
+#define portEXIT_CRITICAL()			vPortExitCritical();
+#define portDISABLE_INTERRUPTS()	vPortEnterCritical()
+#define portENABLE_INTERRUPTS()		vPortExitCritical()
+#define taskDISABLE_INTERRUPTS()	portDISABLE_INTERRUPTS()
+#define portYIELD_FROM_ISR()
+#define portNOP()
+
+/* New added functions for AMP (portmacro.h) */
+extern void stdio_lock_init(unsigned int base, unsigned int len);
+extern void stdio_ring_init(unsigned int ring);
+void xputs(char *str);
+extern void port_trace_init(unsigned int base, unsigned int len);
+extern void trace_flush_range(volatile void *start, int len);
+void safe_printf(const char *format, ...);
+extern void setupIRQhandler(int int_no, void *fce, void *param);
+extern void register_handler(void *handler_priv);
+extern void swirq_to_linux(int irq, int cpu);
+extern void clearIRQhandler(int int_no);
+
+#endif /* INC_FREERTOS_H */
@@ -0,0 +1,49 @@
+/* Host shim of the FreeRTOS queue API, see FreeRTOS.h */
+
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include "FreeRTOS.h"
+
+typedef void * xQueueHandle;
+
+xQueueHandle xQueueCreate( unsigned portBASE_TYPE uxQueueLength,
+		unsigned portBASE_TYPE uxItemSize );
+void vQueueDelete( xQueueHandle pxQueue );
+signed portBASE_TYPE xQueueGenericSend( xQueueHandle pxQueue,
+		const void * const pvItemToQueue, portTickType xTicksToWait,
+		portBASE_TYPE xCopyPosition );
+signed portBASE_TYPE xQueueGenericSendFromISR( xQueueHandle pxQueue,
+		const void * const pvItemToQueue,
+		signed portBASE_TYPE *pxHigherPriorityTaskWoken,
+		portBASE_TYPE xCopyPosition );
+signed portBASE_TYPE xQueueGenericReceive( xQueueHandle pxQueue,
+		void * const pvBuffer, portTickType xTicksToWait,
+		portBASE_TYPE xJustPeeking );
+signed portBASE_TYPE xQueueReceiveFromISR( xQueueHandle pxQueue,
+		void * const pvBuffer,
+		signed portBASE_TYPE *pxHigherPriorityTaskWoken );
+unsigned portBASE_TYPE uxQueueMessagesWaiting( const xQueueHandle pxQueue );
+
+/* Used internally by the semaphores */
+xQueueHandle xQueueCreateCountingSemaphore(
+		unsigned portBASE_TYPE uxCountValue,
+		unsigned portBASE_TYPE uxInitialCount );
+
+#define queueSEND_TO_BACK	( 0 )
+#define queueSEND_TO_FRONT	( 1 )
+
+#define xQueueSend( xQueue, pvItemToQueue, xTicksToWait ) \
+	xQueueGenericSend( xQueue, pvItemToQueue, xTicksToWait, queueSEND_TO_BACK )
+#define xQueueSendToBack( xQueue, pvItemToQueue, xTicksToWait ) \
+	xQueueGenericSend( xQueue, pvItemToQueue, xTicksToWait, queueSEND_TO_BACK )
+#define xQueueSendToFront( xQueue, pvItemToQueue, xTicksToWait ) \
+	xQueueGenericSend( xQueue, pvItemToQueue, xTicksToWait, queueSEND_TO_FRONT )
+#define xQueueSendFromISR( xQueue, pvItemToQueue, pxHigherPriorityTaskWoken ) \
+	xQueueGenericSendFromISR( xQueue, pvItemToQueue, pxHigherPriorityTaskWoken, queueSEND_TO_BACK )
+#define xQueueReceive( xQueue, pvBuffer, xTicksToWait ) \
+	xQueueGenericReceive( xQueue, pvBuffer, xTicksToWait, pdFALSE )
+#define xQueuePeek( xQueue, pvBuffer, xTicksToWait ) \
+	xQueueGenericReceive( xQueue, pvBuffer, xTicksToWait, pdTRUE )
+
+#endif /* QUEUE_H */
@@ -0,0 +1,27 @@
+/* Host shim of the FreeRTOS semaphore API, see FreeRTOS.h */
+
+#ifndef SEMAPHORE_H
+#define SEMAPHORE_H
+
+#include "queue.h"
+
+typedef xQueueHandle xSemaphoreHandle;
+
+#define vSemaphoreCreateBinary( xSemaphore ) \
+	( xSemaphore ) = xQueueCreateCountingSemaphore( 1, 1 )
+#define xSemaphoreCreateCounting( uxMaxCount, uxInitialCount ) \
+	xQueueCreateCountingSemaphore( ( uxMaxCount ), ( uxInitialCount ) )
+#define xSemaphoreCreateMutex() \
+	xQueueCreateCountingSemaphore( 1, 1 )
+#define xSemaphoreTake( xSemaphore, xBlockTime ) \
+	xQueueGenericReceive( ( xSemaphore ), NULL, ( xBlockTime ), pdFALSE )
+#define xSemaphoreGive( xSemaphore ) \
+	xQueueGenericSend( ( xSemaphore ), NULL, 0, queueSEND_TO_BACK )
+#define xSemaphoreGiveFromISR( xSemaphore, pxHigherPriorityTaskWoken ) \
+	xQueueGenericSendFromISR( ( xSemaphore ), NULL, ( pxHigherPriorityTaskWoken ), queueSEND_TO_BACK )
+#define xSemaphoreTakeFromISR( xSemaphore, pxHigherPriorityTaskWoken ) \
+	xQueueReceiveFromISR( ( xSemaphore ), NULL, ( pxHigherPriorityTaskWoken ) )
+#define vSemaphoreDelete( xSemaphore ) \
+	vQueueDelete( ( xSemaphore ) )
+
+#endif /* SEMAPHORE_H */
@@ -0,0 +1,32 @@
+/* Host shim of the FreeRTOS task API, see FreeRTOS.h */
+
+#ifndef TASK_H
+#define TASK_H
+
+#include "FreeRTOS.h"
+
+typedef void * xTaskHandle;
+typedef void (*pdTASK_CODE)( void * );
+
+signed portBASE_TYPE xTaskCreate( pdTASK_CODE pvTaskCode,
+		const signed char * const pcName, unsigned short usStackDepth,
+		void *pvParameters, unsigned portBASE_TYPE uxPriority,
+		xTaskHandle *pvCreatedTask );
+void vTaskStartScheduler( void );
+void vTaskSuspend( xTaskHandle pxTaskToSuspend );
+void vTaskResume( xTaskHandle pxTaskToResume );
+portBASE_TYPE xTaskResumeFromISR( xTaskHandle pxTaskToResume );
+void vTaskDelay( portTickType xTicksToDelay );
+void vTaskDelayUntil( portTickType * const pxPreviousWakeTime,
+		portTickType xTimeIncrement );
+portTickType xTaskGetTickCount( void );
+portTickType xTaskGetTickCountFromISR( void );
+xTaskHandle xTaskGetCurrentTaskHandle( void );
+
+#define taskYIELD()					sched_yield()
+#define taskENTER_CRITICAL()		portENTER_CRITICAL()
+#define taskEXIT_CRITICAL()			portEXIT_CRITICAL()
+
+int sched_yield( void );
+
+#endif /* TASK_H */
@@ -0,0 +1,8 @@
+/* Host shim of the FreeRTOS timer API, see FreeRTOS.h. Not used yet. */
+
+#ifndef TIMERS_H
+#define TIMERS_H
+
+#include "task.h"
+
+#endif /* TIMERS_H */
@@ -0,0 +1,13 @@
+/* Host shim of the Xilinx standalone BSP cache maintenance, see sim_port.c.
+ * The host is cache coherent, the functions only act as memory barriers. */
+
+#ifndef XIL_CACHE_H
+#define XIL_CACHE_H
+
+#include "xil_types.h"
+
+void Xil_DCacheFlush(void);
+void Xil_DCacheFlushRange(unsigned int adr, unsigned len);
+void Xil_DCacheInvalidateRange(unsigned int adr, unsigned len);
+
+#endif /* XIL_CACHE_H */
@@ -0,0 +1,14 @@
+/* Host shim of the Xilinx standalone BSP cache maintenance, see xil_cache.h */
+
+#ifndef XIL_CACHE_L_H
+#define XIL_CACHE_L_H
+
+#include "xil_types.h"
+
+void Xil_L1DCacheFlush(void);
+void Xil_L1DCacheFlushRange(unsigned int adr, unsigned len);
+void Xil_L1DCacheInvalidateRange(unsigned int adr, unsigned len);
+void Xil_L2CacheFlushRange(unsigned int adr, unsigned len);
+void Xil_L2CacheInvalidateRange(unsigned int adr, unsigned len);
+
+#endif /* XIL_CACHE_L_H */
@@ -0,0 +1,10 @@
+/* Host shim of the Xilinx standalone BSP console output */
+
+#ifndef XIL_PRINTF_H
+#define XIL_PRINTF_H
+
+#include "xil_types.h"
+
+void xil_printf(const char *ctrl1, ...);
+
+#endif /* XIL_PRINTF_H */
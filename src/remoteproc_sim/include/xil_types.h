@@ -0,0 +1,21 @@
+/* Host shim of the Xilinx standalone BSP types */
+
+#ifndef XIL_TYPES_H
+#define XIL_TYPES_H
+
+typedef unsigned char u8;
+typedef unsigned short u16;
+typedef unsigned int u32;
+typedef unsigned long long u64;
+typedef char s8;
+typedef short s16;
+typedef int s32;
+
+#define XST_SUCCESS		0L
+#define XST_FAILURE		1L
+
+#ifndef __packed
+#define __packed		__attribute__((packed))
+#endif
+
+#endif /* XIL_TYPES_H */
@@ -0,0 +1,11 @@
+/* Host shim of the generated Xilinx hardware parameters */
+
+#ifndef XPARAMETERS_H
+#define XPARAMETERS_H
+
+#define XPAR_CPU_CORTEXA9_0_CPU_CLK_FREQ_HZ		666666687
+#define STDOUT_BASEADDRESS						0xE0001000
+#define XPS_SCU_PERIPH_BASE						0xF8F00000
+#define XPS_GLOBAL_TMR_BASEADDR					0xF8F00200
+
+#endif /* XPARAMETERS_H */
@@ -0,0 +1,984 @@
+/*
+ * rpmsgsim - host simulation of the FreeRTOS remoteproc transport
+ *
+ * Runs remoteproc.c with an echo service, the request dispatcher, the
+ * control mailbox, the binary log, the log settings and the time service in
+ * a child process
+ * and a simulated Linux master in the parent. Without arguments it runs a
+ * set of transport checks, with '-b' it measures echo throughput and round
+ * trip times.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <sched.h>
+#include <stdint.h>
+
+#include "xil_types.h"
+#include "remoteproc_kernel.h"
+#include "remoteproc.h"
+#include "latencydemo.h"
+#include "mailbox.h"
+#include "binlog.h"
+#include "logging.h"
+#include "timestamp.h"
+#include "trace_ring.h"
+#include "stats.h"
+
+#include "sim.h"
+
+/* Address the firmware sends the name service announcements to */
+#define SIM_NS_ADDR				0x35
+
+/* Time to wait for a message before giving up */
+#define SIM_RECV_TIMEOUT_MS		2000
+
+/* Attempts at a consistent copy of the statistics page */
+#define SIM_STATS_TRIES			1000
+/* Time to wait for the statistics task to publish the counters */
+#define SIM_STATS_TIMEOUT_MS	(10 * STATS_PUBLISH_MS)
+
+static unsigned int failures = 0;
+
+#define CHECK(cond, ...)												\
+	do {																\
+		if (!(cond)) {													\
+			printf("FAIL: " __VA_ARGS__);								\
+			printf("\n");												\
+			failures++;													\
+			return;														\
+		}																\
+	} while (0)
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void fill_pattern(unsigned char *buf, unsigned int len,
+		unsigned int seed)
+{
+	unsigned int i;
+
+	for (i = 0; i < len; i++) {
+		buf[i] = (unsigned char)(seed * 31 + i * 7);
+	}
+}
+
+/* Send a message with a 'broken' descriptor table, or a proper message for
+ * -1, waiting while the RX vring is full or the indirect area is in use */
+static int send_broken(unsigned int dst, const void *data, unsigned int len,
+		int broken)
+{
+	unsigned long long deadline = now_ns() +
+			SIM_RECV_TIMEOUT_MS * 1000000ULL;
+
+	while (sim_linux_send_broken(SIM_LINUX_ADDR, dst, data, len, broken)) {
+		if (now_ns() > deadline) {
+			return -1;
+		}
+		sched_yield();
+	}
+	return 0;
+}
+
+/* Send, waiting while the RX vring is full */
+static int send_to(unsigned int dst, const void *data, unsigned int len)
+{
+	return send_broken(dst, data, len, -1);
+}
+
+/* Receive an echo of 'len' bytes, which may arrive in several chunks */
+static int recv_echo(unsigned char *buf, unsigned int len)
+{
+	struct sim_msg msg;
+	unsigned int got = 0;
+
+	while (got < len) {
+		if (sim_linux_recv(&msg, SIM_RECV_TIMEOUT_MS)) {
+			return -1;
+		}
+		if (msg.src != SIM_ECHO_ADDR || msg.dst != SIM_LINUX_ADDR ||
+				got + msg.len > len) {
+			return -1;
+		}
+		memcpy(buf + got, msg.data, msg.len);
+		got += msg.len;
+	}
+	return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Checks */
+
+static void check_announcement(unsigned int addr, const char *name)
+{
+	struct rpmsg_channel_info info;
+	struct sim_msg msg;
+
+	CHECK(sim_linux_recv(&msg, SIM_RECV_TIMEOUT_MS) == 0,
+			"no name service announcement");
+	CHECK(msg.dst == SIM_NS_ADDR && msg.src == addr,
+			"announcement from 0x%x to 0x%x", msg.src, msg.dst);
+	CHECK(msg.len == sizeof(info), "announcement of %u bytes", msg.len);
+	memcpy(&info, msg.data, sizeof(info));
+	CHECK(strcmp(info.name, name) == 0 && info.src == addr,
+			"announced '%.32s' at 0x%x", info.name, info.src);
+	printf("PASS: announcement of '%s' at 0x%x\n", info.name, info.src);
+}
+
+static void check_echo(unsigned int len)
+{
+	static unsigned char out[RPMSG_RX_CHAIN_MAX];
+	static unsigned char in[RPMSG_RX_CHAIN_MAX];
+
+	fill_pattern(out, len, len);
+	memset(in, 0, len);
+	CHECK(send_to(SIM_ECHO_ADDR, out, len) == 0, "echo of %u bytes not sent",
+			len);
+	CHECK(recv_echo(in, len) == 0, "echo of %u bytes not received", len);
+	CHECK(memcmp(in, out, len) == 0, "echo of %u bytes corrupted", len);
+	printf("PASS: echo of %u bytes\n", len);
+}
+
+/* Malformed descriptor tables and direct chains are dropped unread, the
+ * next message still gets through and is the first one echoed */
+static void check_broken_table(int broken)
+{
+	static const char *names[] = {
+		[SIM_BROKEN_LINK] = "mislinked descriptor table",
+		[SIM_BROKEN_EMPTY] = "empty descriptor table",
+		[SIM_BROKEN_CHAIN] = "direct descriptor chain",
+	};
+	static unsigned char out[RPMSG_RX_CHAIN_MAX];
+	/* A direct descriptor holds one buffer */
+	unsigned int len = broken == SIM_BROKEN_CHAIN ? DATA_LEN_MAX :
+			DATA_LEN_MAX + 1;
+
+	fill_pattern(out, len, 0);
+	CHECK(send_broken(SIM_ECHO_ADDR, out, len, broken) == 0,
+			"broken table not sent");
+	check_echo(4);
+	printf("PASS: %s dropped\n", names[broken]);
+}
+
+/* Keep more messages in flight than the vrings can hold */
+static void check_burst(unsigned int count)
+{
+	unsigned long long deadline = now_ns() + 10 * 1000000000ULL;
+	unsigned int sent = 0;
+	unsigned int received = 0;
+	unsigned int seq;
+	struct sim_msg msg;
+
+	while (received < count) {
+		CHECK(now_ns() < deadline, "burst stalled after %u of %u messages",
+				received, count);
+		if (sent < count && sim_linux_send(SIM_LINUX_ADDR, SIM_ECHO_ADDR,
+				&sent, sizeof(sent)) == 0) {
+			sent++;
+			continue;
+		}
+		if (sim_linux_recv(&msg, 1) == 0) {
+			memcpy(&seq, msg.data, sizeof(seq));
+			CHECK(msg.len == sizeof(seq) && seq == received,
+					"burst message %u out of order (got %u)", received, seq);
+			received++;
+		}
+	}
+	printf("PASS: burst of %u messages\n", count);
+}
+
+/* Receive a message of 'len' bytes from the request dispatcher */
+static int recv_rpc(void *buf, unsigned int len)
+{
+	struct sim_msg msg;
+
+	if (sim_linux_recv(&msg, SIM_RECV_TIMEOUT_MS) || msg.src != SIM_RPC_ADDR ||
+			msg.len != len) {
+		return -1;
+	}
+	memcpy(buf, msg.data, len);
+	return 0;
+}
+
+/* Send a request the dispatcher does not know and receive its NAK */
+static int send_rejected(void)
+{
+	unsigned int opcode = QUIT;
+	struct rpc_ack ack;
+
+	if (send_to(SIM_RPC_ADDR, &opcode, sizeof(opcode)) ||
+			recv_rpc(&ack, sizeof(ack))) {
+		return -1;
+	}
+	return ack.state == (QUIT | REMOTEPROC_REQUEST_ACK_MASK) &&
+			ack.status == RPC_REJECTED ? 0 : -1;
+}
+
+/* Send 'len' bytes to CHECKSUM in chunks of 'chunk_len' bytes of data,
+ * skipping chunk 'skip' (-1 for none), and receive the ACK and the result */
+static int upload(const unsigned char *data, unsigned int len,
+		unsigned int total, unsigned int chunk_len, unsigned int skip,
+		struct rpc_upload_result *result)
+{
+	unsigned char buf[DATA_LEN_MAX];
+	struct rpc_upload_chunk *chunk = (struct rpc_upload_chunk *)buf;
+	unsigned int sent = 0;
+	unsigned int part;
+	struct rpc_ack ack;
+
+	chunk->opcode = UPLOAD;
+	chunk->target = CHECKSUM;
+	chunk->total = total;
+	chunk->seq = 0;
+	do {
+		part = len - sent > chunk_len ? chunk_len : len - sent;
+		memcpy(buf + sizeof(*chunk), data + sent, part);
+		if (chunk->seq != skip &&
+				send_to(SIM_RPC_ADDR, buf, sizeof(*chunk) + part)) {
+			return -1;
+		}
+		chunk->seq++;
+		sent += part;
+	} while (sent < len);
+
+	if (recv_rpc(&ack, sizeof(ack)) ||
+			ack.state != (UPLOAD | REMOTEPROC_REQUEST_ACK_MASK) ||
+			recv_rpc(result, sizeof(*result))) {
+		return -1;
+	}
+	return 0;
+}
+
+static void check_upload(unsigned int len, unsigned int chunk_len)
+{
+	static unsigned char data[RPC_UPLOAD_MAX];
+	struct rpc_upload_result result;
+	struct upload_checksum checksum;
+	unsigned int hash = 2166136261U;
+	unsigned int i;
+
+	fill_pattern(data, len, len);
+	for (i = 0; i < len; i++) {
+		hash = (hash ^ data[i]) * 16777619U;
+	}
+
+	CHECK(upload(data, len, len, chunk_len, (unsigned int)-1, &result) == 0,
+			"upload of %u bytes not answered", len);
+	CHECK(result.status == RPC_UPLOAD_OK && result.len == len,
+			"upload of %u bytes failed (status %u, %u bytes)", len,
+			result.status, result.len);
+	CHECK(recv_rpc(&checksum, sizeof(checksum)) == 0,
+			"no checksum of the upload of %u bytes", len);
+	CHECK(checksum.len == len && checksum.hash == hash,
+			"checksum of the upload of %u bytes wrong", len);
+	printf("PASS: upload of %u bytes in chunks of %u\n", len, chunk_len);
+}
+
+static void check_upload_errors(void)
+{
+	static unsigned char data[RPC_UPLOAD_MAX];
+	struct rpc_upload_result result;
+
+	/* A missing chunk ends the upload, the rest of it is ignored */
+	CHECK(upload(data, 4000, 4000, 400, 3, &result) == 0 &&
+			result.status == RPC_UPLOAD_SEQUENCE && result.len == 1200,
+			"missing chunk not detected");
+	/* More data than announced */
+	CHECK(upload(data, 800, 500, 400, (unsigned int)-1, &result) == 0 &&
+			result.status == RPC_UPLOAD_SEQUENCE,
+			"excess data not detected");
+	CHECK(upload(data, 400, RPC_UPLOAD_MAX + 1, 400, (unsigned int)-1,
+			&result) == 0 && result.status == RPC_UPLOAD_SIZE,
+			"oversized upload not rejected");
+	/* Shorter than the request of the target */
+	CHECK(upload(data, 0, 0, 400, (unsigned int)-1, &result) == 0 &&
+			result.status == RPC_UPLOAD_SIZE, "empty upload not rejected");
+	printf("PASS: broken uploads rejected\n");
+
+	/* Uploads work again afterwards */
+	check_upload(1000, 400);
+}
+
+/* Trace buffer reader, like latencytrace.c. '*tail' counts the bytes
+ * read. */
+static unsigned int trace_tail;
+static unsigned int binlog_tail;
+
+static unsigned int trace_read(struct trace_ring *ring, unsigned int *tail,
+		void *buf, unsigned int len, unsigned int *lost)
+{
+	const char *text = (const char *)(uintptr_t)ring->buffer;
+	unsigned int size = ring->size;
+	unsigned int head = ring->head;
+	unsigned int offset;
+	unsigned int first;
+
+	*lost = 0;
+	__sync_synchronize();
+	if (head - *tail > size) {
+		*lost = head - *tail - size;
+		*tail = head - size;
+	}
+	if (len > head - *tail) {
+		len = head - *tail;
+	}
+	offset = *tail & (size - 1);
+	first = size - offset < len ? size - offset : len;
+	memcpy(buf, text + offset, first);
+	memcpy((char *)buf + first, text, len - first);
+
+	*tail += len;
+	ring->tail = *tail;
+	return len;
+}
+
+/* Wait until 'len' bytes of trace are unread */
+static int trace_wait(struct trace_ring *ring, unsigned int *tail,
+		unsigned int len)
+{
+	unsigned long long deadline = now_ns() +
+			SIM_RECV_TIMEOUT_MS * 1000000ULL;
+
+	while (ring->head - *tail < len) {
+		if (now_ns() > deadline) {
+			return -1;
+		}
+		sched_yield();
+	}
+	return 0;
+}
+
+static void check_trace(void)
+{
+	static const char expected[] = "rpc: Unimplemented request\r\n";
+	static char buf[TRACE_BUFFER_SIZE];
+	struct trace_ring *ring = (struct trace_ring *)TRACE_RING_START;
+	unsigned int len = sizeof(expected) - 1;
+	unsigned int count = 2 * TRACE_BUFFER_SIZE / len + 1;
+	unsigned int overruns;
+	unsigned int wraps;
+	unsigned int lost;
+	unsigned int got;
+	unsigned int i;
+
+	CHECK(ring->magic == TRACE_RING_MAGIC, "trace buffer header not set up");
+	CHECK(ring->buffer == TRACE_BUFFER_START &&
+			ring->size == TRACE_BUFFER_SIZE, "trace buffer header wrong");
+
+	/* New text only, a request the dispatcher does not know is logged */
+	trace_tail = ring->head;
+	ring->tail = trace_tail;
+	CHECK(send_rejected() == 0 &&
+			trace_wait(ring, &trace_tail, len) == 0,
+			"no trace of a rejected request");
+	got = trace_read(ring, &trace_tail, buf, sizeof(buf), &lost);
+	CHECK(got == len && lost == 0 && memcmp(buf, expected, len) == 0,
+			"trace '%.*s' read, expected '%s'", got, buf, expected);
+
+	/* Wrap around twice without reading, the oldest text is lost */
+	overruns = ring->overruns;
+	wraps = ring->wraps;
+	for (i = 0; i < count; i++) {
+		CHECK(send_rejected() == 0,
+				"request %u not NAKed", i);
+	}
+	CHECK(trace_wait(ring, &trace_tail, count * len) == 0,
+			"trace of %u requests missing", count);
+	got = trace_read(ring, &trace_tail, buf, sizeof(buf), &lost);
+	CHECK(got == TRACE_BUFFER_SIZE && lost == count * len - got,
+			"read %u bytes, %u lost after wrapping", got, lost);
+	CHECK(ring->wraps - wraps >= 2 && ring->overruns > overruns,
+			"wraps %u, overruns %u after wrapping", ring->wraps,
+			ring->overruns);
+	for (i = 0; i < got; i++) {
+		CHECK(buf[got - 1 - i] == expected[len - 1 - i % len],
+				"trace corrupted %u bytes before the head", i + 1);
+	}
+	printf("PASS: trace buffer followed across wraps\n");
+}
+
+/* Run a mailbox command like latencymailbox.c does, returns the status or
+ * -1 on timeout */
+static int mailbox_call(unsigned int command, unsigned int arg)
+{
+	struct mailbox_slot* mb = MAILBOX;
+	unsigned int seq = mb->seq + 1;
+	unsigned long long start = now_ns();
+
+	mb->command = command;
+	mb->arg = arg;
+	__sync_synchronize();
+	mb->seq = seq;
+	__sync_synchronize();
+	sim_linux_doorbell(mb->doorbell);
+
+	while (mb->done != seq) {
+		if (now_ns() - start > SIM_RECV_TIMEOUT_MS * 1000000ULL) {
+			return -1;
+		}
+		sched_yield();
+	}
+	__sync_synchronize();
+	return mb->status;
+}
+
+static void check_mailbox(void)
+{
+	struct mailbox_slot* mb = MAILBOX;
+	unsigned int done;
+
+	CHECK(mb->magic == MAILBOX_MAGIC, "mailbox not set up");
+	CHECK(mb->doorbell == MAILBOX_IRQ, "mailbox doorbell %u", mb->doorbell);
+	CHECK(mailbox_call(MAILBOX_PING, 0) == MAILBOX_OK, "mailbox ping failed");
+	CHECK(mailbox_call(SIM_MAILBOX_COMMAND, 1) == MAILBOX_OK,
+			"mailbox command failed");
+	CHECK(mailbox_call(QUIT, 0) == MAILBOX_UNKNOWN,
+			"mailbox command without handler not rejected");
+	CHECK(mailbox_call(MAILBOX_COMMANDS, 0) == MAILBOX_UNKNOWN,
+			"mailbox command out of range not rejected");
+
+	/* A doorbell without a new command changes nothing */
+	done = mb->done;
+	sim_linux_doorbell(mb->doorbell);
+	CHECK(mailbox_call(MAILBOX_PING, 0) == MAILBOX_OK && mb->done == done + 1,
+			"mailbox ran a command twice");
+	printf("PASS: control mailbox\n");
+}
+
+/* The RX task and the mailbox interrupt write to the trace at the same time,
+ * every line has to come out whole */
+static void check_trace_writers(void)
+{
+	static const char rejected[] = "rpc: Unimplemented request\r\n";
+	static char buf[TRACE_BUFFER_SIZE];
+	struct trace_ring *ring = (struct trace_ring *)TRACE_RING_START;
+	struct mailbox_slot *mb = MAILBOX;
+	unsigned int seq = mb->seq + 1;
+	unsigned int len1 = sizeof(rejected) - 1;
+	unsigned int len2 = strlen(sim_trace_line);
+	unsigned int count = TRACE_BUFFER_SIZE / (len1 + len2) / 2;
+	unsigned int found1 = 0;
+	unsigned int found2 = 0;
+	unsigned int lost;
+	unsigned int got;
+	unsigned int i;
+
+	trace_tail = ring->head;
+	ring->tail = trace_tail;
+	/* The mailbox handler writes its lines while the RX task logs the
+	 * requests */
+	mb->command = SIM_MAILBOX_TRACE;
+	mb->arg = count;
+	__sync_synchronize();
+	mb->seq = seq;
+	__sync_synchronize();
+	sim_linux_doorbell(mb->doorbell);
+	for (i = 0; i < count; i++) {
+		CHECK(send_rejected() == 0,
+				"request %u not NAKed", i);
+	}
+	CHECK(trace_wait(ring, &trace_tail, count * (len1 + len2)) == 0 &&
+			mb->done == seq, "trace of %u writes missing", 2 * count);
+	got = trace_read(ring, &trace_tail, buf, sizeof(buf), &lost);
+	CHECK(got == count * (len1 + len2) && lost == 0,
+			"read %u bytes, %u lost", got, lost);
+
+	for (i = 0; i < got; ) {
+		if (got - i >= len1 && memcmp(buf + i, rejected, len1) == 0) {
+			found1++;
+			i += len1;
+		} else if (got - i >= len2 && memcmp(buf + i, sim_trace_line,
+				len2) == 0) {
+			found2++;
+			i += len2;
+		} else {
+			CHECK(0, "trace corrupted at '%.20s'", buf + i);
+		}
+	}
+	CHECK(found1 == count && found2 == count, "%u and %u lines of %u",
+			found1, found2, count);
+	printf("PASS: trace written from a task and an interrupt\n");
+}
+
+static void check_binlog(void)
+{
+	static struct binlog_record recs[BINLOG_BUFFER_SIZE /
+			sizeof(struct binlog_record)];
+	struct trace_ring *ring = BINLOG_RING;
+	unsigned int records = sizeof(recs) / sizeof(recs[0]);
+	unsigned int count = 2 * records + 1;
+	unsigned long long time;
+	unsigned int wraps;
+	unsigned int lost;
+	unsigned int got;
+	unsigned int i;
+
+	CHECK(ring->magic == TRACE_RING_MAGIC, "binary log header not set up");
+	CHECK(ring->buffer == BINLOG_BUFFER_START &&
+			ring->size == BINLOG_BUFFER_SIZE &&
+			ring->timestamp_freq == TIMESTAMP_FREQ,
+			"binary log header wrong");
+
+	/* The mailbox handler logs its argument from interrupt context */
+	binlog_tail = ring->head;
+	ring->tail = binlog_tail;
+	CHECK(mailbox_call(SIM_MAILBOX_COMMAND, 1234) == MAILBOX_OK &&
+			trace_wait(ring, &binlog_tail, sizeof(recs[0])) == 0,
+			"no record of a mailbox command");
+	got = trace_read(ring, &binlog_tail, recs, sizeof(recs), &lost);
+	CHECK(got == sizeof(recs[0]) && lost == 0 &&
+			recs[0].format == (uintptr_t)sim_binlog_format &&
+			recs[0].nargs == 1 && recs[0].args[0] == 1234,
+			"record %u bytes, format 0x%x, %u args, arg 0 %u", got,
+			recs[0].format, recs[0].nargs, recs[0].args[0]);
+
+	/* Wrap around twice without reading, the oldest records are lost */
+	wraps = ring->wraps;
+	time = recs[0].time;
+	for (i = 0; i < count; i++) {
+		CHECK(mailbox_call(SIM_MAILBOX_COMMAND, i) == MAILBOX_OK,
+				"mailbox command %u failed", i);
+	}
+	/* The last records are published by the tick */
+	CHECK(trace_wait(ring, &binlog_tail, count * sizeof(recs[0])) == 0,
+			"binary log records not published");
+	got = trace_read(ring, &binlog_tail, recs, sizeof(recs), &lost);
+	CHECK(got == sizeof(recs) && lost == count * sizeof(recs[0]) - got,
+			"read %u bytes, %u lost after wrapping", got, lost);
+	CHECK(ring->wraps - wraps >= 2, "wraps %u after wrapping", ring->wraps);
+	for (i = 0; i < records; i++) {
+		CHECK(recs[i].args[0] == count - records + i &&
+				recs[i].time >= time,
+				"record %u of %u out of order", i, records);
+		time = recs[i].time;
+	}
+	printf("PASS: binary log records\n");
+}
+
+/* Send LOGGING and receive the settings now in effect */
+static int log_config(unsigned int level, unsigned int mask,
+		struct rpc_log_state *state)
+{
+	struct rpc_log_config config = { LOGGING, level, mask };
+	struct rpc_ack ack;
+
+	if (send_to(SIM_RPC_ADDR, &config, sizeof(config)) ||
+			recv_rpc(&ack, sizeof(ack)) ||
+			ack.state != (LOGGING | REMOTEPROC_REQUEST_ACK_MASK) ||
+			recv_rpc(state, sizeof(*state))) {
+		return -1;
+	}
+	return 0;
+}
+
+static void check_logging(void)
+{
+	static const char expected[] = "rpc: Unimplemented request\r\n";
+	static char buf[sizeof(expected)];
+	struct trace_ring *ring = (struct trace_ring *)TRACE_RING_START;
+	struct rpc_log_state state;
+	unsigned int len = sizeof(expected) - 1;
+	unsigned int lost;
+
+	CHECK(log_config(LOG_KEEP, LOG_KEEP, &state) == 0,
+			"LOGGING not answered");
+	CHECK(state.level == LOG_LEVEL_DEFAULT && state.mask == LOG_MASK_DEFAULT &&
+			state.max_level == LOG_LEVEL_MAX,
+			"log level %u, mask 0x%x, max level %u after boot", state.level,
+			state.mask, state.max_level);
+
+	/* A rejected request is not logged with its category masked out */
+	trace_tail = ring->head;
+	ring->tail = trace_tail;
+	CHECK(log_config(LOG_KEEP, LOG_CAT_ALL & ~LOG_CAT_RPC, &state) == 0 &&
+			state.level == LOG_LEVEL_DEFAULT &&
+			state.mask == (LOG_CAT_ALL & ~LOG_CAT_RPC),
+			"log mask not set");
+	CHECK(send_rejected() == 0,
+			"request not NAKed");
+	/* Nor below the level, the dispatcher logs it as a warning */
+	CHECK(log_config(LOG_ERROR, LOG_CAT_ALL, &state) == 0 &&
+			state.level == LOG_ERROR && state.mask == LOG_CAT_ALL,
+			"log level not set");
+	CHECK(send_rejected() == 0,
+			"request not NAKed");
+
+	/* Once both allow it again it is */
+	CHECK(log_config(LOG_LEVELS + 1, LOG_KEEP, &state) == 0 &&
+			state.level == LOG_LEVELS - 1, "log level not clamped");
+	CHECK(send_rejected() == 0 &&
+			trace_wait(ring, &trace_tail, len) == 0,
+			"no trace of a rejected request");
+	CHECK(trace_read(ring, &trace_tail, buf, sizeof(buf), &lost) == len &&
+			memcmp(buf, expected, len) == 0,
+			"filtered messages written to the trace");
+
+	CHECK(log_config(LOG_LEVEL_DEFAULT, LOG_MASK_DEFAULT, &state) == 0,
+			"log settings not restored");
+	printf("PASS: log level and mask\n");
+}
+
+/* The firmware timestamps are CLOCK_MONOTONIC in the simulation, so the
+ * times in the ACK must lie between sending the request and receiving the
+ * ACK */
+static void check_time(void)
+{
+	unsigned int opcode = TIME;
+	unsigned long long sent;
+	unsigned long long received;
+	struct rpc_time time;
+	struct rpc_ack ack;
+
+	sent = now_ns();
+	CHECK(send_to(SIM_RPC_ADDR, &opcode, sizeof(opcode)) == 0 &&
+			recv_rpc(&ack, sizeof(ack)) == 0, "TIME not ACKed");
+	received = now_ns();
+	CHECK(recv_rpc(&time, sizeof(time)) == 0, "TIME not answered");
+
+	CHECK(ack.state == (TIME | REMOTEPROC_REQUEST_ACK_MASK),
+			"ACK 0x%x for TIME", ack.state);
+	CHECK(time.timestamp_freq == TIMESTAMP_FREQ, "timestamp frequency %u",
+			time.timestamp_freq);
+	CHECK(sent <= ack.rx_time && ack.rx_time <= time.time &&
+			time.time <= ack.tx_time && ack.tx_time <= received,
+			"times out of order: sent %llu, arrived %llu, handled %llu, "
+			"ACKed %llu, received %llu", sent, ack.rx_time, time.time,
+			ack.tx_time, received);
+	printf("PASS: request timestamps, %llu ns there, %llu ns back\n",
+			ack.rx_time - sent, received - ack.tx_time);
+}
+
+/* Copy the statistics page like latencystat does (see stats_page.h).
+ * Returns 0, or -1 if no copy was consistent. */
+static int stats_snapshot(struct stats_page* copy)
+{
+	struct stats_page* page = STATS_PAGE;
+	unsigned int end;
+	unsigned int i;
+
+	for (i = 0; i < SIM_STATS_TRIES; i++) {
+		end = page->end;
+		__sync_synchronize();
+		memcpy(copy, (void *)page, sizeof(*copy));
+		__sync_synchronize();
+		if (page->begin == end) {
+			return 0;
+		}
+		sched_yield();
+	}
+	return -1;
+}
+
+/* Value of the entry 'name' in a snapshot, ~0 if there is none */
+static unsigned long long stats_value(const struct stats_page* copy,
+		const char* name)
+{
+	unsigned int i;
+
+	for (i = 0; i < copy->count && i < STATS_ENTRIES_MAX; i++) {
+		if (strcmp(copy->entries[i].name, name) == 0) {
+			return copy->entries[i].value;
+		}
+	}
+	return ~0ULL;
+}
+
+/* Copy the statistics page once the statistics task has published all that
+ * was counted before the call: after two more rounds, the first may have
+ * read the counters already. Returns 0, or -1 if it did not. */
+static int stats_settled(struct stats_page* copy)
+{
+	unsigned long long deadline = now_ns() +
+			SIM_STATS_TIMEOUT_MS * 1000000ULL;
+	unsigned long long start;
+
+	if (stats_snapshot(copy) < 0) {
+		return -1;
+	}
+	start = stats_value(copy, STATS_PUBLISHED_NAME);
+	while (stats_value(copy, STATS_PUBLISHED_NAME) - start < 2) {
+		if (now_ns() > deadline) {
+			return -1;
+		}
+		usleep(1000);
+		if (stats_snapshot(copy) < 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* Echo messages while reading the statistics page: every snapshot has to be
+ * consistent, the counters must not go back and once the task has published
+ * them they have counted every message */
+static void check_stats(unsigned int count)
+{
+	static struct stats_page before;
+	static struct stats_page last;
+	static struct stats_page copy;
+	unsigned long long deadline = now_ns() + 10 * 1000000000ULL;
+	unsigned int sent = 0;
+	unsigned int received = 0;
+	unsigned int snapshots = 0;
+	unsigned long long kicks;
+	struct sim_msg msg;
+
+	CHECK(STATS_PAGE->magic == STATS_MAGIC, "statistics page not set up");
+	CHECK(STATS_PAGE->size == sizeof(struct stats_page),
+			"statistics page size %u", STATS_PAGE->size);
+	CHECK(stats_settled(&before) == 0, "statistics not published");
+	CHECK(stats_value(&before, "rx_messages") != ~0ULL &&
+			stats_value(&before, "tx_messages") != ~0ULL &&
+			stats_value(&before, "rx_kicks") != ~0ULL &&
+			stats_value(&before, "tx_full") != ~0ULL,
+			"transport counters missing");
+	last = before;
+
+	while (received < count) {
+		CHECK(now_ns() < deadline, "echo stalled after %u of %u messages",
+				received, count);
+		if (sent < count && sim_linux_send(SIM_LINUX_ADDR, SIM_ECHO_ADDR,
+				&sent, sizeof(sent)) == 0) {
+			sent++;
+		} else if (sim_linux_recv(&msg, 1) == 0) {
+			received++;
+		}
+
+		CHECK(stats_snapshot(&copy) == 0,
+				"no consistent statistics snapshot after %u messages", received);
+		CHECK(stats_value(&copy, "rx_messages") >=
+				stats_value(&last, "rx_messages") &&
+				stats_value(&copy, "tx_messages") >=
+				stats_value(&last, "tx_messages"),
+				"statistics counters went back");
+		last = copy;
+		snapshots++;
+	}
+
+	CHECK(stats_settled(&copy) == 0, "statistics not published");
+	CHECK(stats_value(&copy, "rx_messages") -
+			stats_value(&before, "rx_messages") == count &&
+			stats_value(&copy, "tx_messages") -
+			stats_value(&before, "tx_messages") == count,
+			"%llu messages received, %llu sent, expected %u",
+			stats_value(&copy, "rx_messages") -
+			stats_value(&before, "rx_messages"),
+			stats_value(&copy, "tx_messages") -
+			stats_value(&before, "tx_messages"), count);
+	kicks = stats_value(&copy, "rx_kicks") - stats_value(&before, "rx_kicks");
+	CHECK(kicks >= 1 && kicks <= count, "%llu RX kicks for %u messages",
+			kicks, count);
+
+	/* The mailbox handler sets a gauge */
+	CHECK(mailbox_call(SIM_MAILBOX_COMMAND, 12345) == MAILBOX_OK &&
+			stats_snapshot(&copy) == 0 &&
+			stats_value(&copy, SIM_STATS_GAUGE) == 12345,
+			"gauge %s not set", SIM_STATS_GAUGE);
+	printf("PASS: statistics page, %u consistent snapshots\n", snapshots);
+}
+
+static int run_checks(void)
+{
+	unsigned int len;
+
+	check_announcement(SIM_ECHO_ADDR, SIM_ECHO_NAME);
+	check_announcement(SIM_RPC_ADDR, SIM_RPC_NAME);
+	if (failures) {
+		return 1;
+	}
+
+	for (len = 1; len < DATA_LEN_MAX; len *= 2) {
+		check_echo(len);
+	}
+	check_echo(DATA_LEN_MAX);
+
+	/* Messages larger than one buffer go as an indirect descriptor table */
+	check_echo(DATA_LEN_MAX + 1);
+	check_echo(RPMSG_RX_CHAIN_MAX - sizeof(struct rpmsg_hdr));
+	check_broken_table(SIM_BROKEN_LINK);
+	check_broken_table(SIM_BROKEN_EMPTY);
+	check_broken_table(SIM_BROKEN_CHAIN);
+
+	check_burst(4 * VRING_SIZE);
+
+	check_upload(1, DATA_LEN_MAX - sizeof(struct rpc_upload_chunk));
+	check_upload(100, DATA_LEN_MAX - sizeof(struct rpc_upload_chunk));
+	check_upload(RPC_UPLOAD_MAX, DATA_LEN_MAX - sizeof(struct rpc_upload_chunk));
+	check_upload(RPC_UPLOAD_MAX - 1, 100);
+	check_upload_errors();
+
+	check_mailbox();
+	check_trace();
+	check_trace_writers();
+	check_binlog();
+	check_logging();
+	check_time();
+	check_stats(4 * VRING_SIZE);
+
+	printf("%s: %u failure(s)\n", failures ? "FAIL" : "PASS", failures);
+	return failures ? 1 : 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Benchmark */
+
+static void bench(unsigned int len, unsigned int depth, unsigned int count)
+{
+	static unsigned long long sent_at[VRING_SIZE];
+	unsigned char payload[DATA_LEN_MAX];
+	unsigned long long start = now_ns();
+	unsigned long long rtt;
+	unsigned long long rtt_min = ~0ULL;
+	unsigned long long rtt_max = 0;
+	unsigned long long rtt_sum = 0;
+	unsigned long long elapsed;
+	unsigned int sent = 0;
+	unsigned int received = 0;
+	struct sim_msg msg;
+
+	fill_pattern(payload, len, len);
+
+	while (received < count) {
+		/* Keep 'depth' messages in flight */
+		while (sent < count && sent - received < depth) {
+			sent_at[sent % VRING_SIZE] = now_ns();
+			if (sim_linux_send(SIM_LINUX_ADDR, SIM_ECHO_ADDR, payload, len)) {
+				break;
+			}
+			sent++;
+		}
+		if (sim_linux_recv(&msg, SIM_RECV_TIMEOUT_MS)) {
+			printf("%5u %5u  timed out\n", len, depth);
+			return;
+		}
+		rtt = now_ns() - sent_at[received % VRING_SIZE];
+		rtt_sum += rtt;
+		if (rtt < rtt_min) {
+			rtt_min = rtt;
+		}
+		if (rtt > rtt_max) {
+			rtt_max = rtt;
+		}
+		received++;
+	}
+	elapsed = now_ns() - start;
+
+	printf("%5u %5u %10.0f %10.1f %10.1f %10.1f\n", len, depth,
+			count * 1e9 / elapsed, rtt_min / 1e3,
+			rtt_sum / 1e3 / count, rtt_max / 1e3);
+}
+
+static int run_bench(unsigned int count)
+{
+	static const unsigned int sizes[] = { 4, 16, 64, 256, DATA_LEN_MAX };
+	static const unsigned int depths[] = { 1, 8, 32 };
+	struct sim_msg msg;
+	unsigned int i;
+	unsigned int j;
+
+	/* Skip the announcements */
+	if (sim_linux_recv(&msg, SIM_RECV_TIMEOUT_MS) ||
+			sim_linux_recv(&msg, SIM_RECV_TIMEOUT_MS)) {
+		printf("firmware did not start\n");
+		return 1;
+	}
+
+	printf("%5s %5s %10s %10s %10s %10s\n", "size", "depth", "msgs/s",
+			"rtt min", "rtt avg", "rtt max");
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		for (j = 0; j < sizeof(depths) / sizeof(depths[0]); j++) {
+			if (depths[j] <= VRING_SIZE / 2) {
+				bench(sizes[i], depths[j], count);
+			}
+		}
+	}
+	printf("(round trip times in us)\n");
+	return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void print_help(void)
+{
+	printf("rpmsgsim - host simulation of the FreeRTOS remoteproc transport\n");
+	printf("\n");
+	printf("\t -b     Runs the echo benchmark instead of the checks\n");
+	printf("\t -n <n> Number of messages per benchmark run (default 20000)\n");
+	printf("\t -h     Displays this help message\n");
+	printf("\n");
+	printf("Set SIM_TRACE to print the firmware trace buffer to stderr.\n");
+	printf("Set SIM_POLL to let the firmware poll the RX vring for that many\n");
+	printf("microseconds after each message.\n");
+}
+
+int main(int argc, char** argv)
+{
+	size_t shm_len = __sim_shm_end - __sim_shm_base;
+	unsigned int do_bench = 0;
+	unsigned int count = 20000;
+	pid_t firmware;
+	void *shm;
+	int status;
+	int ret;
+	int i;
+
+	/* argument parsing */
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-b") == 0) {
+			do_bench = 1;
+		} else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			count = strtoul(argv[++i], NULL, 0);
+		} else {
+			print_help();
+			return strcmp(argv[i], "-h") == 0 ? 0 : 1;
+		}
+	}
+
+	/* The firmware uses the shared memory at its link time addresses */
+	shm = mmap(__sim_shm_base, shm_len, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+	if (shm != (void *)__sim_shm_base) {
+		perror("rpmsgsim: cannot map the shared memory");
+		return 1;
+	}
+
+	for (i = 0; i < SIM_IRQ_COUNT; i++) {
+		sim_irq_fds[i] = eventfd(0, EFD_SEMAPHORE);
+		if (sim_irq_fds[i] < 0) {
+			perror("rpmsgsim: eventfd");
+			return 1;
+		}
+	}
+
+	fflush(stdout);
+	firmware = fork();
+	if (firmware < 0) {
+		perror("rpmsgsim: fork");
+		return 1;
+	} else if (firmware == 0) {
+		prctl(PR_SET_PDEATHSIG, SIGKILL);
+		sim_firmware_main();
+		_exit(1);
+	}
+
+	sim_linux_start();
+	ret = do_bench ? run_bench(count) : run_checks();
+
+	kill(firmware, SIGKILL);
+	waitpid(firmware, &status, 0);
+	return ret;
+}
@@ -0,0 +1,78 @@
+/*
+ * Host simulation of the FreeRTOS remoteproc transport.
+ *
+ * The firmware side (remoteproc.c compiled against the shims in include/)
+ * runs in a child process, the simulated Linux master in the parent. Both
+ * share an anonymous mapping at the addresses the firmware expects, see
+ * sim.ld for the layout.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+/* Interrupts 0..15 (SGIs) are simulated, each is an eventfd */
+#define SIM_IRQ_COUNT			16
+extern int sim_irq_fds[SIM_IRQ_COUNT];
+
+/* Shared memory layout, defined in sim.ld */
+extern char __sim_shm_base[];
+extern char __sim_shm_end[];
+extern char __sim_buffers[];
+
+/* Address of the Linux endpoint the simulated master sends from */
+#define SIM_LINUX_ADDR			0x400
+
+/* Endpoint of the echo service in the simulated firmware */
+#define SIM_ECHO_ADDR			0x50
+#define SIM_ECHO_NAME			"rpmsg-sim-echo"
+
+/* Endpoint of the request dispatcher (rpc.c) in the simulated firmware */
+#define SIM_RPC_ADDR			0x52
+#define SIM_RPC_NAME			"rpmsg-sim-rpc"
+
+/* Mailbox command of the simulated firmware, its handler only logs its
+ * argument to the binary log with sim_binlog_format and sets the gauge
+ * SIM_STATS_GAUGE of the statistics page to it */
+#define SIM_MAILBOX_COMMAND		START
+extern const char sim_binlog_format[];
+#define SIM_STATS_GAUGE			"mailbox_arg"
+/* Mailbox command which writes sim_trace_line to the trace buffer 'arg'
+ * times */
+#define SIM_MAILBOX_TRACE		STOP
+extern const char sim_trace_line[];
+
+/* Firmware side, never returns */
+void sim_firmware_main(void);
+
+/* Simulated Linux master */
+struct sim_msg {
+	unsigned int src;
+	unsigned int dst;
+	unsigned int len;
+	unsigned char data[4096];
+};
+
+/* Fill the vrings and kick the firmware like virtio_rpmsg_bus does when the
+ * device is probed */
+void sim_linux_start(void);
+
+/* Send a message to the firmware. Returns 0, or -1 if no RX buffer is free
+ * (the firmware has not consumed the earlier messages yet). */
+int sim_linux_send(unsigned int src, unsigned int dst, const void *data,
+		unsigned int len);
+
+/* Send a message with descriptors which are 'broken' */
+#define SIM_BROKEN_LINK			0	/* a link points past the table */
+#define SIM_BROKEN_EMPTY		1	/* the table has no descriptors */
+#define SIM_BROKEN_CHAIN		2	/* a direct descriptor with a link */
+int sim_linux_send_broken(unsigned int src, unsigned int dst,
+		const void *data, unsigned int len, int broken);
+
+/* Receive the next message from the firmware, waiting at most 'timeout_ms'.
+ * Returns 0, or -1 on timeout. The buffer is given back to the firmware. */
+int sim_linux_recv(struct sim_msg *msg, int timeout_ms);
+
+/* Raise the SGI 'irq' on the firmware, like a doorbell from Linux */
+void sim_linux_doorbell(int irq);
+
+#endif /* SIM_H */
@@ -0,0 +1,154 @@
+/*
+ * Firmware side of the simulation: the transport from remoteproc.c with an
+ * echo service, the request dispatcher from rpc.c, the control mailbox,
+ * the binary log, the log settings and the time service, set up the same way as main() in
+ * latencydemo.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "remoteproc_kernel.h"
+#include "remoteproc.h"
+#include "rpc.h"
+#include "mailbox.h"
+#include "binlog.h"
+#include "logging.h"
+#include "timestamp.h"
+#include "stats.h"
+
+#include "sim.h"
+
+/* Send every message back to where it came from. The first segment goes
+ * through the zero-copy API, the rest (if any) is segmented by
+ * remoteproc_request_response(). */
+static void echo_handler(struct remoteproc_request* req, unsigned char* data,
+		unsigned int len)
+{
+	struct remoteproc_tx_buffer buf;
+	unsigned int first;
+
+	if (remoteproc_reserve(&buf, portMAX_DELAY)) {
+		return;
+	}
+	first = len < buf.size ? len : buf.size;
+	memcpy(buf.data, data, first);
+	remoteproc_commit(&buf, req->__hdr->dst, req->__hdr->src, first);
+	remoteproc_request_response(req, data + first, len - first);
+}
+
+static struct upload_checksum checksum_result;
+
+/* Same as the CHECKSUM request of latencydemo.c */
+static void* cmd_checksum(unsigned char* data, unsigned int len)
+{
+	unsigned int hash = 2166136261U;
+	unsigned int i;
+
+	for (i = 0; i < len; i++) {
+		hash = (hash ^ data[i]) * 16777619U;
+	}
+	checksum_result.len = len;
+	checksum_result.hash = hash;
+	return &checksum_result;
+}
+
+static struct rpc_log_state log_result;
+
+/* Same as the LOGGING request of latencydemo.c */
+static void* cmd_logging(unsigned char* data, unsigned int len)
+{
+	struct rpc_log_config* config = (struct rpc_log_config *)data;
+
+	log_configure(config->level, config->mask);
+	log_get_state(&log_result);
+	return &log_result;
+}
+
+static struct rpc_time time_result;
+
+/* Same as the TIME request of latencydemo.c, there is no TTC to sample */
+static void* cmd_time(unsigned char* data, unsigned int len)
+{
+	time_result.timestamp_freq = TIMESTAMP_FREQ;
+	time_result.sample_freq = 0;
+	time_result.time = timestamp_read();
+	return &time_result;
+}
+
+const char sim_binlog_format[] = "sim: mailbox command, arg %u\r\n";
+
+static struct stats_entry* stat_mailbox_arg;
+
+static void mb_log(unsigned int arg)
+{
+	binlog(sim_binlog_format, arg);
+	stats_set(stat_mailbox_arg, arg);
+}
+
+const char sim_trace_line[] = "sim: mailbox trace line\r\n";
+
+/* Writes 'arg' lines to the trace buffer from interrupt context, next to
+ * the tasks */
+static void mb_trace(unsigned int arg)
+{
+	unsigned int i;
+
+	for (i = 0; i < arg; i++) {
+		xputs((char *)sim_trace_line);
+	}
+}
+
+static const struct rpc_command sim_commands[] = {
+	RPC_BULK_COMMAND(CHECKSUM, cmd_checksum, unsigned char,
+			sizeof(struct upload_checksum)),
+	RPC_COMMAND(LOGGING, cmd_logging, struct rpc_log_config,
+			sizeof(struct rpc_log_state)),
+	RPC_COMMAND(TIME, cmd_time, unsigned int, sizeof(struct rpc_time)),
+};
+
+void vApplicationTickHook(void)
+{
+	binlog_drain();
+}
+
+void sim_firmware_main(void)
+{
+	trace_init();
+	binlog_init();
+	stats_init();
+
+	remoteproc_init();
+	/* SIM_POLL sets the poll budget of the RX vring in us */
+	if (getenv("SIM_POLL") != NULL) {
+		remoteproc_set_poll_budget(strtoul(getenv("SIM_POLL"), NULL, 0));
+	}
+	if (remoteproc_register_endpoint(SIM_ECHO_NAME, SIM_ECHO_ADDR,
+			&echo_handler)) {
+		fprintf(stderr, "sim: failed to register the echo endpoint\n");
+		exit(1);
+	}
+	rpc_init();
+	if (rpc_register(sim_commands, sizeof(sim_commands) /
+			sizeof(sim_commands[0])) ||
+			remoteproc_register_endpoint(SIM_RPC_NAME, SIM_RPC_ADDR,
+			&rpc_dispatch)) {
+		fprintf(stderr, "sim: failed to register the rpc endpoint\n");
+		exit(1);
+	}
+	mailbox_init();
+	stat_mailbox_arg = stats_register(SIM_STATS_GAUGE, STATS_GAUGE);
+	if (mailbox_register(SIM_MAILBOX_COMMAND, &mb_log) ||
+			mailbox_register(SIM_MAILBOX_TRACE, &mb_trace)) {
+		fprintf(stderr, "sim: failed to register the mailbox command\n");
+		exit(1);
+	}
+	remoteproc_init_irqs();
+	mailbox_init_irqs();
+
+	vTaskStartScheduler();
+}
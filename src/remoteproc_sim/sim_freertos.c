@@ -0,0 +1,444 @@
+/*
+ * Host shim of the FreeRTOS kernel API on top of POSIX threads.
+ *
+ * - Tasks are threads. They are held back until vTaskStartScheduler() is
+ *   called, priorities are ignored and the host scheduler decides.
+ * - Queues and semaphores are a mutex protected ring of items with condition
+ *   variables, a semaphore is a queue with zero sized items.
+ * - Critical sections take a recursive lock which the interrupt thread
+ *   (sim_port.c) also holds while running a handler.
+ * - The tick count is derived from CLOCK_MONOTONIC at configTICK_RATE_HZ.
+ *   A tick thread calls vApplicationTickHook() at that rate, with the
+ *   critical section lock held like an interrupt handler.
+ *
+ * xTaskResumeFromISR() only resumes a task that is already suspended, like
+ * the real kernel, so lost wake ups show up in the simulation as well.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+struct sim_task {
+	pthread_t thread;
+	pdTASK_CODE code;
+	void *param;
+	char name[configMAX_TASK_NAME_LEN + 1];
+	pthread_mutex_t lock;
+	pthread_cond_t resume;
+	int suspended;
+};
+
+struct sim_queue {
+	pthread_mutex_t lock;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+	unsigned int length;
+	unsigned int item_size;
+	unsigned int count;
+	unsigned int head;
+	unsigned char *items;
+};
+
+static pthread_mutex_t critical_lock;
+static pthread_once_t critical_once = PTHREAD_ONCE_INIT;
+
+static pthread_mutex_t scheduler_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t scheduler_started_cond = PTHREAD_COND_INITIALIZER;
+static int scheduler_started = 0;
+
+static __thread struct sim_task *current_task = NULL;
+
+/* Handler registered with register_handler(), run when the scheduler starts */
+static void (*start_handler)(void) = NULL;
+
+/* Defined by the firmware, see configUSE_TICK_HOOK */
+extern void vApplicationTickHook( void );
+
+/* -------------------------------------------------------------------------- */
+/* Time */
+
+static struct timespec sim_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts;
+}
+
+static struct timespec sim_deadline(portTickType ticks)
+{
+	struct timespec ts = sim_now();
+	unsigned long long ns = (unsigned long long)ticks * portTICK_RATE_MS *
+			1000000ULL;
+
+	ts.tv_sec += ns / 1000000000ULL;
+	ts.tv_nsec += ns % 1000000000ULL;
+	if (ts.tv_nsec >= 1000000000L) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+	return ts;
+}
+
+static void sim_cond_init(pthread_cond_t *cond)
+{
+	pthread_condattr_t attr;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(cond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+portTickType xTaskGetTickCount( void )
+{
+	struct timespec ts = sim_now();
+
+	return (portTickType)((unsigned long long)ts.tv_sec * configTICK_RATE_HZ +
+			ts.tv_nsec / (1000000000L / configTICK_RATE_HZ));
+}
+
+portTickType xTaskGetTickCountFromISR( void )
+{
+	return xTaskGetTickCount();
+}
+
+void vTaskDelay( portTickType xTicksToDelay )
+{
+	struct timespec ts = sim_deadline(xTicksToDelay);
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+}
+
+void vTaskDelayUntil( portTickType * const pxPreviousWakeTime,
+		portTickType xTimeIncrement )
+{
+	portTickType now = xTaskGetTickCount();
+	portTickType wake = *pxPreviousWakeTime + xTimeIncrement;
+
+	*pxPreviousWakeTime = wake;
+	if ((portBASE_TYPE)(wake - now) > 0) {
+		vTaskDelay(wake - now);
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+/* Critical sections */
+
+static void critical_init(void)
+{
+	pthread_mutexattr_t attr;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&critical_lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+void vPortEnterCritical( void )
+{
+	pthread_once(&critical_once, critical_init);
+	pthread_mutex_lock(&critical_lock);
+}
+
+void vPortExitCritical( void )
+{
+	pthread_mutex_unlock(&critical_lock);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Tasks */
+
+static void *sim_task_entry(void *arg)
+{
+	struct sim_task *task = arg;
+
+	current_task = task;
+
+	/* Tasks only run once the scheduler is started */
+	pthread_mutex_lock(&scheduler_lock);
+	while (!scheduler_started) {
+		pthread_cond_wait(&scheduler_started_cond, &scheduler_lock);
+	}
+	pthread_mutex_unlock(&scheduler_lock);
+
+	task->code(task->param);
+	return NULL;
+}
+
+signed portBASE_TYPE xTaskCreate( pdTASK_CODE pvTaskCode,
+		const signed char * const pcName, unsigned short usStackDepth,
+		void *pvParameters, unsigned portBASE_TYPE uxPriority,
+		xTaskHandle *pvCreatedTask )
+{
+	struct sim_task *task = calloc(1, sizeof(*task));
+
+	(void)usStackDepth;
+	(void)uxPriority;
+
+	if (task == NULL) {
+		return pdFAIL;
+	}
+	task->code = pvTaskCode;
+	task->param = pvParameters;
+	strncpy(task->name, (const char *)pcName, configMAX_TASK_NAME_LEN);
+	pthread_mutex_init(&task->lock, NULL);
+	pthread_cond_init(&task->resume, NULL);
+
+	if (pthread_create(&task->thread, NULL, sim_task_entry, task) != 0) {
+		free(task);
+		return pdFAIL;
+	}
+	pthread_detach(task->thread);
+
+	if (pvCreatedTask != NULL) {
+		*pvCreatedTask = task;
+	}
+	return pdPASS;
+}
+
+void register_handler(void *handler_priv)
+{
+	start_handler = handler_priv;
+}
+
+static void *sim_tick_thread(void *arg)
+{
+	struct timespec tick = { 0, 1000000000L / configTICK_RATE_HZ };
+
+	(void)arg;
+
+	for (;;) {
+		nanosleep(&tick, NULL);
+		vPortEnterCritical();
+		vApplicationTickHook();
+		vPortExitCritical();
+	}
+	return NULL;
+}
+
+void vTaskStartScheduler( void )
+{
+	pthread_t tick_thread;
+
+	if (start_handler) {
+		start_handler();
+	}
+
+	if (pthread_create(&tick_thread, NULL, sim_tick_thread, NULL) == 0) {
+		pthread_detach(tick_thread);
+	}
+
+	pthread_mutex_lock(&scheduler_lock);
+	scheduler_started = 1;
+	pthread_cond_broadcast(&scheduler_started_cond);
+	pthread_mutex_unlock(&scheduler_lock);
+
+	/* The scheduler never returns */
+	for (;;) {
+		pause();
+	}
+}
+
+xTaskHandle xTaskGetCurrentTaskHandle( void )
+{
+	return current_task;
+}
+
+void vTaskSuspend( xTaskHandle pxTaskToSuspend )
+{
+	struct sim_task *task = pxTaskToSuspend ? pxTaskToSuspend : current_task;
+
+	if (task != current_task) {
+		/* Suspending other tasks is not supported by the shim */
+		abort();
+	}
+
+	pthread_mutex_lock(&task->lock);
+	task->suspended = 1;
+	while (task->suspended) {
+		pthread_cond_wait(&task->resume, &task->lock);
+	}
+	pthread_mutex_unlock(&task->lock);
+}
+
+void vTaskResume( xTaskHandle pxTaskToResume )
+{
+	struct sim_task *task = pxTaskToResume;
+
+	pthread_mutex_lock(&task->lock);
+	if (task->suspended) {
+		task->suspended = 0;
+		pthread_cond_signal(&task->resume);
+	}
+	pthread_mutex_unlock(&task->lock);
+}
+
+portBASE_TYPE xTaskResumeFromISR( xTaskHandle pxTaskToResume )
+{
+	vTaskResume(pxTaskToResume);
+	return pdFALSE;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Queues and semaphores */
+
+xQueueHandle xQueueCreate( unsigned portBASE_TYPE uxQueueLength,
+		unsigned portBASE_TYPE uxItemSize )
+{
+	struct sim_queue *queue = calloc(1, sizeof(*queue));
+
+	if (queue == NULL || uxQueueLength == 0) {
+		free(queue);
+		return NULL;
+	}
+	queue->length = uxQueueLength;
+	queue->item_size = uxItemSize;
+	if (uxItemSize) {
+		queue->items = calloc(uxQueueLength, uxItemSize);
+		if (queue->items == NULL) {
+			free(queue);
+			return NULL;
+		}
+	}
+	pthread_mutex_init(&queue->lock, NULL);
+	sim_cond_init(&queue->not_empty);
+	sim_cond_init(&queue->not_full);
+	return queue;
+}
+
+xQueueHandle xQueueCreateCountingSemaphore(
+		unsigned portBASE_TYPE uxCountValue,
+		unsigned portBASE_TYPE uxInitialCount )
+{
+	struct sim_queue *queue = xQueueCreate(uxCountValue, 0);
+
+	if (queue != NULL) {
+		queue->count = uxInitialCount;
+	}
+	return queue;
+}
+
+void vQueueDelete( xQueueHandle pxQueue )
+{
+	struct sim_queue *queue = pxQueue;
+
+	free(queue->items);
+	free(queue);
+}
+
+/* Wait on 'cond' until 'ready' holds, at most 'ticks'. Called locked. */
+#define SIM_QUEUE_WAIT(queue, cond, ready, ticks, result)					\
+	do {																	\
+		struct timespec deadline = sim_deadline(ticks);						\
+		result = pdTRUE;													\
+		while (!(ready)) {													\
+			if ((ticks) == 0) {												\
+				result = pdFALSE;											\
+				break;														\
+			} else if ((ticks) == portMAX_DELAY) {							\
+				pthread_cond_wait(cond, &(queue)->lock);					\
+			} else if (pthread_cond_timedwait(cond, &(queue)->lock,			\
+					&deadline) == ETIMEDOUT && !(ready)) {					\
+				result = pdFALSE;											\
+				break;														\
+			}																\
+		}																	\
+	} while (0)
+
+signed portBASE_TYPE xQueueGenericSend( xQueueHandle pxQueue,
+		const void * const pvItemToQueue, portTickType xTicksToWait,
+		portBASE_TYPE xCopyPosition )
+{
+	struct sim_queue *queue = pxQueue;
+	signed portBASE_TYPE result;
+	unsigned int pos;
+
+	pthread_mutex_lock(&queue->lock);
+	SIM_QUEUE_WAIT(queue, &queue->not_full, queue->count < queue->length,
+			xTicksToWait, result);
+	if (result == pdTRUE) {
+		if (queue->item_size) {
+			if (xCopyPosition == queueSEND_TO_FRONT) {
+				queue->head = (queue->head + queue->length - 1) %
+						queue->length;
+				pos = queue->head;
+			} else {
+				pos = (queue->head + queue->count) % queue->length;
+			}
+			memcpy(queue->items + pos * queue->item_size, pvItemToQueue,
+					queue->item_size);
+		}
+		queue->count++;
+		pthread_cond_signal(&queue->not_empty);
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return result;
+}
+
+signed portBASE_TYPE xQueueGenericSendFromISR( xQueueHandle pxQueue,
+		const void * const pvItemToQueue,
+		signed portBASE_TYPE *pxHigherPriorityTaskWoken,
+		portBASE_TYPE xCopyPosition )
+{
+	if (pxHigherPriorityTaskWoken != NULL) {
+		*pxHigherPriorityTaskWoken = pdFALSE;
+	}
+	return xQueueGenericSend(pxQueue, pvItemToQueue, 0, xCopyPosition);
+}
+
+signed portBASE_TYPE xQueueGenericReceive( xQueueHandle pxQueue,
+		void * const pvBuffer, portTickType xTicksToWait,
+		portBASE_TYPE xJustPeeking )
+{
+	struct sim_queue *queue = pxQueue;
+	signed portBASE_TYPE result;
+
+	pthread_mutex_lock(&queue->lock);
+	SIM_QUEUE_WAIT(queue, &queue->not_empty, queue->count > 0, xTicksToWait,
+			result);
+	if (result == pdTRUE) {
+		if (queue->item_size && pvBuffer != NULL) {
+			memcpy(pvBuffer, queue->items + queue->head * queue->item_size,
+					queue->item_size);
+		}
+		if (!xJustPeeking) {
+			queue->head = (queue->head + 1) % queue->length;
+			queue->count--;
+			pthread_cond_signal(&queue->not_full);
+		}
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return result;
+}
+
+signed portBASE_TYPE xQueueReceiveFromISR( xQueueHandle pxQueue,
+		void * const pvBuffer,
+		signed portBASE_TYPE *pxHigherPriorityTaskWoken )
+{
+	if (pxHigherPriorityTaskWoken != NULL) {
+		*pxHigherPriorityTaskWoken = pdFALSE;
+	}
+	return xQueueGenericReceive(pxQueue, pvBuffer, 0, pdFALSE);
+}
+
+unsigned portBASE_TYPE uxQueueMessagesWaiting( const xQueueHandle pxQueue )
+{
+	struct sim_queue *queue = pxQueue;
+	unsigned portBASE_TYPE count;
+
+	pthread_mutex_lock(&queue->lock);
+	count = queue->count;
+	pthread_mutex_unlock(&queue->lock);
+	return count;
+}
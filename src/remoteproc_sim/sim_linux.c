@@ -0,0 +1,252 @@
+/*
+ * Simulated Linux master, behaves like virtio_rpmsg_bus on the vrings.
+ *
+ * - The firmware TX vring is filled with empty buffers once, each received
+ *   buffer is put back into the avail ring and announced with a kick on
+ *   TXVRING_IRQ (one kick per buffer, the firmware counts them).
+ * - Messages to the firmware go into the RX vring. The firmware consumes
+ *   descriptor N for the N-th message, so buffers are used in order. Messages
+ *   larger than one buffer are passed as an indirect descriptor table.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+
+#include "xil_types.h"
+#include "remoteproc_kernel.h"
+#include "atomic.h"
+
+#include "sim.h"
+
+#define SIM_PTR(addr)		((void *)(uintptr_t)(addr))
+
+/* Index of the next message to take from the firmware TX used ring */
+static unsigned int tx_last_used = 0;
+/* Index of the next free slot in the firmware TX avail ring */
+static unsigned int tx_avail_idx = 0;
+/* Number of messages sent to the firmware */
+static unsigned int rx_sent = 0;
+/* Message number that last used the indirect area, -1 if none */
+static unsigned int rx_indirect_msg = (unsigned int)-1;
+
+static unsigned int sim_tx_buffer(unsigned int i)
+{
+	return (unsigned int)(uintptr_t)__sim_buffers + i * PACKET_LEN_MAX;
+}
+
+static unsigned int sim_rx_buffer(unsigned int i)
+{
+	return (unsigned int)(uintptr_t)__sim_buffers +
+			(VRING_SIZE + i) * PACKET_LEN_MAX;
+}
+
+/* Indirect descriptor table and data area, after the buffers */
+static unsigned int sim_indirect_table(void)
+{
+	return sim_rx_buffer(VRING_SIZE);
+}
+
+static unsigned int sim_indirect_data(void)
+{
+	return sim_indirect_table() + (RPMSG_RX_CHAIN_MAX / PACKET_LEN_MAX + 1) *
+			sizeof(struct vring_desc);
+}
+
+static void sim_kick(int irq)
+{
+	uint64_t value = 1;
+
+	if (write(sim_irq_fds[irq], &value, sizeof(value)) != sizeof(value)) {
+		perror("sim: kick");
+	}
+}
+
+void sim_linux_doorbell(int irq)
+{
+	sim_kick(irq);
+}
+
+void sim_linux_start(void)
+{
+	struct vring_desc volatile *ring_tx = SIM_PTR(RING_TX);
+	struct vring_avail volatile *ring_tx_avail = SIM_PTR(RING_TX_AVAIL);
+	struct vring_desc volatile *ring_rx = SIM_PTR(RING_RX);
+	unsigned int i;
+
+	for (i = 0; i < VRING_SIZE; i++) {
+		ring_tx[i].addr = sim_tx_buffer(i);
+		ring_tx[i].addr_hi = 0;
+		ring_tx[i].len = PACKET_LEN_MAX;
+		ring_tx[i].flags = VRING_DESC_F_WRITE;
+		ring_tx[i].next = 0;
+		ring_tx_avail->ring[i] = i;
+
+		ring_rx[i].addr = sim_rx_buffer(i);
+		ring_rx[i].addr_hi = 0;
+		ring_rx[i].len = PACKET_LEN_MAX;
+		ring_rx[i].flags = 0;
+		ring_rx[i].next = 0;
+	}
+	tx_avail_idx = VRING_SIZE;
+	smp_mb();
+	ring_tx_avail->idx = (unsigned short)tx_avail_idx;
+
+	/* Tell the firmware the TX vring is ready */
+	sim_kick(TXVRING_IRQ);
+}
+
+static void sim_fill_hdr(struct rpmsg_hdr *hdr, unsigned int src,
+		unsigned int dst, unsigned int len)
+{
+	hdr->src = src;
+	hdr->dst = dst;
+	hdr->reserved = 0;
+	hdr->len = (unsigned short)len;
+	hdr->flags = 0;
+}
+
+static int sim_send(unsigned int src, unsigned int dst, const void *data,
+		unsigned int len, int broken)
+{
+	struct vring_used volatile *ring_rx_used = SIM_PTR(RING_RX_USED);
+	struct vring_avail volatile *ring_rx_avail = SIM_PTR(RING_RX_AVAIL);
+	struct vring_desc volatile *ring_rx = SIM_PTR(RING_RX);
+	struct vring_desc volatile *table = SIM_PTR(sim_indirect_table());
+	unsigned short used = ring_rx_used->idx;
+	unsigned int slot = rx_sent % VRING_SIZE;
+	unsigned int total = sizeof(struct rpmsg_hdr) + len;
+	unsigned int part;
+	unsigned int i;
+
+	if ((unsigned short)(rx_sent - used) >= VRING_SIZE ||
+			total > RPMSG_RX_CHAIN_MAX || len > 0xffff) {
+		return -1;
+	}
+
+	if (total <= PACKET_LEN_MAX &&
+			(broken < 0 || broken == SIM_BROKEN_CHAIN)) {
+		sim_fill_hdr(SIM_PTR(sim_rx_buffer(slot)), src, dst, len);
+		memcpy((char *)SIM_PTR(sim_rx_buffer(slot)) +
+				sizeof(struct rpmsg_hdr), data, len);
+		ring_rx[slot].addr = sim_rx_buffer(slot);
+		ring_rx[slot].len = total;
+		ring_rx[slot].flags = 0;
+		if (broken == SIM_BROKEN_CHAIN) {
+			/* Linked to the next buffer, which the firmware must not
+			 * take as the rest of this message */
+			ring_rx[slot].flags = VRING_DESC_F_NEXT;
+			ring_rx[slot].next = (slot + 1) % VRING_SIZE;
+		}
+	} else {
+		/* The indirect area is reused once the firmware has read it */
+		if (rx_indirect_msg != (unsigned int)-1 &&
+				(unsigned short)(rx_indirect_msg - used) < 0x8000) {
+			return -1;
+		}
+		sim_fill_hdr(SIM_PTR(sim_indirect_data()), src, dst, len);
+		memcpy((char *)SIM_PTR(sim_indirect_data()) +
+				sizeof(struct rpmsg_hdr), data, len);
+
+		/* Describe the message in buffer sized pieces */
+		for (i = 0; i * PACKET_LEN_MAX < total; i++) {
+			part = total - i * PACKET_LEN_MAX;
+			table[i].addr = sim_indirect_data() + i * PACKET_LEN_MAX;
+			table[i].addr_hi = 0;
+			table[i].len = part > PACKET_LEN_MAX ? PACKET_LEN_MAX : part;
+			table[i].flags = VRING_DESC_F_NEXT;
+			table[i].next = i + 1;
+		}
+		table[i - 1].flags = 0;
+		if (broken == SIM_BROKEN_LINK) {
+			table[0].flags = VRING_DESC_F_NEXT;
+			table[0].next = i;
+		}
+
+		ring_rx[slot].addr = sim_indirect_table();
+		ring_rx[slot].len = broken == SIM_BROKEN_EMPTY ? 0 :
+				i * sizeof(struct vring_desc);
+		ring_rx[slot].flags = VRING_DESC_F_INDIRECT;
+		rx_indirect_msg = rx_sent;
+	}
+
+	ring_rx_avail->ring[slot] = slot;
+	rx_sent++;
+	smp_mb();
+	ring_rx_avail->idx = (unsigned short)rx_sent;
+
+	sim_kick(RXVRING_IRQ);
+	return 0;
+}
+
+int sim_linux_send(unsigned int src, unsigned int dst, const void *data,
+		unsigned int len)
+{
+	return sim_send(src, dst, data, len, -1);
+}
+
+int sim_linux_send_broken(unsigned int src, unsigned int dst,
+		const void *data, unsigned int len, int broken)
+{
+	return sim_send(src, dst, data, len, broken);
+}
+
+static long long sim_now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int sim_linux_recv(struct sim_msg *msg, int timeout_ms)
+{
+	struct vring_used volatile *ring_tx_used = SIM_PTR(RING_TX_USED);
+	struct vring_avail volatile *ring_tx_avail = SIM_PTR(RING_TX_AVAIL);
+	struct vring_desc volatile *ring_tx = SIM_PTR(RING_TX);
+	long long deadline = sim_now_ms() + timeout_ms;
+	struct pollfd fd;
+	struct rpmsg_hdr *hdr;
+	unsigned int id;
+	uint64_t value;
+	long long left;
+
+	/* Wait until the firmware has published a message */
+	while (ring_tx_used->idx == (unsigned short)tx_last_used) {
+		left = deadline - sim_now_ms();
+		if (left <= 0) {
+			return -1;
+		}
+		fd.fd = sim_irq_fds[NOTIFY_LINUX_IRQ];
+		fd.events = POLLIN;
+		if (poll(&fd, 1, (int)left) > 0) {
+			if (read(fd.fd, &value, sizeof(value)) != sizeof(value)) {
+				perror("sim: notify");
+			}
+		}
+	}
+	smp_mb();
+
+	id = ring_tx_used->ring[tx_last_used % VRING_SIZE].id % VRING_SIZE;
+	hdr = SIM_PTR(ring_tx[id].addr & VRING_ADDR_MASK);
+	msg->src = hdr->src;
+	msg->dst = hdr->dst;
+	msg->len = hdr->len;
+	if (msg->len > sizeof(msg->data)) {
+		msg->len = sizeof(msg->data);
+	}
+	memcpy(msg->data, hdr->data, msg->len);
+	tx_last_used++;
+
+	/* Give the buffer back to the firmware */
+	ring_tx_avail->ring[tx_avail_idx % VRING_SIZE] = id;
+	tx_avail_idx++;
+	smp_mb();
+	ring_tx_avail->idx = (unsigned short)tx_avail_idx;
+	sim_kick(TXVRING_IRQ);
+	return 0;
+}
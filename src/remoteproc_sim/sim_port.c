@@ -0,0 +1,214 @@
+/*
+ * Host shim of the Zynq port and the Xilinx standalone BSP functions used by
+ * the firmware.
+ *
+ * Interrupts are eventfds created by the harness before it forks (see
+ * sim_irq_fds). An interrupt thread waits on the eventfds of all connected
+ * interrupts and runs the handler with the critical section lock held, so a
+ * task inside portENTER_CRITICAL() is never interrupted. The eventfds use
+ * EFD_SEMAPHORE, so every kick runs the handler once. Unlike the GIC this
+ * does not coalesce a kick that arrives while the interrupt is pending.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "xil_printf.h"
+#include "xil_cache.h"
+#include "xil_cache_l.h"
+
+#include "sim.h"
+
+int sim_irq_fds[SIM_IRQ_COUNT];
+
+struct sim_irq_handler {
+	void (*fce)(void *);
+	void *param;
+};
+
+static struct sim_irq_handler irq_handlers[SIM_IRQ_COUNT];
+static pthread_t irq_thread;
+static int irq_thread_started = 0;
+
+/* Copy the trace output to stderr, SIM_TRACE */
+static int trace_stderr = 0;
+/* Set by stdio_lock_init(), xputs() has no buffer before */
+static int trace_ready = 0;
+
+/* -------------------------------------------------------------------------- */
+/* Interrupts */
+
+static void *sim_irq_thread(void *arg)
+{
+	struct pollfd fds[SIM_IRQ_COUNT];
+	uint64_t value;
+	int i;
+
+	(void)arg;
+
+	for (;;) {
+		for (i = 0; i < SIM_IRQ_COUNT; i++) {
+			fds[i].fd = irq_handlers[i].fce ? sim_irq_fds[i] : -1;
+			fds[i].events = POLLIN;
+			fds[i].revents = 0;
+		}
+
+		/* Wake up now and then to pick up newly connected handlers */
+		if (poll(fds, SIM_IRQ_COUNT, 10) <= 0) {
+			continue;
+		}
+
+		for (i = 0; i < SIM_IRQ_COUNT; i++) {
+			if (!(fds[i].revents & POLLIN)) {
+				continue;
+			}
+			if (read(sim_irq_fds[i], &value, sizeof(value)) != sizeof(value)) {
+				continue;
+			}
+			vPortEnterCritical();
+			if (irq_handlers[i].fce) {
+				irq_handlers[i].fce(irq_handlers[i].param);
+			}
+			vPortExitCritical();
+		}
+	}
+	return NULL;
+}
+
+void clearIRQhandler(int int_no)
+{
+	if (int_no < 0 || int_no >= SIM_IRQ_COUNT) {
+		return;
+	}
+	vPortEnterCritical();
+	irq_handlers[int_no].fce = NULL;
+	irq_handlers[int_no].param = NULL;
+	vPortExitCritical();
+}
+
+void setupIRQhandler(int int_no, void *fce, void *param)
+{
+	if (int_no < 0 || int_no >= SIM_IRQ_COUNT) {
+		fprintf(stderr, "sim: IRQ %d is not simulated\n", int_no);
+		return;
+	}
+
+	vPortEnterCritical();
+	irq_handlers[int_no].fce = (void (*)(void *))fce;
+	irq_handlers[int_no].param = param;
+	if (!irq_thread_started) {
+		pthread_create(&irq_thread, NULL, sim_irq_thread, NULL);
+		pthread_detach(irq_thread);
+		irq_thread_started = 1;
+	}
+	vPortExitCritical();
+}
+
+void swirq_to_linux(int irq, int cpu)
+{
+	uint64_t value = 1;
+
+	(void)cpu;
+	if (irq >= 0 && irq < SIM_IRQ_COUNT) {
+		if (write(sim_irq_fds[irq], &value, sizeof(value)) != sizeof(value)) {
+			perror("sim: swirq_to_linux");
+		}
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+/* Cache maintenance, the host is coherent */
+
+void Xil_DCacheFlush(void)
+{
+	__sync_synchronize();
+}
+
+void Xil_DCacheFlushRange(unsigned int adr, unsigned len)
+{
+	__sync_synchronize();
+}
+
+void Xil_DCacheInvalidateRange(unsigned int adr, unsigned len)
+{
+	__sync_synchronize();
+}
+
+void Xil_L1DCacheFlush(void)
+{
+	__sync_synchronize();
+}
+
+void Xil_L1DCacheFlushRange(unsigned int adr, unsigned len)
+{
+	__sync_synchronize();
+}
+
+void Xil_L1DCacheInvalidateRange(unsigned int adr, unsigned len)
+{
+	__sync_synchronize();
+}
+
+void Xil_L2CacheFlushRange(unsigned int adr, unsigned len)
+{
+	__sync_synchronize();
+}
+
+void Xil_L2CacheInvalidateRange(unsigned int adr, unsigned len)
+{
+	__sync_synchronize();
+}
+
+/* -------------------------------------------------------------------------- */
+/* Console and trace buffer */
+
+void xil_printf(const char *ctrl1, ...)
+{
+	va_list args;
+
+	va_start(args, ctrl1);
+	vfprintf(stderr, ctrl1, args);
+	va_end(args);
+}
+
+/* The trace buffer is port_trace.c of the Zynq port. The firmware calls
+ * xputs() through this wrapper (-Wl,--wrap=xputs), which copies the text to
+ * stderr as well with SIM_TRACE. */
+void __real_xputs(char *str);
+
+void __wrap_xputs(char *str)
+{
+	if (trace_stderr) {
+		fputs(str, stderr);
+	}
+	if (trace_ready) {
+		__real_xputs(str);
+	}
+}
+
+void stdio_lock_init(unsigned int base, unsigned int len)
+{
+	port_trace_init(base, len);
+	trace_stderr = getenv("SIM_TRACE") != NULL;
+	trace_ready = 1;
+}
+
+void safe_printf(const char *format, ...)
+{
+	char string[100];
+	va_list args;
+
+	va_start(args, format);
+	vsnprintf(string, sizeof(string), format, args);
+	va_end(args);
+
+	xputs(string);
+}